@@ -0,0 +1,56 @@
+#pragma once
+
+#include "window.hpp"
+#include "device.hpp"
+#include "game_object.hpp"
+#include "renderer.hpp"
+
+#include <memory>
+
+namespace VulkanEngine {
+
+	class SimpleRenderSystem;
+
+	// two bodies orbiting each other, over a vector field of their pull.
+	// ./a.out gravity [--gpu] [--validate N]
+	class GravityApp {
+
+	public:
+		static constexpr int WIDTH = 800;
+		static constexpr int HEIGHT = 800;
+
+		struct Options {
+			// run the simulation with compute shaders, the objects never
+			// come back to the CPU. otherwise it runs on its own thread.
+			bool gpu = false;
+			// with the GPU, step the CPU's all pairs alongside it and print
+			// how far apart they are every so many frames (0 never)
+			int validateEvery = 0;
+		};
+
+		explicit GravityApp(Options options);
+		~GravityApp();
+
+		GravityApp(const GravityApp &) = delete;
+		GravityApp &operator=(const GravityApp &) = delete;
+
+		void run();
+
+	private:
+		void loadGameObjects();
+		void runCpu(SimpleRenderSystem &simpleRenderSystem);
+		void runGpu(SimpleRenderSystem &simpleRenderSystem);
+
+		Options options;
+
+		Window window{WIDTH, HEIGHT, "Gravity"};
+		Device device{window};
+		Renderer renderer{window, device};
+
+		std::shared_ptr<Model> squareModel;
+		std::shared_ptr<Model> circleModel;
+		GameObjects physicsObjects;
+		GameObjects vectorField;
+	};
+
+}
@@ -1,6 +1,7 @@
 #include "app.hpp"
 
 #include "simple_render_system.hpp"
+#include "trace.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -22,12 +23,20 @@ namespace VulkanEngine {
 	void App::run() {
 		SimpleRenderSystem simpleRenderSystem(device, renderer.getSwapChainRenderPass());
 		while (!window.shouldClose()) {
-			glfwPollEvents();
+			TRACE_SCOPE("frame");
+			{
+				TRACE_SCOPE("poll events");
+				glfwPollEvents();
+			}
 
 			if (auto commandBuffer = renderer.beginFrame()) {
-				renderer.beginSwapChainRenderPass(commandBuffer);
-				simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects);
-				renderer.endSwapChainRenderPass(commandBuffer);
+				updateGameObjects();
+				{
+					TRACE_SCOPE("record");
+					renderer.beginSwapChainRenderPass(commandBuffer);
+					simpleRenderSystem.renderGameObjects(commandBuffer, renderer.getFrameIndex(), gameObjects);
+					renderer.endSwapChainRenderPass(commandBuffer);
+				}
 				renderer.endFrame();
 			}
 		}
@@ -42,13 +51,25 @@ namespace VulkanEngine {
 			{{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}
 		};
 		auto model = std::make_shared<Model>(device, vertices);
-		auto triangle = GameObject::createGameObject();
-		triangle.model = model;
-		triangle.color = { 0.1f, 0.8f, 0.1f };
-		triangle.transform2D.translation.x = 0.0f;
-		triangle.transform2D.scale = { 1.0f, 1.0f };
-		triangle.transform2D.rotation = 0.25f * glm::two_pi<float>();
-		gameObjects.push_back(std::move(triangle));
+		auto triangle = gameObjects.indexOf(gameObjects.create());
+		gameObjects.models[triangle] = model;
+		gameObjects.colors[triangle] = { 0.1f, 0.8f, 0.1f };
+		gameObjects.translationX[triangle] = 0.0f;
+		gameObjects.scaleX[triangle] = 1.0f;
+		gameObjects.scaleY[triangle] = 1.0f;
+		gameObjects.rotation[triangle] = 0.25f * glm::two_pi<float>();
+	}
+
+	void App::updateGameObjects() {
+		frame += 1;
+		float scale = 1.0f + 0.5f * glm::sin(frame * 0.01f);
+		float translationX = 0.2f * glm::sin(frame * 0.005f);
+		for (size_t i = 0; i < gameObjects.size(); i++) {
+			gameObjects.rotation[i] = glm::mod(gameObjects.rotation[i] + 0.01f, glm::two_pi<float>());
+			gameObjects.scaleX[i] = scale;
+			gameObjects.scaleY[i] = scale;
+			gameObjects.translationX[i] = translationX;
+		}
 	}
 
 }
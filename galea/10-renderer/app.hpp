@@ -26,12 +26,15 @@ namespace VulkanEngine {
 
 	private:
 		void loadGameObjects();
+		// spin, scale and sway every object a little
+		void updateGameObjects();
 
 		Window window{WIDTH, HEIGHT, "Vulkan"};
 		Device device{window};
 		Renderer renderer{window, device};
 
-		std::vector<GameObject> gameObjects;
+		GameObjects gameObjects;
+		float frame = 0;
 	};
 
 }
@@ -0,0 +1,91 @@
+// scaling of GravityPhysicsSystem from 1 to N threads.
+// make benchmark && ./gravity-benchmark [bodies for Barnes-Hut] [bodies for all pairs] [threads]
+//
+// every run starts from the same bodies, and its positions and velocities
+// have to match the single threaded run bit for bit.
+
+#include "game_object.hpp"
+#include "gravity_physics_system.hpp"
+#include "thread_pool.hpp"
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+
+using namespace VulkanEngine;
+
+static void createBodies(GameObjects &bodies, size_t count) {
+	std::mt19937 random{1};
+	std::normal_distribution<float> position{0.0f, 0.3f};
+	std::normal_distribution<float> velocity{0.0f, 0.1f};
+	bodies.clear();
+	bodies.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		size_t body = bodies.indexOf(bodies.create());
+		bodies.translationX[body] = position(random);
+		bodies.translationY[body] = position(random);
+		bodies.velocityX[body] = velocity(random);
+		bodies.velocityY[body] = velocity(random);
+		bodies.mass[body] = 1.0f / count;
+	}
+}
+
+static bool sameBits(const std::vector<float> &a, const std::vector<float> &b) {
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+static void benchmark(const char *name, GravityPhysicsSystem::Solver solver, size_t count, size_t maxThreads) {
+	const int steps = 3;
+	printf("%s, %zu bodies, %d steps\n", name, count, steps);
+	printf("threads   ms/step   speedup   identical\n");
+
+	std::unique_ptr<GameObjects> reference;
+	double baseline = 0.0;
+	for (size_t threads = 1; threads <= maxThreads; threads++) {
+		// the calling thread is one of them
+		ThreadPool threadPool{threads - 1};
+		GravityPhysicsSystem gravitySystem{0.81f, &threadPool};
+		gravitySystem.solver = solver;
+
+		auto bodies = std::make_unique<GameObjects>();
+		createBodies(*bodies, count);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) {
+			gravitySystem.update(*bodies, 1.f / 60);
+		}
+		auto end = std::chrono::steady_clock::now();
+		double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / steps;
+		if (!reference) {
+			baseline = milliseconds;
+			reference = std::move(bodies);
+			printf("%7zu %9.2f %9.2f   reference\n", threads, milliseconds, 1.0);
+			continue;
+		}
+
+		bool identical =
+			sameBits(bodies->translationX, reference->translationX) &&
+			sameBits(bodies->translationY, reference->translationY) &&
+			sameBits(bodies->velocityX, reference->velocityX) &&
+			sameBits(bodies->velocityY, reference->velocityY);
+		printf("%7zu %9.2f %9.2f   %s\n", threads, milliseconds, baseline / milliseconds, identical ? "yes" : "NO");
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	size_t barnesHutBodies = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+	size_t allPairsBodies = argc > 2 ? strtoul(argv[2], nullptr, 10) : 5000;
+	size_t maxThreads = argc > 3
+		? strtoul(argv[3], nullptr, 10)
+		: std::max(1u, std::thread::hardware_concurrency());
+
+	benchmark("Barnes-Hut", GravityPhysicsSystem::Solver::BarnesHut, barnesHutBodies, maxThreads);
+	benchmark("all pairs", GravityPhysicsSystem::Solver::AllPairs, allPairsBodies, maxThreads);
+	return 0;
+}
@@ -0,0 +1,175 @@
+// the gravity demo's GravitySimulation without a window: the simulation on
+// its own thread, and a render loop at another rate interpolating from it.
+// make benchmark && ./simulation-benchmark [seconds] [bodies] [frames per second]
+//
+// afterwards the same steps are replayed from the start. the simulation has
+// to end where the replay does bit for bit, and every frame's positions
+// have to lie between those of two steps next to each other. frames
+// without movement are the render loop waiting for a late step.
+
+#include "game_object.hpp"
+#include "gravity_physics_system.hpp"
+#include "gravity_simulation.hpp"
+#include "thread_pool.hpp"
+#include "vec2_field_system.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace VulkanEngine;
+
+static const float SIMULATION_STEP = 1.f / 60;
+static const unsigned int SUBSTEPS = 5;
+
+static void createBodies(GameObjects &bodies, size_t count) {
+	std::mt19937 random{1};
+	std::normal_distribution<float> position{0.0f, 0.3f};
+	std::normal_distribution<float> velocity{0.0f, 0.1f};
+	bodies.clear();
+	bodies.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		size_t body = bodies.indexOf(bodies.create());
+		bodies.translationX[body] = position(random);
+		bodies.translationY[body] = position(random);
+		bodies.velocityX[body] = velocity(random);
+		bodies.velocityY[body] = velocity(random);
+		bodies.mass[body] = 1.0f / count;
+	}
+}
+
+static void createField(GameObjects &field, int gridCount) {
+	field.clear();
+	field.reserve(gridCount * gridCount);
+	for (int i = 0; i < gridCount; i++) {
+		for (int j = 0; j < gridCount; j++) {
+			size_t sample = field.indexOf(field.create());
+			field.translationX[sample] = -1.0f + (i + 0.5f) * 2.0f / gridCount;
+			field.translationY[sample] = -1.0f + (j + 0.5f) * 2.0f / gridCount;
+		}
+	}
+}
+
+static bool sameBits(const std::vector<float> &a, const std::vector<float> &b) {
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+// give or take the rounding of the interpolation
+static bool between(float value, float a, float b) {
+	float epsilon = 1e-6f * std::max(1.0f, std::max(std::abs(a), std::abs(b)));
+	return value >= std::min(a, b) - epsilon && value <= std::max(a, b) + epsilon;
+}
+
+// a frame as the render loop drew it
+struct Frame {
+	uint64_t step;
+	std::vector<float> x;
+	std::vector<float> y;
+};
+
+int main(int argc, char **argv) {
+	double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+	size_t count = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000;
+	double framesPerSecond = argc > 3 ? atof(argv[3]) : 144.0;
+
+	size_t cores = ThreadPool::defaultThreadCount();
+	ThreadPool threadPool{cores > 1 ? cores - 1 : 1};
+	GravityPhysicsSystem gravitySystem{0.81f, &threadPool};
+	Vec2FieldSystem fieldSystem{};
+
+	GameObjects bodies{};
+	GameObjects field{};
+	createBodies(bodies, count);
+	createField(field, 40);
+	GameObjects renderBodies{};
+	GameObjects renderField{};
+	GravitySimulation::copyObjects(bodies, renderBodies);
+	GravitySimulation::copyObjects(field, renderField);
+
+	printf("%zu bodies, %.0f steps/s, rendering at %.0f frames/s for %.1f s\n",
+		count, 1.0 / SIMULATION_STEP, framesPerSecond, seconds);
+
+	std::vector<Frame> frames{};
+	uint64_t stalledFrames = 0;
+	uint64_t steps = 0;
+	auto frameTime = std::chrono::duration<double>(1.0 / framesPerSecond);
+	{
+		GravitySimulation simulation{gravitySystem, fieldSystem, bodies, field, SIMULATION_STEP, SUBSTEPS};
+		simulation.start();
+		auto start = std::chrono::steady_clock::now();
+		auto next = start;
+		while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(seconds)) {
+			uint64_t step = simulation.interpolate(renderBodies, renderField);
+			if (!frames.empty() && step == frames.back().step &&
+				sameBits(renderBodies.translationX, frames.back().x) &&
+				sameBits(renderBodies.translationY, frames.back().y)) {
+				stalledFrames++;
+			}
+			frames.push_back({step, renderBodies.translationX, renderBodies.translationY});
+			next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameTime);
+			std::this_thread::sleep_until(next);
+		}
+		simulation.stop();
+
+		// the last step there was time for
+		steps = simulation.interpolate(renderBodies, renderField);
+		printf("%llu steps (%llu dropped), %zu frames (%llu without movement)\n",
+			static_cast<unsigned long long>(steps),
+			static_cast<unsigned long long>(simulation.droppedSteps()),
+			frames.size(),
+			static_cast<unsigned long long>(stalledFrames));
+	}
+
+	// the replay, keeping where the bodies were after every step
+	GameObjects replay{};
+	createBodies(replay, count);
+	std::vector<std::vector<float>> replayX{replay.translationX};
+	std::vector<std::vector<float>> replayY{replay.translationY};
+	for (uint64_t k = 1; k <= steps; k++) {
+		gravitySystem.update(replay, SIMULATION_STEP, SUBSTEPS);
+		replayX.push_back(replay.translationX);
+		replayY.push_back(replay.translationY);
+	}
+	if (!sameBits(replay.translationX, bodies.translationX) ||
+		!sameBits(replay.translationY, bodies.translationY) ||
+		!sameBits(replay.velocityX, bodies.velocityX) ||
+		!sameBits(replay.velocityY, bodies.velocityY)) {
+		printf("FAILED: the simulation's bodies are not where the replay puts them\n");
+		return EXIT_FAILURE;
+	}
+	printf("the simulation ended where %llu replayed steps do\n", static_cast<unsigned long long>(steps));
+
+	// a frame is drawn between the two steps before its snapshot's, or
+	// the last two. step 0 is where everything starts, drawn as it is.
+	auto drawnBetween = [&](const Frame &frame, uint64_t from) {
+		for (size_t i = 0; i < count; i++) {
+			if (!between(frame.x[i], replayX[from][i], replayX[from + 1][i]) ||
+				!between(frame.y[i], replayY[from][i], replayY[from + 1][i])) {
+				return false;
+			}
+		}
+		return true;
+	};
+	for (size_t f = 0; f < frames.size(); f++) {
+		const Frame &frame = frames[f];
+		if (frame.step == 0) {
+			continue;
+		}
+		if (!drawnBetween(frame, frame.step - 1) && (frame.step < 2 || !drawnBetween(frame, frame.step - 2))) {
+			printf("FAILED: frame %zu was drawn outside of steps %llu to %llu\n",
+				f,
+				static_cast<unsigned long long>(frame.step < 2 ? 0 : frame.step - 2),
+				static_cast<unsigned long long>(frame.step));
+			return EXIT_FAILURE;
+		}
+	}
+	printf("every frame lies between two steps next to each other\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "fft.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace VulkanEngine {
+
+	FFT::FFT(size_t n) : n{n} {
+		if (n == 0 || (n & (n - 1)) != 0) {
+			throw std::runtime_error("fft size must be a power of 2");
+		}
+
+		// worked out in double, so the twiddles are right to the last bit
+		const double pi = std::acos(-1.0);
+		twiddles.resize(n / 2);
+		for (size_t k = 0; k < n / 2; k++) {
+			double angle = -2.0 * pi * k / n;
+			twiddles[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+		}
+
+		size_t bits = 0;
+		while ((size_t{1} << bits) < n) bits++;
+		reversed.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			size_t r = 0;
+			for (size_t b = 0; b < bits; b++) {
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			}
+			reversed[i] = r;
+		}
+	}
+
+	// iterative Cooley-Tukey: the input in bit reversed order, then
+	// butterflies of length 2, 4, ... n
+	void FFT::transform(std::complex<float> *data, bool inverse, size_t stride) const {
+		for (size_t i = 0; i < n; i++) {
+			size_t r = reversed[i];
+			if (i < r) std::swap(data[i * stride], data[r * stride]);
+		}
+
+		for (size_t length = 2; length <= n; length *= 2) {
+			size_t half = length / 2;
+			size_t step = n / length;
+			for (size_t start = 0; start < n; start += length) {
+				for (size_t k = 0; k < half; k++) {
+					std::complex<float> w = twiddles[k * step];
+					if (inverse) w = std::conj(w);
+					std::complex<float> &a = data[(start + k) * stride];
+					std::complex<float> &b = data[(start + k + half) * stride];
+					std::complex<float> t = complexMultiply(w, b);
+					b = a - t;
+					a += t;
+				}
+			}
+		}
+
+		if (inverse) {
+			float scale = 1.0f / n;
+			for (size_t i = 0; i < n; i++) {
+				data[i * stride] *= scale;
+			}
+		}
+	}
+
+	// the columns are copied out to be transformed, rather than walked n
+	// values apart
+	void FFT::transform2D(std::complex<float> *data, bool inverse) const {
+		for (size_t row = 0; row < n; row++) {
+			transform(data + row * n, inverse);
+		}
+		std::vector<std::complex<float>> column(n);
+		for (size_t col = 0; col < n; col++) {
+			for (size_t row = 0; row < n; row++) {
+				column[row] = data[row * n + col];
+			}
+			transform(column.data(), inverse);
+			for (size_t row = 0; row < n; row++) {
+				data[row * n + col] = column[row];
+			}
+		}
+	}
+
+}
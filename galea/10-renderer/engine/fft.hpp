@@ -0,0 +1,38 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace VulkanEngine {
+
+	// a * b, without std::complex's checks for infinities and nans, which
+	// are a call into the runtime for every product without -ffast-math
+	inline std::complex<float> complexMultiply(std::complex<float> a, std::complex<float> b) {
+		return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+	}
+
+	// in place radix 2 fast Fourier transforms, n must be a power of 2.
+	// the inverse is scaled by 1 / n (per dimension), so a forward then an
+	// inverse transform gives the input back.
+	class FFT {
+	public:
+		explicit FFT(size_t n);
+
+		size_t size() const { return n; }
+
+		// n values, stride apart
+		void transform(std::complex<float> *data, bool inverse, size_t stride = 1) const;
+
+		// an n by n grid, row by row
+		void transform2D(std::complex<float> *data, bool inverse) const;
+
+	private:
+		size_t n;
+		// e^(-2 pi i k / n) for k < n / 2
+		std::vector<std::complex<float>> twiddles;
+		// where each index goes in the bit reversed order
+		std::vector<size_t> reversed;
+	};
+
+}
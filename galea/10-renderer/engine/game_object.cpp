@@ -0,0 +1,97 @@
+#include "game_object.hpp"
+
+#include <stdexcept>
+
+namespace VulkanEngine {
+
+	// the last element into index, then drop the last
+	template <typename T>
+	static void swapRemove(std::vector<T> &array, size_t index) {
+		if (index != array.size() - 1) {
+			array[index] = std::move(array.back());
+		}
+		array.pop_back();
+	}
+
+	GameObjects::id_t GameObjects::create() {
+		id_t id = static_cast<id_t>(indices.size());
+		indices.push_back(ids.size());
+		ids.push_back(id);
+
+		models.emplace_back();
+		colors.emplace_back(0.0f);
+
+		translationX.push_back(0.0f);
+		translationY.push_back(0.0f);
+		scaleX.push_back(1.0f);
+		scaleY.push_back(1.0f);
+		rotation.push_back(0.0f);
+
+		velocityX.push_back(0.0f);
+		velocityY.push_back(0.0f);
+		mass.push_back(1.0f);
+		return id;
+	}
+
+	void GameObjects::destroy(id_t id) {
+		size_t index = indexOf(id);
+		size_t last = ids.size() - 1;
+		indices[ids[last]] = index;
+		indices[id] = INVALID_INDEX;
+
+		swapRemove(ids, index);
+		swapRemove(models, index);
+		swapRemove(colors, index);
+		swapRemove(translationX, index);
+		swapRemove(translationY, index);
+		swapRemove(scaleX, index);
+		swapRemove(scaleY, index);
+		swapRemove(rotation, index);
+		swapRemove(velocityX, index);
+		swapRemove(velocityY, index);
+		swapRemove(mass, index);
+	}
+
+	void GameObjects::clear() {
+		for (id_t id : ids) {
+			indices[id] = INVALID_INDEX;
+		}
+		ids.clear();
+		models.clear();
+		colors.clear();
+		translationX.clear();
+		translationY.clear();
+		scaleX.clear();
+		scaleY.clear();
+		rotation.clear();
+		velocityX.clear();
+		velocityY.clear();
+		mass.clear();
+	}
+
+	bool GameObjects::contains(id_t id) const {
+		return id < indices.size() && indices[id] != INVALID_INDEX;
+	}
+
+	size_t GameObjects::indexOf(id_t id) const {
+		if (!contains(id)) {
+			throw std::runtime_error("no game object with this id");
+		}
+		return indices[id];
+	}
+
+	void GameObjects::reserve(size_t count) {
+		ids.reserve(count);
+		models.reserve(count);
+		colors.reserve(count);
+		translationX.reserve(count);
+		translationY.reserve(count);
+		scaleX.reserve(count);
+		scaleY.reserve(count);
+		rotation.reserve(count);
+		velocityX.reserve(count);
+		velocityY.reserve(count);
+		mass.reserve(count);
+	}
+
+}
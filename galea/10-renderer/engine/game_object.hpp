@@ -3,52 +3,66 @@
 #include "model.hpp"
 
 #include <memory>
+#include <vector>
 
 namespace VulkanEngine {
 
-	struct Transform2DComponent {
-		glm::vec2 translation{};
-		glm::vec2 scale{1.0f, 1.0f};
-		float rotation;
-
-		glm::mat2 mat2() {
-			const float s = glm::sin(rotation);
-			const float c = glm::cos(rotation);
-			glm::mat2 rotMat{ {c, s}, {-s, c} };
-			glm::mat2 scaleMat{ {scale.x, 0.0f}, {0.0f, scale.y} };
-			return rotMat * scaleMat;
-		}
-	};
-
-	struct RigidBody2dComponent {
-		glm::vec2 velocity;
-		float mass{1.0f};
-	};
-
-	class GameObject {
+	// every game object, as one array per component field.
+	//
+	// index i of every array is the same object, so a system only walks the
+	// arrays it needs, in order, and can work on several objects at a time.
+	// objects are kept packed: destroying one moves the last object into
+	// its place. an object's index can change that way, its id never does.
+	//
+	// the arrays are public to be read and written directly, but only
+	// create and destroy may change their size.
+	class GameObjects {
 	public:
 		using id_t = unsigned int;
 
-		static GameObject createGameObject() {
-			static id_t currentId = 0;
-			return GameObject{currentId++};
-		}
+		GameObjects() = default;
+		GameObjects(const GameObjects &) = delete;
+		GameObjects &operator=(const GameObjects &) = delete;
+
+		// a new object at the end of the arrays: no model, black, at the
+		// origin with a scale of one, at rest with a mass of one
+		id_t create();
+		void destroy(id_t id);
+		void clear();
 
-		GameObject(const GameObject &) = delete;
-		GameObject &operator=(const GameObject &) = delete;
-		GameObject(GameObject &&) = default;
-		GameObject &operator=(GameObject &&) = default;
+		bool contains(id_t id) const;
+		// where the object is in the arrays, for now
+		size_t indexOf(id_t id) const;
 
-		id_t getId() { return id; }
+		size_t size() const { return ids.size(); }
+		bool empty() const { return ids.empty(); }
+		void reserve(size_t count);
 
-		std::shared_ptr<Model> model{};
-		glm::vec3 color{};
-		Transform2DComponent transform2D;
-		RigidBody2dComponent rigidBody2d;
+		// the id of the object at each index
+		std::vector<id_t> ids;
+
+		// rendering
+		std::vector<std::shared_ptr<Model>> models;
+		std::vector<glm::vec3> colors;
+
+		// 2d transform
+		std::vector<float> translationX;
+		std::vector<float> translationY;
+		std::vector<float> scaleX;
+		std::vector<float> scaleY;
+		std::vector<float> rotation;
+
+		// 2d rigid body
+		std::vector<float> velocityX;
+		std::vector<float> velocityY;
+		std::vector<float> mass;
 
 	private:
-		GameObject(id_t objId) : id{objId} {}
+		static constexpr size_t INVALID_INDEX = ~size_t(0);
 
-		id_t id;
+		// by id, the object's index, or INVALID_INDEX once destroyed.
+		// ids are handed out in order and not reused.
+		std::vector<size_t> indices;
 	};
-}
\ No newline at end of file
+
+}
@@ -0,0 +1,431 @@
+#include "gpu_gravity_system.hpp"
+#include "simple_render_system.hpp"
+#include "trace.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace VulkanEngine {
+
+	// the compute shaders' Body and Sample, std430
+	struct alignas(16) GpuBody {
+		glm::vec2 position;
+		glm::vec2 velocity;
+		glm::vec4 color;
+		float mass;
+		float rotation;
+		glm::vec2 scale;
+	};
+	static_assert(sizeof(GpuBody) == 48, "GpuBody must match the std430 Body");
+
+	struct alignas(16) GpuSample {
+		glm::vec2 position;
+		float mass;
+		float scaleY;
+		glm::vec4 color;
+	};
+	static_assert(sizeof(GpuSample) == 32, "GpuSample must match the std430 Sample");
+
+	struct GravityPushConstants {
+		uint32_t bodyCount;
+		uint32_t fieldCount;
+		float dt;
+		float strength;
+	};
+
+	// local_size_x of both shaders
+	static constexpr uint32_t WORKGROUP_SIZE = 256;
+
+	// bodies in, bodies out, the instance buffer, the field's samples
+	static constexpr uint32_t BINDING_COUNT = 4;
+
+	GpuGravitySystem::GpuGravitySystem(Device &device, float strength, VkDescriptorSetLayout objectSetLayout)
+		: strengthGravity{strength}, device{device}, objectSetLayout{objectSetLayout} {
+		createDescriptorSetLayout();
+		createDescriptorPool();
+		createPipelineLayout();
+		createPipelines();
+
+		std::array<VkDescriptorSetLayout, 2> layouts{descriptorSetLayout, descriptorSetLayout};
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+		allocInfo.pSetLayouts = layouts.data();
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, sets) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate gravity descriptor sets");
+		}
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &objectSetLayout;
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, &objectSet) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate object descriptor set");
+		}
+
+		// empty until upload, so the sets always point at something
+		createBuffers();
+		writeDescriptorSets();
+	}
+
+	GpuGravitySystem::~GpuGravitySystem() {
+		destroyBuffers();
+		vkDestroyDescriptorPool(device.device(), descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(device.device(), descriptorSetLayout, nullptr);
+		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	}
+
+	void GpuGravitySystem::createDescriptorSetLayout() {
+		std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+		for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+		if (vkCreateDescriptorSetLayout(device.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout");
+		}
+	}
+
+	void GpuGravitySystem::createDescriptorPool() {
+		// two compute sets, and the instance buffer's set
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = 2 * BINDING_COUNT + 1;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 3;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(device.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool");
+		}
+	}
+
+	void GpuGravitySystem::createPipelineLayout() {
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(GravityPushConstants);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline layout");
+		}
+	}
+
+	void GpuGravitySystem::createPipelines() {
+		gravityPipeline = std::make_unique<ComputePipeline>(
+			device,
+			"shaders/gravity.comp.spv",
+			pipelineLayout);
+		fieldPipeline = std::make_unique<ComputePipeline>(
+			device,
+			"shaders/vec2_field.comp.spv",
+			pipelineLayout);
+	}
+
+	// a buffer can't be empty, so one element at least
+	void GpuGravitySystem::createBuffers() {
+		VkDeviceSize bodiesSize = sizeof(GpuBody) * std::max(bodyCount, 1u);
+		bodies[0] = createBuffer(bodiesSize);
+		bodies[1] = createBuffer(bodiesSize);
+		samples = createBuffer(sizeof(GpuSample) * std::max(fieldCount, 1u));
+		objects = createBuffer(sizeof(ObjectData) * std::max(bodyCount + fieldCount, 1u));
+	}
+
+	void GpuGravitySystem::destroyBuffers() {
+		destroyBuffer(bodies[0]);
+		destroyBuffer(bodies[1]);
+		destroyBuffer(samples);
+		destroyBuffer(objects);
+	}
+
+	void GpuGravitySystem::writeDescriptorSets() {
+		auto bufferInfo = [](VkBuffer buffer) {
+			VkDescriptorBufferInfo info{};
+			info.buffer = buffer;
+			info.offset = 0;
+			info.range = VK_WHOLE_SIZE;
+			return info;
+		};
+
+		// sets[i] steps bodies[i] into bodies[1 - i]
+		std::array<VkDescriptorBufferInfo, 2 * BINDING_COUNT + 1> infos{};
+		std::array<VkWriteDescriptorSet, 2 * BINDING_COUNT + 1> writes{};
+		for (uint32_t i = 0; i < 2; i++) {
+			std::array<VkBuffer, BINDING_COUNT> buffers{
+				bodies[i].buffer,
+				bodies[1 - i].buffer,
+				objects.buffer,
+				samples.buffer};
+			for (uint32_t binding = 0; binding < BINDING_COUNT; binding++) {
+				uint32_t w = i * BINDING_COUNT + binding;
+				infos[w] = bufferInfo(buffers[binding]);
+				writes[w].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[w].dstSet = sets[i];
+				writes[w].dstBinding = binding;
+				writes[w].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				writes[w].descriptorCount = 1;
+				writes[w].pBufferInfo = &infos[w];
+			}
+		}
+		// the render system's layout, the instance buffer at binding 0
+		uint32_t w = 2 * BINDING_COUNT;
+		infos[w] = bufferInfo(objects.buffer);
+		writes[w].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[w].dstSet = objectSet;
+		writes[w].dstBinding = 0;
+		writes[w].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[w].descriptorCount = 1;
+		writes[w].pBufferInfo = &infos[w];
+		vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	GpuGravitySystem::Buffer GpuGravitySystem::createBuffer(VkDeviceSize size) {
+		Buffer buffer{};
+		device.createBuffer(
+			size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			buffer.buffer,
+			buffer.memory);
+		return buffer;
+	}
+
+	void GpuGravitySystem::destroyBuffer(Buffer &buffer) {
+		vkDestroyBuffer(device.device(), buffer.buffer, nullptr);
+		vkFreeMemory(device.device(), buffer.memory, nullptr);
+		buffer = Buffer{};
+	}
+
+	void GpuGravitySystem::copyToBuffer(const void *data, VkDeviceSize size, VkBuffer dst) {
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		device.createBuffer(
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBuffer,
+			stagingBufferMemory);
+
+		void *mapped;
+		vkMapMemory(device.device(), stagingBufferMemory, 0, size, 0, &mapped);
+		memcpy(mapped, data, static_cast<size_t>(size));
+		vkUnmapMemory(device.device(), stagingBufferMemory);
+
+		device.copyBuffer(stagingBuffer, dst, size);
+
+		vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
+		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+	}
+
+	void GpuGravitySystem::copyFromBuffer(VkBuffer src, VkDeviceSize size, void *data) {
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		device.createBuffer(
+			size,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBuffer,
+			stagingBufferMemory);
+
+		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+
+		// the compute shaders' writes, before the copy reads them
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.size = size;
+		vkCmdCopyBuffer(commandBuffer, src, stagingBuffer, 1, &copyRegion);
+
+		// and the copy's, before the host reads them
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		device.endSingleTimeCommands(commandBuffer);
+
+		void *mapped;
+		vkMapMemory(device.device(), stagingBufferMemory, 0, size, 0, &mapped);
+		memcpy(data, mapped, static_cast<size_t>(size));
+		vkUnmapMemory(device.device(), stagingBufferMemory);
+
+		vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
+		vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+	}
+
+	void GpuGravitySystem::upload(const GameObjects &physicsObjs, const GameObjects &vectorField) {
+		// a frame in flight may still be using the old buffers
+		vkDeviceWaitIdle(device.device());
+
+		destroyBuffers();
+		bodyCount = static_cast<uint32_t>(physicsObjs.size());
+		fieldCount = static_cast<uint32_t>(vectorField.size());
+		current = 0;
+		createBuffers();
+		writeDescriptorSets();
+
+		if (bodyCount > 0) {
+			std::vector<GpuBody> gpuBodies(bodyCount);
+			for (uint32_t i = 0; i < bodyCount; i++) {
+				auto &body = gpuBodies[i];
+				body.position = {physicsObjs.translationX[i], physicsObjs.translationY[i]};
+				body.velocity = {physicsObjs.velocityX[i], physicsObjs.velocityY[i]};
+				body.color = glm::vec4(physicsObjs.colors[i], 1.0f);
+				body.mass = physicsObjs.mass[i];
+				body.rotation = physicsObjs.rotation[i];
+				body.scale = {physicsObjs.scaleX[i], physicsObjs.scaleY[i]};
+			}
+			copyToBuffer(gpuBodies.data(), sizeof(GpuBody) * bodyCount, bodies[current].buffer);
+		}
+
+		if (fieldCount > 0) {
+			std::vector<GpuSample> gpuSamples(fieldCount);
+			for (uint32_t i = 0; i < fieldCount; i++) {
+				auto &sample = gpuSamples[i];
+				sample.position = {vectorField.translationX[i], vectorField.translationY[i]};
+				sample.mass = vectorField.mass[i];
+				sample.scaleY = vectorField.scaleY[i];
+				sample.color = glm::vec4(vectorField.colors[i], 1.0f);
+			}
+			copyToBuffer(gpuSamples.data(), sizeof(GpuSample) * fieldCount, samples.buffer);
+		}
+	}
+
+	void GpuGravitySystem::record(VkCommandBuffer commandBuffer, float dt, unsigned int substeps) {
+		TRACE_SCOPE("gpu gravity");
+		if (bodyCount == 0 && fieldCount == 0) return;
+
+		// the buffers are shared by every frame in flight. the last frame's
+		// uploads, dispatches and draws come first in the queue, and have
+		// to be done with them before this frame's dispatches touch them.
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		GravityPushConstants push{};
+		push.bodyCount = bodyCount;
+		push.fieldCount = fieldCount;
+		push.dt = dt / substeps;
+		push.strength = strengthGravity;
+
+		// each substep reads what the last one wrote
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		if (bodyCount > 0) {
+			gravityPipeline->bind(commandBuffer);
+			vkCmdPushConstants(
+				commandBuffer,
+				pipelineLayout,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				0,
+				sizeof(GravityPushConstants),
+				&push);
+			uint32_t groupCount = (bodyCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+			for (unsigned int i = 0; i < substeps; i++) {
+				vkCmdBindDescriptorSets(
+					commandBuffer,
+					VK_PIPELINE_BIND_POINT_COMPUTE,
+					pipelineLayout,
+					0,
+					1,
+					&sets[current],
+					0,
+					nullptr);
+				vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+				vkCmdPipelineBarrier(
+					commandBuffer,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0, 1, &barrier, 0, nullptr, 0, nullptr);
+				current = 1 - current;
+			}
+		}
+
+		// the field of where the bodies are after the step
+		if (fieldCount > 0) {
+			fieldPipeline->bind(commandBuffer);
+			vkCmdPushConstants(
+				commandBuffer,
+				pipelineLayout,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				0,
+				sizeof(GravityPushConstants),
+				&push);
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_COMPUTE,
+				pipelineLayout,
+				0,
+				1,
+				&sets[current],
+				0,
+				nullptr);
+			vkCmdDispatch(commandBuffer, (fieldCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+		}
+
+		// the instance buffer, before the vertex shader reads it
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void GpuGravitySystem::readBack(GameObjects &physicsObjs) {
+		if (physicsObjs.size() != bodyCount) {
+			throw std::runtime_error("read back into objects which were not uploaded");
+		}
+		if (bodyCount == 0) return;
+
+		vkDeviceWaitIdle(device.device());
+		std::vector<GpuBody> gpuBodies(bodyCount);
+		copyFromBuffer(bodies[current].buffer, sizeof(GpuBody) * bodyCount, gpuBodies.data());
+		for (uint32_t i = 0; i < bodyCount; i++) {
+			physicsObjs.translationX[i] = gpuBodies[i].position.x;
+			physicsObjs.translationY[i] = gpuBodies[i].position.y;
+			physicsObjs.velocityX[i] = gpuBodies[i].velocity.x;
+			physicsObjs.velocityY[i] = gpuBodies[i].velocity.y;
+		}
+	}
+
+}
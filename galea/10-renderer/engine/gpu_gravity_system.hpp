@@ -0,0 +1,93 @@
+#pragma once
+
+#include "device.hpp"
+#include "pipeline.hpp"
+#include "game_object.hpp"
+
+#include <memory>
+
+namespace VulkanEngine {
+
+	// the gravity simulation and its vector field, run by compute shaders.
+	//
+	// the objects are copied to the GPU once, after which the GPU owns them:
+	// every frame the compute shaders move them, work out the field, and
+	// write every instance's ObjectData straight into a buffer the simple
+	// render system draws from. the CPU only records the dispatches.
+	//
+	// the physics are those of GravityPhysicsSystem with Solver::AllPairs,
+	// which is the reference to check them against with readBack. the sums
+	// are in a different order, so they agree to rounding, not bit for bit.
+	class GpuGravitySystem {
+	public:
+		// objectSetLayout is the simple render system's, the set of the
+		// instance buffer is allocated with it
+		GpuGravitySystem(Device &device, float strength, VkDescriptorSetLayout objectSetLayout);
+		~GpuGravitySystem();
+
+		GpuGravitySystem(const GpuGravitySystem &) = delete;
+		GpuGravitySystem &operator=(const GpuGravitySystem &) = delete;
+
+		const float strengthGravity;
+
+		// copies the bodies and the field's sample points to the GPU,
+		// replacing whatever was there. waits for the GPU to be idle.
+		void upload(const GameObjects &physicsObjs, const GameObjects &vectorField);
+
+		// records substeps of dt / substeps, then the field, into a command
+		// buffer outside of a render pass. the instance buffer is ready for
+		// the vertex shader after it.
+		void record(VkCommandBuffer commandBuffer, float dt, unsigned int substeps = 1);
+
+		// the positions and velocities on the GPU, into physicsObjs (which
+		// must be the objects given to upload). waits for the GPU to be idle.
+		void readBack(GameObjects &physicsObjs);
+
+		// the bodies are instances [0, getBodyCount()) of the instance
+		// buffer, the field's samples come right after them
+		VkDescriptorSet getObjectSet() const { return objectSet; }
+		uint32_t getBodyCount() const { return bodyCount; }
+		uint32_t getFieldCount() const { return fieldCount; }
+
+	private:
+		struct Buffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+		};
+
+		void createDescriptorSetLayout();
+		void createDescriptorPool();
+		void createPipelineLayout();
+		void createPipelines();
+		void createBuffers();
+		void destroyBuffers();
+		void writeDescriptorSets();
+		// device local, copied to and from through a staging buffer
+		Buffer createBuffer(VkDeviceSize size);
+		void destroyBuffer(Buffer &buffer);
+		void copyToBuffer(const void *data, VkDeviceSize size, VkBuffer dst);
+		void copyFromBuffer(VkBuffer src, VkDeviceSize size, void *data);
+
+		Device &device;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorSetLayout objectSetLayout;
+		VkDescriptorPool descriptorPool;
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<ComputePipeline> gravityPipeline;
+		std::unique_ptr<ComputePipeline> fieldPipeline;
+
+		// the bodies, stepped from one buffer into the other
+		Buffer bodies[2];
+		Buffer samples;
+		Buffer objects;
+		// sets[i] reads bodies[i] and writes bodies[1 - i]
+		VkDescriptorSet sets[2];
+		VkDescriptorSet objectSet;
+		// which of bodies holds the latest state
+		uint32_t current = 0;
+
+		uint32_t bodyCount = 0;
+		uint32_t fieldCount = 0;
+	};
+
+}
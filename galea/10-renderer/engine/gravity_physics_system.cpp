@@ -0,0 +1,456 @@
+#include "gravity_physics_system.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GRAVITY_SSE2
+#endif
+
+namespace VulkanEngine {
+
+	// objects closer than this (squared) don't pull on each other
+	static constexpr float MIN_DISTANCE_SQUARED = 1e-10f;
+	// a cell with this many objects or fewer is not split
+	static constexpr uint32_t LEAF_SIZE = 8;
+	// objects in a cell with this many or fewer share one walk of the tree
+	static constexpr uint32_t GROUP_SIZE = 64;
+	// groups of cells per parallel job
+	static constexpr uint32_t GROUPS_PER_JOB = 8;
+	// all pairs, the number of tasks. fixed, so that the sums (and the
+	// results) don't depend on the number of threads. each one needs a
+	// velocity change for every object.
+	static constexpr uint32_t PAIR_TASKS = 16;
+	// all pairs, rows of the pair loop handed out at a time
+	static constexpr uint32_t ROW_TILE = 64;
+	// objects per job, when every object is updated the same way
+	static constexpr uint32_t OBJECTS_PER_JOB = 4096;
+	// bits of a Morton code per axis, also the deepest level of the tree
+	static constexpr uint32_t MORTON_BITS = 16;
+
+	// the bits of v spread out to every other bit
+	static uint32_t spreadBits(uint32_t v) {
+		v &= 0x0000ffff;
+		v = (v | (v << 8)) & 0x00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+
+	// which of its parent's quarters a key is in, at this level.
+	// bit 0 is the x half, bit 1 the y half.
+	static uint32_t quadrant(uint64_t key, uint32_t level) {
+		uint32_t shift = 32 + 2 * (MORTON_BITS - 1 - level);
+		return static_cast<uint32_t>(key >> shift) & 3;
+	}
+
+	// the pull of count point masses on a point at x, y, without
+	// strengthGravity. count is a multiple of 4. masses at a distance of 0
+	// (like the point itself) are skipped.
+	static glm::vec2 sumAcceleration(
+		const float *px, const float *py, const float *pm, size_t count, float x, float y) {
+#ifdef GRAVITY_SSE2
+		const __m128 minDistanceSquared = _mm_set1_ps(MIN_DISTANCE_SQUARED);
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 x4 = _mm_set1_ps(x);
+		__m128 y4 = _mm_set1_ps(y);
+		__m128 ax = _mm_setzero_ps();
+		__m128 ay = _mm_setzero_ps();
+		for (size_t j = 0; j < count; j += 4) {
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(px + j), x4);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(py + j), y4);
+			__m128 distanceSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			__m128 far = _mm_cmpge_ps(distanceSquared, minDistanceSquared);
+			__m128 inverseDistance = _mm_div_ps(one, _mm_sqrt_ps(distanceSquared));
+			inverseDistance = _mm_and_ps(far, inverseDistance);
+			__m128 s = _mm_mul_ps(
+				_mm_loadu_ps(pm + j),
+				_mm_mul_ps(inverseDistance, _mm_mul_ps(inverseDistance, inverseDistance)));
+			ax = _mm_add_ps(ax, _mm_mul_ps(s, dx));
+			ay = _mm_add_ps(ay, _mm_mul_ps(s, dy));
+		}
+		float lanesX[4], lanesY[4];
+		_mm_storeu_ps(lanesX, ax);
+		_mm_storeu_ps(lanesY, ay);
+		return {(lanesX[0] + lanesX[1]) + (lanesX[2] + lanesX[3]), (lanesY[0] + lanesY[1]) + (lanesY[2] + lanesY[3])};
+#else
+		float ax = 0.0f, ay = 0.0f;
+		for (size_t j = 0; j < count; j++) {
+			float dx = px[j] - x;
+			float dy = py[j] - y;
+			float distanceSquared = dx * dx + dy * dy;
+			if (distanceSquared < MIN_DISTANCE_SQUARED) continue;
+			float inverseDistance = 1.0f / std::sqrt(distanceSquared);
+			float s = pm[j] * inverseDistance * inverseDistance * inverseDistance;
+			ax += s * dx;
+			ay += s * dy;
+		}
+		return {ax, ay};
+#endif
+	}
+
+	void GravityPhysicsSystem::update(GameObjects &objs, float dt, unsigned int substeps) {
+		TRACE_SCOPE("gravity");
+		const float stepDelta = dt / substeps;
+		for (unsigned int i = 0; i < substeps; i++) {
+			if (solver == Solver::AllPairs) {
+				stepAllPairs(objs, stepDelta);
+			} else {
+				stepBarnesHut(objs, stepDelta);
+			}
+		}
+	}
+
+	glm::vec2 GravityPhysicsSystem::computeForce(glm::vec2 from, float fromMass, glm::vec2 to, float toMass) const {
+		auto offset = from - to;
+		float distanceSquared = glm::dot(offset, offset);
+
+		// clown town - just going to return 0 if objects are too close together...
+		if (glm::abs(distanceSquared) < MIN_DISTANCE_SQUARED) {
+			return {.0f, .0f};
+		}
+
+		float force = strengthGravity * toMass * fromMass / distanceSquared;
+		return force * offset / glm::sqrt(distanceSquared);
+	}
+
+	glm::vec2 GravityPhysicsSystem::computeForceAt(const GameObjects &objs, glm::vec2 position, float mass) const {
+		if (solver == Solver::BarnesHut && !nodes.empty()) {
+			return mass * accelerationAt(position.x, position.y, UINT32_MAX);
+		}
+		glm::vec2 force{};
+		for (size_t i = 0; i < objs.size(); i++) {
+			glm::vec2 from{objs.translationX[i], objs.translationY[i]};
+			force += computeForce(from, objs.mass[i], position, mass);
+		}
+		return force;
+	}
+
+	void GravityPhysicsSystem::parallelFor(size_t count, const std::function<void(size_t)> &job) {
+		if (threadPool) {
+			threadPool->parallelFor(count, job);
+			return;
+		}
+		for (size_t i = 0; i < count; i++) {
+			job(i);
+		}
+	}
+
+	void GravityPhysicsSystem::stepAllPairs(GameObjects &objs, float dt) {
+		size_t count = objs.size();
+		taskVelocityX.resize(PAIR_TASKS);
+		taskVelocityY.resize(PAIR_TASKS);
+
+		// row a has count - a - 1 pairs. tiles of rows go to the tasks back
+		// and forth (0 1 2 .. 15 15 14 .. 0 0 1 ..), so that each gets some
+		// long rows and some short ones
+		size_t tileCount = (count + ROW_TILE - 1) / ROW_TILE;
+		parallelFor(PAIR_TASKS, [&](size_t task) {
+			auto &velocityX = taskVelocityX[task];
+			auto &velocityY = taskVelocityY[task];
+			velocityX.assign(count, 0.0f);
+			velocityY.assign(count, 0.0f);
+
+			for (size_t tile = 0; tile < tileCount; tile++) {
+				size_t round = tile / PAIR_TASKS;
+				size_t slot = tile % PAIR_TASKS;
+				if ((round % 2 == 0 ? slot : PAIR_TASKS - 1 - slot) != task) continue;
+
+				size_t end = std::min(count, (tile + 1) * ROW_TILE);
+				for (size_t a = tile * ROW_TILE; a < end; a++) {
+					glm::vec2 positionA{objs.translationX[a], objs.translationY[a]};
+					for (size_t b = a + 1; b < count; b++) {
+						auto force = computeForce(
+							positionA,
+							objs.mass[a],
+							{objs.translationX[b], objs.translationY[b]},
+							objs.mass[b]);
+						velocityX[a] -= force.x / objs.mass[a];
+						velocityY[a] -= force.y / objs.mass[a];
+						velocityX[b] += force.x / objs.mass[b];
+						velocityY[b] += force.y / objs.mass[b];
+					}
+				}
+			}
+		});
+
+		// the tasks' changes, always added in the same order
+		size_t jobs = (count + OBJECTS_PER_JOB - 1) / OBJECTS_PER_JOB;
+		parallelFor(jobs, [&](size_t job) {
+			size_t end = std::min(count, (job + 1) * OBJECTS_PER_JOB);
+			for (size_t i = job * OBJECTS_PER_JOB; i < end; i++) {
+				float velocityX = 0.0f, velocityY = 0.0f;
+				for (uint32_t task = 0; task < PAIR_TASKS; task++) {
+					velocityX += taskVelocityX[task][i];
+					velocityY += taskVelocityY[task][i];
+				}
+				objs.velocityX[i] += dt * velocityX;
+				objs.velocityY[i] += dt * velocityY;
+
+				// update each objects position based on its final velocity
+				objs.translationX[i] += dt * objs.velocityX[i];
+				objs.translationY[i] += dt * objs.velocityY[i];
+			}
+		});
+	}
+
+	void GravityPhysicsSystem::stepBarnesHut(GameObjects &objs, float dt) {
+		buildTree(objs);
+
+		// the objects of a small cell are close together, so they can share
+		// one walk of the tree, with the opening test against all of them
+		groups.clear();
+		if (!nodes.empty()) {
+			uint32_t stack[4 * (MORTON_BITS + 1)];
+			uint32_t top = 0;
+			stack[top++] = 0;
+			while (top > 0) {
+				uint32_t index = stack[--top];
+				const Node &node = nodes[index];
+				if (node.end - node.begin <= GROUP_SIZE || node.childCount == 0) {
+					groups.push_back(index);
+					continue;
+				}
+				for (uint32_t c = 0; c < node.childCount; c++) {
+					stack[top++] = node.firstChild + c;
+				}
+			}
+		}
+
+		// every object is in one group, and only its own group changes its
+		// velocity, with the same sums however the groups are shared out
+		size_t jobs = (groups.size() + GROUPS_PER_JOB - 1) / GROUPS_PER_JOB;
+		parallelFor(jobs, [&](size_t job) {
+			Interactions interactions;
+			size_t end = std::min(groups.size(), (job + 1) * GROUPS_PER_JOB);
+			for (size_t g = job * GROUPS_PER_JOB; g < end; g++) {
+				const Node &group = nodes[groups[g]];
+
+				float minX = sortedX[group.begin], maxX = minX;
+				float minY = sortedY[group.begin], maxY = minY;
+				for (uint32_t i = group.begin + 1; i < group.end; i++) {
+					minX = std::min(minX, sortedX[i]);
+					maxX = std::max(maxX, sortedX[i]);
+					minY = std::min(minY, sortedY[i]);
+					maxY = std::max(maxY, sortedY[i]);
+				}
+				gatherInteractions(minX, minY, maxX, maxY, interactions);
+
+				for (uint32_t i = group.begin; i < group.end; i++) {
+					// the object itself is in the list, at a distance of 0
+					glm::vec2 acceleration = sumAcceleration(
+						interactions.x.data(), interactions.y.data(), interactions.mass.data(),
+						interactions.mass.size(), sortedX[i], sortedY[i]);
+					uint32_t object = static_cast<uint32_t>(keys[i]);
+					objs.velocityX[object] += dt * strengthGravity * acceleration.x;
+					objs.velocityY[object] += dt * strengthGravity * acceleration.y;
+				}
+			}
+		});
+
+		for (size_t i = 0; i < objs.size(); i++) {
+			objs.translationX[i] += dt * objs.velocityX[i];
+			objs.translationY[i] += dt * objs.velocityY[i];
+		}
+	}
+
+	void GravityPhysicsSystem::gatherInteractions(
+		float minX, float minY, float maxX, float maxY, Interactions &interactions) const {
+		interactions.x.clear();
+		interactions.y.clear();
+		interactions.mass.clear();
+		float thetaSquared = theta * theta;
+
+		uint32_t stack[4 * (MORTON_BITS + 1)];
+		uint32_t top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node &node = nodes[stack[--top]];
+
+			// the distance from the center of mass to the closest point of the box
+			float dx = std::max({minX - node.centerOfMassX, 0.0f, node.centerOfMassX - maxX});
+			float dy = std::max({minY - node.centerOfMassY, 0.0f, node.centerOfMassY - maxY});
+			// a cell which overlaps the box is always opened
+			bool overlaps =
+				node.minX <= maxX && minX < node.minX + node.size &&
+				node.minY <= maxY && minY < node.minY + node.size;
+			if (!overlaps && node.size * node.size < thetaSquared * (dx * dx + dy * dy)) {
+				interactions.x.push_back(node.centerOfMassX);
+				interactions.y.push_back(node.centerOfMassY);
+				interactions.mass.push_back(node.mass);
+				continue;
+			}
+
+			if (node.childCount == 0) {
+				for (uint32_t j = node.begin; j < node.end; j++) {
+					interactions.x.push_back(sortedX[j]);
+					interactions.y.push_back(sortedY[j]);
+					interactions.mass.push_back(sortedMass[j]);
+				}
+				continue;
+			}
+			for (uint32_t c = 0; c < node.childCount; c++) {
+				stack[top++] = node.firstChild + c;
+			}
+		}
+
+		// to a multiple of 4 with masses of 0, which pull on nothing
+		while (interactions.mass.size() % 4 != 0) {
+			interactions.x.push_back(0.0f);
+			interactions.y.push_back(0.0f);
+			interactions.mass.push_back(0.0f);
+		}
+	}
+
+	void GravityPhysicsSystem::buildTree(const GameObjects &objs) {
+		nodes.clear();
+		keys.clear();
+		uint32_t count = static_cast<uint32_t>(objs.size());
+		if (count == 0) return;
+
+		// the smallest square around every object
+		auto [minX, maxX] = std::minmax_element(objs.translationX.begin(), objs.translationX.end());
+		auto [minY, maxY] = std::minmax_element(objs.translationY.begin(), objs.translationY.end());
+		float size = std::max(*maxX - *minX, *maxY - *minY);
+		// a little larger, so that the largest coordinate is inside it
+		size = size > 0.0f ? size * 1.0001f : 1.0f;
+		float scale = static_cast<float>(1u << MORTON_BITS) / size;
+
+		// the Morton code in the high bits, the object's index in the low,
+		// which also makes the order the same for objects in the same spot
+		keys.resize(count);
+		uint32_t maxCell = (1u << MORTON_BITS) - 1;
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t cellX = std::min(static_cast<uint32_t>((objs.translationX[i] - *minX) * scale), maxCell);
+			uint32_t cellY = std::min(static_cast<uint32_t>((objs.translationY[i] - *minY) * scale), maxCell);
+			uint64_t code = spreadBits(cellX) | (spreadBits(cellY) << 1);
+			keys[i] = (code << 32) | i;
+		}
+		std::sort(keys.begin(), keys.end());
+
+		sortedX.resize(count);
+		sortedY.resize(count);
+		sortedMass.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t object = static_cast<uint32_t>(keys[i]);
+			sortedX[i] = objs.translationX[object];
+			sortedY[i] = objs.translationY[object];
+			sortedMass[i] = objs.mass[object];
+		}
+
+		nodes.resize(1);
+		buildNode(0, 0, count, 0, *minX, *minY, size);
+	}
+
+	void GravityPhysicsSystem::buildNode(
+		uint32_t index, uint32_t begin, uint32_t end, uint32_t level, float minX, float minY, float size) {
+		Node node{};
+		node.minX = minX;
+		node.minY = minY;
+		node.size = size;
+		node.begin = begin;
+		node.end = end;
+
+		if (end - begin <= LEAF_SIZE || level == MORTON_BITS) {
+			double mass = 0.0, x = 0.0, y = 0.0;
+			for (uint32_t i = begin; i < end; i++) {
+				mass += sortedMass[i];
+				x += sortedMass[i] * sortedX[i];
+				y += sortedMass[i] * sortedY[i];
+			}
+			node.mass = static_cast<float>(mass);
+			node.centerOfMassX = mass > 0.0 ? static_cast<float>(x / mass) : minX + 0.5f * size;
+			node.centerOfMassY = mass > 0.0 ? static_cast<float>(y / mass) : minY + 0.5f * size;
+			nodes[index] = node;
+			return;
+		}
+
+		// the keys are sorted, so each quarter is a range of the parent's
+		uint32_t bounds[5] = {begin, 0, 0, 0, end};
+		for (uint32_t q = 1; q < 4; q++) {
+			auto first = std::partition_point(
+				keys.begin() + bounds[q - 1], keys.begin() + end,
+				[&](uint64_t key) { return quadrant(key, level) < q; });
+			bounds[q] = static_cast<uint32_t>(first - keys.begin());
+		}
+
+		node.firstChild = static_cast<uint32_t>(nodes.size());
+		for (uint32_t q = 0; q < 4; q++) {
+			if (bounds[q] != bounds[q + 1]) node.childCount++;
+		}
+		nodes.resize(nodes.size() + node.childCount);
+
+		float half = 0.5f * size;
+		uint32_t child = node.firstChild;
+		for (uint32_t q = 0; q < 4; q++) {
+			if (bounds[q] == bounds[q + 1]) continue;
+			buildNode(
+				child++, bounds[q], bounds[q + 1], level + 1,
+				minX + (q & 1) * half, minY + (q >> 1) * half, half);
+		}
+
+		// children are built, their totals make this node's
+		float mass = 0.0f, x = 0.0f, y = 0.0f;
+		for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+			mass += nodes[c].mass;
+			x += nodes[c].mass * nodes[c].centerOfMassX;
+			y += nodes[c].mass * nodes[c].centerOfMassY;
+		}
+		node.mass = mass;
+		node.centerOfMassX = mass > 0.0f ? x / mass : minX + half;
+		node.centerOfMassY = mass > 0.0f ? y / mass : minY + half;
+		nodes[index] = node;
+	}
+
+	glm::vec2 GravityPhysicsSystem::accelerationAt(float x, float y, uint32_t skip) const {
+		if (nodes.empty()) return {};
+		float thetaSquared = theta * theta;
+		float ax = 0.0f, ay = 0.0f;
+
+		// every level pushes at most 4 children and pops one
+		uint32_t stack[4 * (MORTON_BITS + 1)];
+		uint32_t top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node &node = nodes[stack[--top]];
+
+			if (node.childCount == 0) {
+				for (uint32_t j = node.begin; j < node.end; j++) {
+					if (j == skip) continue;
+					float dx = sortedX[j] - x;
+					float dy = sortedY[j] - y;
+					float distanceSquared = dx * dx + dy * dy;
+					if (distanceSquared < MIN_DISTANCE_SQUARED) continue;
+					float inverseDistance = 1.0f / std::sqrt(distanceSquared);
+					float s = sortedMass[j] * inverseDistance * inverseDistance * inverseDistance;
+					ax += s * dx;
+					ay += s * dy;
+				}
+				continue;
+			}
+
+			float dx = node.centerOfMassX - x;
+			float dy = node.centerOfMassY - y;
+			float distanceSquared = dx * dx + dy * dy;
+			// a cell the point is in is always opened, however far its center of mass is
+			bool inside =
+				x >= node.minX && x < node.minX + node.size &&
+				y >= node.minY && y < node.minY + node.size;
+			if (!inside && node.size * node.size < thetaSquared * distanceSquared) {
+				float inverseDistance = 1.0f / std::sqrt(distanceSquared);
+				float s = node.mass * inverseDistance * inverseDistance * inverseDistance;
+				ax += s * dx;
+				ay += s * dy;
+				continue;
+			}
+			for (uint32_t c = 0; c < node.childCount; c++) {
+				stack[top++] = node.firstChild + c;
+			}
+		}
+		return strengthGravity * glm::vec2{ax, ay};
+	}
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "game_object.hpp"
+#include "thread_pool.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace VulkanEngine {
+
+	// every object pulls on every other with strengthGravity * m1 * m2 / d^2.
+	//
+	// with a thread pool the forces are worked out in parallel. the work is
+	// split the same way whatever the number of threads, and partial sums
+	// are added up in a fixed order, so the results are bit for bit the
+	// same with any number of threads (or none).
+	class GravityPhysicsSystem {
+	public:
+		enum class Solver {
+			// every pair, both objects updated as the pair is visited.
+			// exact, O(n^2), the reference for the others.
+			// each task has its own velocity changes for every object,
+			// which are added up in task order.
+			AllPairs,
+			// a quadtree over the objects, far away groups of objects pull
+			// as one body at their center of mass. O(n log n)
+			BarnesHut,
+		};
+
+		// without a thread pool everything runs on the calling thread
+		GravityPhysicsSystem(float strength, ThreadPool *threadPool = nullptr)
+			: strengthGravity{strength}, threadPool{threadPool} {}
+
+		const float strengthGravity;
+
+		Solver solver = Solver::BarnesHut;
+		// the opening angle of Barnes-Hut. a cell pulls as one body when its
+		// size is less than theta times its distance. smaller is more
+		// accurate and slower, 0 visits every object.
+		float theta = 0.5f;
+
+		// dt stands for delta time, and specifies the amount of time to advance the simulation
+		// substeps is how many intervals to divide the forward time step in. More substeps result in a
+		// more stable simulation, but takes longer to compute
+		void update(GameObjects &objs, float dt, unsigned int substeps = 1);
+
+		// the force the object at "from" pulls the object at "to" with
+		glm::vec2 computeForce(glm::vec2 from, float fromMass, glm::vec2 to, float toMass) const;
+
+		// the force every object pulls a point of this mass with. with Barnes-Hut
+		// this uses the tree of the last substep, so the objects are where they
+		// were at its start, otherwise every object is visited.
+		glm::vec2 computeForceAt(const GameObjects &objs, glm::vec2 position, float mass) const;
+
+	private:
+		// a square cell of the quadtree. its objects are a range of the
+		// sorted arrays, its children (if any) are consecutive nodes.
+		struct Node {
+			float centerOfMassX;
+			float centerOfMassY;
+			float mass;
+			float minX;
+			float minY;
+			float size;
+			uint32_t firstChild;
+			uint32_t childCount;
+			uint32_t begin;
+			uint32_t end;
+		};
+
+		// on the thread pool if there is one
+		void parallelFor(size_t count, const std::function<void(size_t)> &job);
+		void stepAllPairs(GameObjects &objs, float dt);
+		void stepBarnesHut(GameObjects &objs, float dt);
+
+		// sorts the objects along a Morton (Z order) curve, so that every
+		// cell's objects are next to each other, then splits the cells
+		void buildTree(const GameObjects &objs);
+		// fills in nodes[index], and adds its children (and theirs) at the end
+		void buildNode(uint32_t index, uint32_t begin, uint32_t end, uint32_t level, float minX, float minY, float size);
+		// a list of point masses, padded to a multiple of 4
+		struct Interactions {
+			std::vector<float> x;
+			std::vector<float> y;
+			std::vector<float> mass;
+		};
+
+		// what pulls on every object in a box: cells far enough from all of
+		// it as one body, and the objects of those which are not
+		void gatherInteractions(float minX, float minY, float maxX, float maxY, Interactions &interactions) const;
+		// the acceleration of a point at x, y from gravity. the object at
+		// sorted index skip (if any) is left out, it is the point.
+		glm::vec2 accelerationAt(float x, float y, uint32_t skip) const;
+
+		std::vector<Node> nodes;
+		// the objects' Morton codes and indices, in Morton order
+		std::vector<uint64_t> keys;
+		// positions and masses, in Morton order
+		std::vector<float> sortedX;
+		std::vector<float> sortedY;
+		std::vector<float> sortedMass;
+		// the cells whose objects share a walk of the tree
+		std::vector<uint32_t> groups;
+
+		// all pairs, the velocity changes of each task
+		std::vector<std::vector<float>> taskVelocityX;
+		std::vector<std::vector<float>> taskVelocityY;
+
+		ThreadPool *threadPool;
+	};
+
+}
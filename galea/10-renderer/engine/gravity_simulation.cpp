@@ -0,0 +1,108 @@
+#include "gravity_simulation.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace VulkanEngine {
+
+	GravitySimulation::GravitySimulation(
+		GravityPhysicsSystem &gravitySystem,
+		Vec2FieldSystem &fieldSystem,
+		GameObjects &physicsObjects,
+		GameObjects &vectorField,
+		float stepDelta,
+		unsigned int substeps)
+		: gravitySystem{gravitySystem},
+		  fieldSystem{fieldSystem},
+		  physicsObjects{physicsObjects},
+		  vectorField{vectorField},
+		  substeps{substeps},
+		  thread{stepDelta, [this](uint64_t k) { step(k); }} {}
+
+	void GravitySimulation::start() {
+		fieldSystem.update(gravitySystem, physicsObjects, vectorField);
+		auto &initial = snapshots.back();
+		initial.step = 0;
+		earlierX = physicsObjects.translationX;
+		earlierY = physicsObjects.translationY;
+		initial.earlierX = initial.previousX = initial.currentX = earlierX;
+		initial.earlierY = initial.previousY = initial.currentY = earlierY;
+		initial.fieldScaleX = vectorField.scaleX;
+		initial.fieldRotation = vectorField.rotation;
+		snapshots.publish();
+		thread.start();
+	}
+
+	void GravitySimulation::stop() {
+		thread.stop();
+	}
+
+	// the vectors keep their memory from the last time this buffer was
+	// written, so copying into them does not allocate
+	void GravitySimulation::step(uint64_t k) {
+		auto &snapshot = snapshots.back();
+		snapshot.step = k;
+		snapshot.earlierX = earlierX;
+		snapshot.earlierY = earlierY;
+		snapshot.previousX = physicsObjects.translationX;
+		snapshot.previousY = physicsObjects.translationY;
+
+		gravitySystem.update(physicsObjects, thread.stepDelta, substeps);
+		fieldSystem.update(gravitySystem, physicsObjects, vectorField);
+
+		snapshot.currentX = physicsObjects.translationX;
+		snapshot.currentY = physicsObjects.translationY;
+		snapshot.fieldScaleX = vectorField.scaleX;
+		snapshot.fieldRotation = vectorField.rotation;
+		earlierX = snapshot.previousX;
+		earlierY = snapshot.previousY;
+		snapshots.publish();
+	}
+
+	// the render loop draws a step behind the simulation's clock, from
+	// snapshot.step - 2 to snapshot.step - 1 while the step after it is
+	// being worked on, then from snapshot.step - 1 to snapshot.step once it
+	// is late. if it is later still the objects wait at the end of it.
+	uint64_t GravitySimulation::interpolate(GameObjects &renderObjects, GameObjects &renderField) {
+		const Snapshot &snapshot = snapshots.acquire();
+		if (renderObjects.size() != snapshot.currentX.size() ||
+			renderField.size() != snapshot.fieldScaleX.size()) {
+			throw std::runtime_error("render objects are not copies of the simulated ones");
+		}
+
+		double from = static_cast<double>(snapshot.step) - 1.0;
+		const std::vector<float> *fromX = &snapshot.previousX, *toX = &snapshot.currentX;
+		const std::vector<float> *fromY = &snapshot.previousY, *toY = &snapshot.currentY;
+		double renderStep = thread.renderStep();
+		if (renderStep < from && snapshot.step > 1) {
+			from -= 1.0;
+			fromX = &snapshot.earlierX, toX = &snapshot.previousX;
+			fromY = &snapshot.earlierY, toY = &snapshot.previousY;
+		}
+		float alpha = static_cast<float>(std::clamp(renderStep - from, 0.0, 1.0));
+		for (size_t i = 0; i < renderObjects.size(); i++) {
+			renderObjects.translationX[i] = glm::mix((*fromX)[i], (*toX)[i], alpha);
+			renderObjects.translationY[i] = glm::mix((*fromY)[i], (*toY)[i], alpha);
+		}
+		// the field only changes slowly, it jumps from step to step
+		renderField.scaleX = snapshot.fieldScaleX;
+		renderField.rotation = snapshot.fieldRotation;
+		return snapshot.step;
+	}
+
+	void GravitySimulation::copyObjects(const GameObjects &from, GameObjects &to) {
+		to.clear();
+		to.reserve(from.size());
+		for (size_t i = 0; i < from.size(); i++) {
+			to.create();
+		}
+		to.models = from.models;
+		to.colors = from.colors;
+		to.translationX = from.translationX;
+		to.translationY = from.translationY;
+		to.scaleX = from.scaleX;
+		to.scaleY = from.scaleY;
+		to.rotation = from.rotation;
+	}
+
+}
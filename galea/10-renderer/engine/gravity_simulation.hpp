@@ -0,0 +1,86 @@
+#pragma once
+
+#include "game_object.hpp"
+#include "gravity_physics_system.hpp"
+#include "vec2_field_system.hpp"
+#include "simulation_thread.hpp"
+#include "triple_buffer.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace VulkanEngine {
+
+	// the gravity demo's simulation on its own thread, a fixed step at a
+	// time whatever the frame rate.
+	//
+	// from start to stop the simulation thread owns the physics objects and
+	// the vector field. every step is published as a snapshot, and the
+	// render loop moves its own copies of the objects to where they are
+	// between the last two steps.
+	class GravitySimulation {
+	public:
+		GravitySimulation(
+			GravityPhysicsSystem &gravitySystem,
+			Vec2FieldSystem &fieldSystem,
+			GameObjects &physicsObjects,
+			GameObjects &vectorField,
+			float stepDelta,
+			unsigned int substeps = 1);
+		// stops, without rethrowing what a step threw
+		~GravitySimulation() = default;
+
+		GravitySimulation(const GravitySimulation &) = delete;
+		GravitySimulation &operator=(const GravitySimulation &) = delete;
+
+		// publishes where everything starts as step 0, then starts the thread
+		void start();
+		// if a step threw, it is thrown here
+		void stop();
+
+		// moves renderObjects and renderField, made with copyObjects, to
+		// the latest snapshot. the objects are interpolated to the thread's
+		// render step, the field takes the latest step. returns the
+		// snapshot's step.
+		uint64_t interpolate(GameObjects &renderObjects, GameObjects &renderField);
+
+		uint64_t droppedSteps() const { return thread.droppedSteps(); }
+
+		// objects to draw, like from but with ids of their own
+		static void copyObjects(const GameObjects &from, GameObjects &to);
+
+	private:
+		// what the render loop needs from one step: where the physics
+		// objects were after it and the two steps before it, and the field
+		// after it. a step is usually done before its time comes, so the
+		// render step is between the two earlier ones until the next.
+		struct Snapshot {
+			uint64_t step = 0;
+			std::vector<float> earlierX;
+			std::vector<float> earlierY;
+			std::vector<float> previousX;
+			std::vector<float> previousY;
+			std::vector<float> currentX;
+			std::vector<float> currentY;
+			std::vector<float> fieldScaleX;
+			std::vector<float> fieldRotation;
+		};
+
+		void step(uint64_t k);
+
+		GravityPhysicsSystem &gravitySystem;
+		Vec2FieldSystem &fieldSystem;
+		GameObjects &physicsObjects;
+		GameObjects &vectorField;
+		const unsigned int substeps;
+		// where the physics objects were two steps ago, only touched by
+		// the simulation thread once it has started
+		std::vector<float> earlierX;
+		std::vector<float> earlierY;
+
+		TripleBuffer<Snapshot> snapshots;
+		// last, so it stops before anything it uses goes away
+		SimulationThread thread;
+	};
+
+}
@@ -38,8 +38,8 @@ namespace VulkanEngine {
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 	}
 
-	void Model::draw(VkCommandBuffer commandBuffer) {
-		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+	void Model::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
+		vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
 	}
 
 	std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
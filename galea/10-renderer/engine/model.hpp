@@ -27,7 +27,8 @@ namespace VulkanEngine {
 		Model &operator=(const Model &) = delete;
 
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		// instances are told apart by gl_InstanceIndex, which starts at firstInstance
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
 
 	private:
 		void createVertexBuffers(const std::vector<Vertex> &vertices);
@@ -41,6 +41,7 @@ namespace VulkanEngine {
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
 	private:
+		friend class ComputePipeline;
 		static std::vector<char> readFile(const std::string &filepath);
 
 		void createGraphicsPipeline(
@@ -58,4 +59,27 @@ namespace VulkanEngine {
 		VkShaderModule fragShaderModule;
 	};
 
+	// a single compute shader, its layout is made by the caller like
+	// for the graphics pipeline
+	class ComputePipeline {
+
+	public:
+		ComputePipeline(
+			Device &device,
+			const std::string &compFilepath,
+			VkPipelineLayout pipelineLayout);
+
+		~ComputePipeline();
+
+		ComputePipeline(const ComputePipeline&) = delete;
+		ComputePipeline &operator=(const ComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+
+	private:
+		Device &device;
+		VkPipeline computePipeline;
+		VkShaderModule compShaderModule;
+	};
+
 }
@@ -1,4 +1,7 @@
 #include "simple_render_system.hpp"
+#include "swap_chain.hpp"
+#include "transform_batch.hpp"
+#include "trace.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -8,37 +11,82 @@
 #include <cassert>
 #include <stdexcept>
 #include <array>
+#include <cstring>
+#include <cstddef>
 
 namespace VulkanEngine {
 
-	struct SimplePushConstantData {
-		glm::mat2 matrix{1.0f};
-		glm::vec2 offset;
-		alignas(16) glm::vec3 color;
-	};
+	// the smallest object buffer, it at least doubles when it grows
+	static constexpr uint32_t MIN_OBJECTS = 1024;
+	// descriptor sets for the current buffer of each frame, and a few
+	// outgrown ones waiting for their frame to come around again
+	static constexpr uint32_t MAX_OBJECT_SETS = SwapChain::MAX_FRAMES_IN_FLIGHT * 8;
 
 	SimpleRenderSystem::SimpleRenderSystem(Device &device, VkRenderPass renderPass)
 		: device{device} {
+		createDescriptorSetLayout();
+		createDescriptorPool();
 		createPipelineLayout();
 		createPipeline(renderPass);
+
+		frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (auto &frame : frames) {
+			frame.current = createObjectBuffer(MIN_OBJECTS);
+		}
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem() {
+		for (auto &frame : frames) {
+			destroyObjectBuffer(frame.current);
+			for (auto &retired : frame.retired) {
+				destroyObjectBuffer(retired);
+			}
+		}
+		vkDestroyDescriptorPool(device.device(), descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(device.device(), descriptorSetLayout, nullptr);
 		vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
 	}
 
-	void SimpleRenderSystem::createPipelineLayout() {
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
+	void SimpleRenderSystem::createDescriptorSetLayout() {
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		if (vkCreateDescriptorSetLayout(device.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout");
+		}
+	}
+
+	void SimpleRenderSystem::createDescriptorPool() {
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = MAX_OBJECT_SETS;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		// sets are freed one at a time, along with their buffer
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		poolInfo.maxSets = MAX_OBJECT_SETS;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		if (vkCreateDescriptorPool(device.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool");
+		}
+	}
 
+	void SimpleRenderSystem::createPipelineLayout() {
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 0;
-		pipelineLayoutInfo.pSetLayouts = nullptr;
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
 		if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create pipeline layout");
 		}
@@ -57,33 +105,163 @@ namespace VulkanEngine {
 			pipelineConfig);
 	}
 
+	// host visible and mapped for as long as it lives, written by the CPU every frame
+	SimpleRenderSystem::ObjectBuffer SimpleRenderSystem::createObjectBuffer(uint32_t capacity) {
+		ObjectBuffer objectBuffer{};
+		objectBuffer.capacity = capacity;
+		VkDeviceSize size = sizeof(ObjectData) * capacity;
+		device.createBuffer(
+			size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			objectBuffer.buffer,
+			objectBuffer.memory);
+		vkMapMemory(device.device(), objectBuffer.memory, 0, size, 0, &objectBuffer.mapped);
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &descriptorSetLayout;
+		if (vkAllocateDescriptorSets(device.device(), &allocInfo, &objectBuffer.descriptorSet) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate object descriptor set");
+		}
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = objectBuffer.buffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = objectBuffer.descriptorSet;
+		write.dstBinding = 0;
+		write.dstArrayElement = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.descriptorCount = 1;
+		write.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(device.device(), 1, &write, 0, nullptr);
+		return objectBuffer;
+	}
+
+	void SimpleRenderSystem::destroyObjectBuffer(ObjectBuffer &objectBuffer) {
+		vkFreeDescriptorSets(device.device(), descriptorPool, 1, &objectBuffer.descriptorSet);
+		vkUnmapMemory(device.device(), objectBuffer.memory);
+		vkDestroyBuffer(device.device(), objectBuffer.buffer, nullptr);
+		vkFreeMemory(device.device(), objectBuffer.memory, nullptr);
+		objectBuffer = ObjectBuffer{};
+	}
+
+	// a command buffer recorded earlier this frame can have the current
+	// buffer (and its set) bound, neither can change until the frame is
+	// done. the new buffer starts from scratch, with only the new objects.
+	void SimpleRenderSystem::reserveObjects(FrameObjects &frame, uint32_t count) {
+		if (frame.used + count <= frame.current.capacity) return;
+
+		uint32_t capacity = frame.current.capacity * 2;
+		while (capacity < count) capacity *= 2;
+		if (frame.used == 0) {
+			destroyObjectBuffer(frame.current);
+		} else {
+			frame.retired.push_back(frame.current);
+		}
+		frame.current = createObjectBuffer(capacity);
+		frame.used = 0;
+	}
+
 	void SimpleRenderSystem::renderGameObjects(
 		VkCommandBuffer commandBuffer,
-		std::vector<GameObject> &gameObjects) {
-		static float frame = 0;
-		frame += 1;
+		int frameIndex,
+		const GameObjects &gameObjects) {
+		// the frame index moves on every frame, the first call with this
+		// one is after its fence was waited on, so its buffers are free again
+		FrameObjects &frameObjects = frames[frameIndex];
+		if (frameIndex != lastFrameIndex) {
+			for (auto &retired : frameObjects.retired) {
+				destroyObjectBuffer(retired);
+			}
+			frameObjects.retired.clear();
+			frameObjects.used = 0;
+			lastFrameIndex = frameIndex;
+		}
+		if (gameObjects.empty()) return;
+
+		uint32_t count = static_cast<uint32_t>(gameObjects.size());
+		reserveObjects(frameObjects, count);
+		uint32_t first = frameObjects.used;
+
+		// the matrices are worked out four at a time from the transform
+		// arrays, straight into the object data. which is then one copy
+		// into the mapped buffer.
+		std::vector<ObjectData> objectData(count);
+		{
+			TRACE_SCOPE("transforms");
+			static_assert(offsetof(ObjectData, offset) == sizeof(glm::mat2), "offset must follow the matrix");
+			computeTransforms2D(
+				gameObjects.rotation.data(),
+				gameObjects.scaleX.data(),
+				gameObjects.scaleY.data(),
+				gameObjects.translationX.data(),
+				gameObjects.translationY.data(),
+				count,
+				objectData.data(),
+				sizeof(ObjectData));
+			for (uint32_t i = 0; i < count; i++) {
+				objectData[i].color = gameObjects.colors[i];
+			}
+		}
+		memcpy(
+			static_cast<ObjectData *>(frameObjects.current.mapped) + first,
+			objectData.data(),
+			sizeof(ObjectData) * count);
+		frameObjects.used += count;
+
 		pipeline->bind(commandBuffer);
-		for (auto& obj: gameObjects) {
-			obj.transform2D.rotation = glm::mod(obj.transform2D.rotation + 0.01f, glm::two_pi<float>());
-			float scale = 1.0f + 0.5f * glm::sin(frame * 0.01f);
-			obj.transform2D.scale = { scale, scale };
-			obj.transform2D.translation.x = 0.2f * glm::sin(frame * 0.005f);
-
-			SimplePushConstantData push{};
-			push.offset = obj.transform2D.translation;
-			push.color = obj.color;
-			push.matrix = obj.transform2D.mat2();
-
-			vkCmdPushConstants(
-				commandBuffer,
-				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantData),
-				&push);
-			obj.model->bind(commandBuffer);
-			obj.model->draw(commandBuffer);
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0,
+			1,
+			&frameObjects.current.descriptorSet,
+			0,
+			nullptr);
+
+		// a run of objects with the same model is one instanced draw,
+		// firstInstance is where the run starts in the object buffer
+		uint32_t runStart = 0;
+		const auto &models = gameObjects.models;
+		for (uint32_t i = 1; i <= count; i++) {
+			if (i < count && models[i] == models[runStart]) continue;
+			auto &model = models[runStart];
+			if (model) {
+				model->bind(commandBuffer);
+				model->draw(commandBuffer, i - runStart, first + runStart);
+			}
+			runStart = i;
 		}
 	}
 
+	void SimpleRenderSystem::renderInstances(
+		VkCommandBuffer commandBuffer,
+		VkDescriptorSet objectSet,
+		Model &model,
+		uint32_t firstInstance,
+		uint32_t count) {
+		if (count == 0) return;
+
+		pipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0,
+			1,
+			&objectSet,
+			0,
+			nullptr);
+		model.bind(commandBuffer);
+		model.draw(commandBuffer, count, firstInstance);
+	}
+
 }
@@ -4,11 +4,23 @@
 #include "pipeline.hpp"
 #include "game_object.hpp"
 
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
 #include <memory>
 #include <vector>
 
 namespace VulkanEngine {
 
+	// one per object, read by the vertex shader at gl_InstanceIndex.
+	// std430, where a mat2 is two tightly packed vec2 columns.
+	struct ObjectData {
+		glm::mat2 matrix{1.0f};
+		glm::vec2 offset;
+		alignas(16) glm::vec3 color;
+	};
+
 	class SimpleRenderSystem {
 
 	public:
@@ -17,17 +29,63 @@ namespace VulkanEngine {
 
 		SimpleRenderSystem(const SimpleRenderSystem &) = delete;
 		SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
+		// every object's data is copied into the frame's object buffer in one
+		// go, then objects next to each other with the same model are drawn
+		// as instances of one draw. can be called more than once per frame.
 		void renderGameObjects(
 			VkCommandBuffer commandBuffer,
-			std::vector<GameObject> &gameObjects);
+			int frameIndex,
+			const GameObjects &gameObjects);
+
+		// draws count instances of model whose object data is already on the
+		// GPU, from firstInstance of the buffer objectSet points at. the set
+		// must have the object set layout, and whatever wrote the buffer must
+		// be finished with it before the vertex shader reads it.
+		void renderInstances(
+			VkCommandBuffer commandBuffer,
+			VkDescriptorSet objectSet,
+			Model &model,
+			uint32_t firstInstance,
+			uint32_t count);
+
+		// one storage buffer of ObjectData at binding 0
+		VkDescriptorSetLayout getObjectSetLayout() const { return descriptorSetLayout; }
 
 	private:
+		// a storage buffer of ObjectData, with the descriptor set which points at it
+		struct ObjectBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void *mapped = nullptr;
+			uint32_t capacity = 0;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		};
+
+		// the objects written so far this frame, and buffers it outgrew
+		// which its command buffer may still use
+		struct FrameObjects {
+			ObjectBuffer current;
+			uint32_t used = 0;
+			std::vector<ObjectBuffer> retired;
+		};
+
+		void createDescriptorSetLayout();
+		void createDescriptorPool();
 		void createPipelineLayout();
 		void createPipeline(VkRenderPass renderPass);
+		ObjectBuffer createObjectBuffer(uint32_t capacity);
+		void destroyObjectBuffer(ObjectBuffer &objectBuffer);
+		// room for count more objects in this frame
+		void reserveObjects(FrameObjects &frame, uint32_t count);
 
 		Device &device;
 		std::unique_ptr<Pipeline> pipeline;
 		VkPipelineLayout pipelineLayout;
+		VkDescriptorSetLayout descriptorSetLayout;
+		VkDescriptorPool descriptorPool;
+
+		std::vector<FrameObjects> frames;
+		int lastFrameIndex = -1;
 	};
 
 }
@@ -0,0 +1,77 @@
+#include "simulation_thread.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace VulkanEngine {
+
+	// how far behind the simulation can get before it stops trying to
+	// catch up, in steps
+	static constexpr uint64_t MAX_LAG_STEPS = 5;
+
+	SimulationThread::SimulationThread(float stepDelta, std::function<void(uint64_t)> step)
+		: stepDelta{stepDelta}, step{std::move(step)} {}
+
+	SimulationThread::~SimulationThread() {
+		running = false;
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	void SimulationThread::start() {
+		if (thread.joinable()) return;
+		error = nullptr;
+		dropped = 0;
+		startTime = Clock::now().time_since_epoch().count();
+		running = true;
+		thread = std::thread(&SimulationThread::run, this);
+	}
+
+	void SimulationThread::stop() {
+		running = false;
+		if (thread.joinable()) {
+			thread.join();
+		}
+		if (error) {
+			std::rethrow_exception(std::exchange(error, nullptr));
+		}
+	}
+
+	double SimulationThread::renderStep() const {
+		auto elapsed = Clock::now().time_since_epoch() - Clock::duration(startTime.load());
+		double steps = std::chrono::duration<double>(elapsed).count() / stepDelta;
+		return std::max(steps - 1.0, 0.0);
+	}
+
+	void SimulationThread::run() {
+		const auto stepDuration = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(stepDelta));
+		try {
+			for (uint64_t k = 1; running; k++) {
+				{
+					TRACE_SCOPE("simulation step");
+					step(k);
+				}
+
+				// step k + 1 is due k steps after the start
+				auto due = Clock::time_point(Clock::duration(startTime.load())) + stepDuration * k;
+				auto now = Clock::now();
+				if (now > due + stepDuration * MAX_LAG_STEPS) {
+					// too far behind, start again from now as if the
+					// simulation had been paused for the difference
+					auto behind = now - due;
+					dropped += static_cast<uint64_t>(behind / stepDuration);
+					startTime += behind.count();
+				} else {
+					std::this_thread::sleep_until(due);
+				}
+			}
+		} catch (...) {
+			error = std::current_exception();
+			running = false;
+		}
+	}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace VulkanEngine {
+
+	// runs a simulation on its own thread at a fixed rate, whatever the
+	// frame rate. step k (from 1) starts at k - 1 steps of wall time after
+	// start, so the state it ends at is ready about when its time comes.
+	//
+	// the renderer draws renderStep() steps into the simulation, which is a
+	// step behind the wall clock: between the two latest states, which is
+	// where it interpolates. the step passes what it produces on, usually
+	// through a TripleBuffer.
+	class SimulationThread {
+
+	public:
+		// step(k) moves the simulation from step k - 1 to step k, stepDelta
+		// seconds on. it is only ever called on the simulation thread.
+		SimulationThread(float stepDelta, std::function<void(uint64_t)> step);
+		// stops, without rethrowing what the step threw
+		~SimulationThread();
+
+		SimulationThread(const SimulationThread &) = delete;
+		SimulationThread &operator=(const SimulationThread &) = delete;
+
+		const float stepDelta;
+
+		void start();
+		// waits for the step being worked on. if a step threw, the
+		// simulation stopped there and it is thrown here.
+		void stop();
+
+		// steps since the start, one behind the wall clock. fractional,
+		// between the two steps to interpolate between.
+		double renderStep() const;
+
+		// steps the simulation fell too far behind to catch up on. their
+		// time is dropped, so it runs slower than the wall clock instead.
+		uint64_t droppedSteps() const { return dropped.load(); }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void run();
+
+		std::function<void(uint64_t)> step;
+		std::thread thread;
+		std::atomic<bool> running{false};
+		// when step 1 started, moved on by however long was dropped
+		std::atomic<Clock::rep> startTime{0};
+		std::atomic<uint64_t> dropped{0};
+		std::exception_ptr error;
+	};
+
+}
@@ -1,4 +1,5 @@
 #include "swap_chain.hpp"
+#include "trace.hpp"
 
 // std
 #include <array>
@@ -63,13 +64,17 @@ namespace VulkanEngine {
 	}
 
 	VkResult SwapChain::acquireNextImage(uint32_t *imageIndex) {
-		vkWaitForFences(
-				device.device(),
-				1,
-				&inFlightFences[currentFrame],
-				VK_TRUE,
-				std::numeric_limits<uint64_t>::max());
+		{
+			TRACE_SCOPE("fence wait");
+			vkWaitForFences(
+					device.device(),
+					1,
+					&inFlightFences[currentFrame],
+					VK_TRUE,
+					std::numeric_limits<uint64_t>::max());
+		}
 
+		TRACE_SCOPE("acquire");
 		VkResult result = vkAcquireNextImageKHR(
 				device.device(),
 				swapChain,
@@ -105,9 +110,12 @@ namespace VulkanEngine {
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
 		vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-		if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-				VK_SUCCESS) {
-			throw std::runtime_error("failed to submit draw command buffer!");
+		{
+			TRACE_SCOPE("submit");
+			if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+					VK_SUCCESS) {
+				throw std::runtime_error("failed to submit draw command buffer!");
+			}
 		}
 
 		VkPresentInfoKHR presentInfo = {};
@@ -122,7 +130,11 @@ namespace VulkanEngine {
 
 		presentInfo.pImageIndices = imageIndex;
 
-		auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+		VkResult result;
+		{
+			TRACE_SCOPE("present");
+			result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+		}
 
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -0,0 +1,101 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace VulkanEngine {
+
+	size_t ThreadPool::defaultThreadCount() {
+		// hardware_concurrency may not know, and counts the calling thread
+		unsigned int cores = std::thread::hardware_concurrency();
+		return cores > 1 ? cores - 1 : 1;
+	}
+
+	ThreadPool::ThreadPool(size_t threadCount) {
+		threads.reserve(threadCount);
+		for (size_t i = 0; i < threadCount; i++) {
+			threads.emplace_back(&ThreadPool::work, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto &thread : threads) {
+			thread.join();
+		}
+	}
+
+	void ThreadPool::work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty()) return;
+
+			std::function<void()> task = std::move(tasks.front());
+			tasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	// every thread taking part takes the next index until there are none
+	// left, so uneven jobs balance out
+	void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &job) {
+		if (count == 0) return;
+
+		struct Batch {
+			std::atomic<size_t> next{0};
+			std::atomic<bool> failed{false};
+			std::exception_ptr error;
+			std::mutex mutex;
+			std::condition_variable done;
+			size_t running = 0;
+		};
+		auto batch = std::make_shared<Batch>();
+
+		auto run = [batch, count, &job]() {
+			while (!batch->failed) {
+				size_t index = batch->next++;
+				if (index >= count) break;
+				try {
+					job(index);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(batch->mutex);
+					if (!batch->error) batch->error = std::current_exception();
+					batch->failed = true;
+				}
+			}
+		};
+
+		// the calling thread is one of the helpers, so at most count - 1 tasks
+		size_t helpers = std::min(threads.size(), count - 1);
+		batch->running = helpers;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 0; i < helpers; i++) {
+				tasks.push_back([batch, run]() {
+					run();
+					std::lock_guard<std::mutex> lock(batch->mutex);
+					if (--batch->running == 0) batch->done.notify_one();
+				});
+			}
+		}
+		wake.notify_all();
+
+		run();
+		{
+			// job is a reference to the caller's, which has to outlive every task
+			std::unique_lock<std::mutex> lock(batch->mutex);
+			batch->done.wait(lock, [&batch] { return batch->running == 0; });
+		}
+		if (batch->error) std::rethrow_exception(batch->error);
+	}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VulkanEngine {
+
+	// a fixed number of worker threads, for CPU work which splits into
+	// independent pieces, like the bodies of a physics step
+	class ThreadPool {
+
+	public:
+		// one thread per core by default, the calling thread makes one more
+		// while it waits in parallelFor
+		explicit ThreadPool(size_t threadCount = defaultThreadCount());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		// job(0) to job(count - 1), in any order, on the workers and the calling
+		// thread. returns once all of them are done. if any throw, the rest
+		// are skipped and the first exception is thrown here.
+		void parallelFor(size_t count, const std::function<void(size_t)> &job);
+
+		size_t getThreadCount() const { return threads.size(); }
+		static size_t defaultThreadCount();
+
+	private:
+		void work();
+
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::deque<std::function<void()>> tasks;
+		bool stopping = false;
+	};
+
+}
@@ -0,0 +1,145 @@
+#include "transform_batch.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_BATCH_SSE2
+#endif
+
+namespace VulkanEngine {
+
+	// 4 / pi
+	static constexpr float FOPI = 1.27323954473516f;
+	// pi / 4 in three parts, for an exact range reduction
+	static constexpr float DP1 = 0.78515625f;
+	static constexpr float DP2 = 2.4187564849853515625e-4f;
+	static constexpr float DP3 = 3.77489497744594108e-8f;
+	// sin(x) = x + x^3 * (S0 x^4 + S1 x^2 + S2) on [-pi/4, pi/4]
+	static constexpr float S0 = -1.9515295891e-4f;
+	static constexpr float S1 = 8.3321608736e-3f;
+	static constexpr float S2 = -1.6666654611e-1f;
+	// cos(x) = 1 - x^2 / 2 + x^4 * (C0 x^4 + C1 x^2 + C2)
+	static constexpr float C0 = 2.443315711809948e-5f;
+	static constexpr float C1 = -1.388731625493765e-3f;
+	static constexpr float C2 = 4.166664568298827e-2f;
+
+	// the angle is reduced to r in [-pi/4, pi/4] around the nearest
+	// multiple j of pi/4 (j even). j & 2 swaps which polynomial is sin and
+	// which cos, j & 4 flips the signs.
+	static void sinCos(float x, float &sine, float &cosine) {
+		float ax = std::fabs(x);
+		int32_t j = static_cast<int32_t>(ax * FOPI);
+		j = (j + 1) & ~1;
+		float y = static_cast<float>(j);
+		float r = ((ax - y * DP1) - y * DP2) - y * DP3;
+		float z = r * r;
+
+		float polyCos = ((C0 * z + C1) * z + C2) * z * z - 0.5f * z + 1.0f;
+		float polySin = ((S0 * z + S1) * z + S2) * z * r + r;
+
+		bool swap = (j & 2) != 0;
+		float s = swap ? polyCos : polySin;
+		float c = swap ? polySin : polyCos;
+		if (((j & 4) != 0) != (x < 0.0f)) s = -s;
+		if (((j - 2) & 4) == 0) c = -c;
+		sine = s;
+		cosine = c;
+	}
+
+#ifdef TRANSFORM_BATCH_SSE2
+	// the same as sinCos, four lanes at once. the branches become masks.
+	static void sinCos4(__m128 x, __m128 &sine, __m128 &cosine) {
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(INT32_MIN));
+		__m128 signSin = _mm_and_ps(x, signMask);
+		__m128 ax = _mm_andnot_ps(signMask, x);
+
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(FOPI)));
+		j = _mm_add_epi32(j, _mm_set1_epi32(1));
+		j = _mm_and_si128(j, _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(j);
+
+		// j & 4 flips the sign of sin, (j - 2) & 4 == 0 flips cos
+		__m128 flipSin = _mm_castsi128_ps(
+			_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+		__m128 flipCos = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		// lanes where the polynomials trade places
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+			_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+		__m128 r = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+		r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+		r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+		__m128 z = _mm_mul_ps(r, r);
+
+		__m128 polyCos = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(C0), z), _mm_set1_ps(C1));
+		polyCos = _mm_add_ps(_mm_mul_ps(polyCos, z), _mm_set1_ps(C2));
+		polyCos = _mm_mul_ps(_mm_mul_ps(polyCos, z), z);
+		polyCos = _mm_sub_ps(polyCos, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		polyCos = _mm_add_ps(polyCos, _mm_set1_ps(1.0f));
+
+		__m128 polySin = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(S0), z), _mm_set1_ps(S1));
+		polySin = _mm_add_ps(_mm_mul_ps(polySin, z), _mm_set1_ps(S2));
+		polySin = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(polySin, z), r), r);
+
+		__m128 s = _mm_or_ps(_mm_and_ps(swap, polyCos), _mm_andnot_ps(swap, polySin));
+		__m128 c = _mm_or_ps(_mm_and_ps(swap, polySin), _mm_andnot_ps(swap, polyCos));
+		sine = _mm_xor_ps(s, _mm_xor_ps(signSin, flipSin));
+		cosine = _mm_xor_ps(c, flipCos);
+	}
+#endif
+
+	void sinCosBatch(const float *angles, float *sines, float *cosines, size_t count) {
+		size_t i = 0;
+#ifdef TRANSFORM_BATCH_SSE2
+		for (; i + 4 <= count; i += 4) {
+			__m128 s, c;
+			sinCos4(_mm_loadu_ps(angles + i), s, c);
+			_mm_storeu_ps(sines + i, s);
+			_mm_storeu_ps(cosines + i, c);
+		}
+#endif
+		for (; i < count; i++) {
+			sinCos(angles[i], sines[i], cosines[i]);
+		}
+	}
+
+	void computeTransforms2D(
+		const float *rotation,
+		const float *scaleX,
+		const float *scaleY,
+		const float *translationX,
+		const float *translationY,
+		size_t count,
+		void *out,
+		size_t stride) {
+		// the sines and cosines of a block stay in the L1 cache
+		constexpr size_t BLOCK = 256;
+		float sines[BLOCK];
+		float cosines[BLOCK];
+
+		uint8_t *dst = static_cast<uint8_t *>(out);
+		for (size_t first = 0; first < count; first += BLOCK) {
+			size_t n = count - first < BLOCK ? count - first : BLOCK;
+			sinCosBatch(rotation + first, sines, cosines, n);
+
+			for (size_t k = 0; k < n; k++) {
+				size_t i = first + k;
+				// rotation * scale, column major like glm
+				float transform[6] = {
+					cosines[k] * scaleX[i],
+					sines[k] * scaleX[i],
+					-sines[k] * scaleY[i],
+					cosines[k] * scaleY[i],
+					translationX[i],
+					translationY[i],
+				};
+				memcpy(dst + i * stride, transform, sizeof(transform));
+			}
+		}
+	}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+namespace VulkanEngine {
+
+	// sine and cosine of every angle, four at a time with SSE2 and one at a
+	// time otherwise, with the same polynomials either way (Cephes' sinf and
+	// cosf). good to a couple of ulp for angles below about 8192 in magnitude.
+	void sinCosBatch(const float *angles, float *sines, float *cosines, size_t count);
+
+	// the 2d transform of count objects, from one array per field.
+	// each object gets six floats at out + i * stride (in bytes): the two
+	// columns of rotation * scale, then the translation. which is how a
+	// glm::mat2 followed by a glm::vec2 is laid out, in a struct or std430.
+	void computeTransforms2D(
+		const float *rotation,
+		const float *scaleX,
+		const float *scaleY,
+		const float *translationX,
+		const float *translationY,
+		size_t count,
+		void *out,
+		size_t stride);
+
+}
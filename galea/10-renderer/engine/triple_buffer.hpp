@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <utility>
+
+namespace VulkanEngine {
+
+	// hands the latest of a stream of values from one thread to another,
+	// neither waiting for the other. the writer fills back() and publishes
+	// it, the reader acquires whichever was published last and keeps it
+	// until it acquires again. values in between are skipped.
+	//
+	// three buffers: the writer's, the reader's, and the latest in the
+	// middle, which only changes hands under the lock. a T is never copied,
+	// so the writer gets back buffers with whatever they held before and
+	// their memory can be reused.
+	template <typename T>
+	class TripleBuffer {
+
+	public:
+		TripleBuffer() = default;
+
+		TripleBuffer(const TripleBuffer &) = delete;
+		TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+		// the writer's, nothing else touches it until publish
+		T &back() { return buffers[backIndex]; }
+
+		// back becomes the latest, and the writer gets another back
+		void publish() {
+			std::lock_guard<std::mutex> lock(mutex);
+			std::swap(backIndex, middleIndex);
+			fresh = true;
+		}
+
+		// the latest published, which stays the reader's until the next
+		// acquire. the same as last time if nothing was published since.
+		const T &acquire() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (fresh) {
+				std::swap(frontIndex, middleIndex);
+				fresh = false;
+			}
+			return buffers[frontIndex];
+		}
+
+	private:
+		std::array<T, 3> buffers{};
+		std::mutex mutex;
+		int backIndex = 0;
+		int middleIndex = 1;
+		int frontIndex = 2;
+		// the middle buffer was published since the reader last took it
+		bool fresh = false;
+	};
+
+}
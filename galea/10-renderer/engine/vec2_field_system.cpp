@@ -0,0 +1,156 @@
+#include "vec2_field_system.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace VulkanEngine {
+
+	// This scales the length of the field line based on the log of the length
+	// values were chosen just through trial and error based on what i liked the look
+	// of and then the field line is rotated to point in the direction of the field
+	static void pointAlong(GameObjects &vectorField, size_t i, glm::vec2 direction) {
+		vectorField.scaleX[i] =
+			0.005f + 0.045f * glm::clamp(glm::log(glm::length(direction) + 1) / 3.f, 0.f, 1.f);
+		vectorField.rotation[i] = std::atan2(direction.y, direction.x);
+	}
+
+	void Vec2FieldSystem::update(
+		const GravityPhysicsSystem &physicsSystem,
+		const GameObjects &physicsObjs,
+		GameObjects &vectorField) {
+		TRACE_SCOPE("vector field");
+		if (mode == Mode::ParticleMesh) {
+			updateParticleMesh(physicsSystem, physicsObjs, vectorField);
+		} else {
+			updateExact(physicsSystem, physicsObjs, vectorField);
+		}
+	}
+
+	void Vec2FieldSystem::updateExact(
+		const GravityPhysicsSystem &physicsSystem,
+		const GameObjects &physicsObjs,
+		GameObjects &vectorField) {
+		// For each field line we caluclate the net graviation force for that point in space
+		for (size_t i = 0; i < vectorField.size(); i++) {
+			glm::vec2 direction = physicsSystem.computeForceAt(
+				physicsObjs,
+				{vectorField.translationX[i], vectorField.translationY[i]},
+				vectorField.mass[i]);
+			pointAlong(vectorField, i, direction);
+		}
+	}
+
+	// an offset of dx, dy cells is at index dx, dy of the padded grid,
+	// negative ones wrap around to the end. the largest offset between two
+	// nodes is gridSize - 1 either way, so index gridSize is never used.
+	void Vec2FieldSystem::createKernel() {
+		if (gridSize < 8 || (gridSize & (gridSize - 1)) != 0) {
+			throw std::runtime_error("vector field grid size must be a power of 2 of at least 8");
+		}
+		size_t n = 2 * gridSize;
+		fft = std::make_unique<FFT>(n);
+		kernel.assign(n * n, {0.0f, 0.0f});
+		mesh.resize(n * n);
+
+		int size = static_cast<int>(gridSize);
+		for (size_t row = 0; row < n; row++) {
+			int dy = static_cast<int>(row) < size ? static_cast<int>(row) : static_cast<int>(row) - 2 * size;
+			for (size_t col = 0; col < n; col++) {
+				int dx = static_cast<int>(col) < size ? static_cast<int>(col) : static_cast<int>(col) - 2 * size;
+				if ((dx == 0 && dy == 0) || row == gridSize || col == gridSize) continue;
+				// a mass at offset (dx, dy) from a point pulls it back along -(dx, dy)
+				float distanceSquared = static_cast<float>(dx * dx + dy * dy);
+				float scale = -1.0f / (distanceSquared * std::sqrt(distanceSquared));
+				kernel[row * n + col] = {scale * dx, scale * dy};
+			}
+		}
+		fft->transform2D(kernel.data(), false);
+	}
+
+	void Vec2FieldSystem::updateParticleMesh(
+		const GravityPhysicsSystem &physicsSystem,
+		const GameObjects &physicsObjs,
+		GameObjects &vectorField) {
+		if (vectorField.empty()) return;
+		if (physicsObjs.empty()) {
+			for (size_t i = 0; i < vectorField.size(); i++) {
+				pointAlong(vectorField, i, {0.0f, 0.0f});
+			}
+			return;
+		}
+		if (!fft || fft->size() != 2 * gridSize) {
+			createKernel();
+		}
+		const size_t n = fft->size();
+
+		// a square around every object and point. with a cell to spare on
+		// each side, everything is at least one node from the edge, and
+		// the four nodes around it are on the grid.
+		float minX = physicsObjs.translationX[0];
+		float minY = physicsObjs.translationY[0];
+		float maxX = minX;
+		float maxY = minY;
+		auto include = [&](const GameObjects &objs) {
+			for (size_t i = 0; i < objs.size(); i++) {
+				minX = std::min(minX, objs.translationX[i]);
+				maxX = std::max(maxX, objs.translationX[i]);
+				minY = std::min(minY, objs.translationY[i]);
+				maxY = std::max(maxY, objs.translationY[i]);
+			}
+		};
+		include(physicsObjs);
+		include(vectorField);
+		float extent = std::max(std::max(maxX - minX, maxY - minY), 1e-6f);
+		float cellSize = extent / (gridSize - 3);
+		float originX = minX - cellSize;
+		float originY = minY - cellSize;
+
+		// cloud in cell: each mass is shared between the four nodes around
+		// it, by how close it is to each
+		std::fill(mesh.begin(), mesh.end(), std::complex<float>{0.0f, 0.0f});
+		for (size_t i = 0; i < physicsObjs.size(); i++) {
+			float x = (physicsObjs.translationX[i] - originX) / cellSize;
+			float y = (physicsObjs.translationY[i] - originY) / cellSize;
+			size_t col = static_cast<size_t>(x);
+			size_t row = static_cast<size_t>(y);
+			float fx = x - col;
+			float fy = y - row;
+			float mass = physicsObjs.mass[i];
+			mesh[row * n + col] += mass * (1 - fx) * (1 - fy);
+			mesh[row * n + col + 1] += mass * fx * (1 - fy);
+			mesh[(row + 1) * n + col] += mass * (1 - fx) * fy;
+			mesh[(row + 1) * n + col + 1] += mass * fx * fy;
+		}
+
+		// the convolution is a product of the transforms. the kernel is in
+		// cells, a real distance is cellSize times as far, so the pull is
+		// cellSize^2 times weaker.
+		fft->transform2D(mesh.data(), false);
+		for (size_t i = 0; i < n * n; i++) {
+			mesh[i] = complexMultiply(mesh[i], kernel[i]);
+		}
+		fft->transform2D(mesh.data(), true);
+		float strength = physicsSystem.strengthGravity / (cellSize * cellSize);
+
+		// each point reads the pull off the four nodes around it, with the
+		// same weights as the masses were spread with
+		for (size_t i = 0; i < vectorField.size(); i++) {
+			float x = (vectorField.translationX[i] - originX) / cellSize;
+			float y = (vectorField.translationY[i] - originY) / cellSize;
+			size_t col = static_cast<size_t>(x);
+			size_t row = static_cast<size_t>(y);
+			float fx = x - col;
+			float fy = y - row;
+			std::complex<float> pull =
+				mesh[row * n + col] * ((1 - fx) * (1 - fy)) +
+				mesh[row * n + col + 1] * (fx * (1 - fy)) +
+				mesh[(row + 1) * n + col] * ((1 - fx) * fy) +
+				mesh[(row + 1) * n + col + 1] * (fx * fy);
+			float scale = strength * vectorField.mass[i];
+			pointAlong(vectorField, i, {scale * pull.real(), scale * pull.imag()});
+		}
+	}
+
+}
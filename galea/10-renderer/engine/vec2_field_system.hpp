@@ -0,0 +1,62 @@
+#pragma once
+
+#include "game_object.hpp"
+#include "gravity_physics_system.hpp"
+#include "fft.hpp"
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace VulkanEngine {
+
+	// points every object of the field in the direction of the net
+	// gravitational force where it is, longer where the force is stronger
+	class Vec2FieldSystem {
+	public:
+		enum class Mode {
+			// every physics object's pull on every point, through the
+			// physics system (so with its Barnes-Hut tree if it has one).
+			// O(objects * points), the reference for the mesh.
+			Exact,
+			// particle-mesh. the objects' mass is spread onto a square grid
+			// over them and the field, the grid is convolved with the pull of
+			// a unit mass by FFT, and each point reads the force off the grid
+			// around it. O(G^2 log G) for a G by G grid, plus O(objects +
+			// points). smooth below about two grid cells, so close to an
+			// object the force is weaker than it should be.
+			ParticleMesh,
+		};
+
+		Mode mode = Mode::Exact;
+		// nodes along each side of the grid, a power of 2 of at least 8
+		uint32_t gridSize = 64;
+
+		void update(
+			const GravityPhysicsSystem &physicsSystem,
+			const GameObjects &physicsObjs,
+			GameObjects &vectorField);
+
+	private:
+		void updateExact(
+			const GravityPhysicsSystem &physicsSystem,
+			const GameObjects &physicsObjs,
+			GameObjects &vectorField);
+		void updateParticleMesh(
+			const GravityPhysicsSystem &physicsSystem,
+			const GameObjects &physicsObjs,
+			GameObjects &vectorField);
+		// the transform of the pull of a unit mass, for gridSize
+		void createKernel();
+
+		// the grid is padded to twice its size with zeros, so that the
+		// convolution (which wraps around) has no images of the objects
+		std::unique_ptr<FFT> fft;
+		// the pull at every offset of whole grid cells, as x + i y, transformed
+		std::vector<std::complex<float>> kernel;
+		// mass, then its transform, then the pull, as x + i y
+		std::vector<std::complex<float>> mesh;
+	};
+
+}
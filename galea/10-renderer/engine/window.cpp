@@ -1,4 +1,6 @@
 #include "window.hpp"
+#include "trace.hpp"
+#include <iostream>
 #include <stdexcept>
 
 namespace VulkanEngine {
@@ -23,6 +25,7 @@ namespace VulkanEngine {
 		window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
 		glfwSetWindowUserPointer(window, this);
 		glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+		glfwSetKeyCallback(window, keyCallback);
 	}
 
 	void Window::createWindowSurface(
@@ -40,4 +43,16 @@ namespace VulkanEngine {
 		new_window->height = height;
 	}
 
+	// press F12 at any time to write the recent CPU timings to a file
+	void Window::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+		if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+			const char *path = "trace.json";
+			if (Trace::writeChromeTrace(path)) {
+				std::cout << "wrote " << path << ", open it in about://tracing or ui.perfetto.dev" << std::endl;
+			} else {
+				std::cout << "failed to write " << path << std::endl;
+			}
+		}
+	}
+
 }
@@ -34,6 +34,12 @@ namespace VulkanEngine {
 			GLFWwindow *window,
 			int width,
 			int height);
+		static void keyCallback(
+			GLFWwindow *window,
+			int key,
+			int scancode,
+			int action,
+			int mods);
 		void initWindow();
 
 		int width;
@@ -1,13 +1,31 @@
 #include "app.hpp"
+#include "app-gravity.hpp"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-	VulkanEngine::App app{};
-
+// ./a.out                                 the spinning triangle
+// ./a.out gravity [--gpu] [--validate N]  two bodies and their vector field
+int main(int argc, char **argv) {
 	try {
-		app.run();
+		if (argc > 1 && strcmp(argv[1], "gravity") == 0) {
+			VulkanEngine::GravityApp::Options options{};
+			for (int i = 2; i < argc; i++) {
+				if (strcmp(argv[i], "--gpu") == 0) {
+					options.gpu = true;
+				} else if (strcmp(argv[i], "--validate") == 0 && i + 1 < argc) {
+					options.validateEvery = atoi(argv[++i]);
+				} else {
+					throw std::runtime_error(std::string("unknown option ") + argv[i]);
+				}
+			}
+			VulkanEngine::GravityApp app{options};
+			app.run();
+		} else {
+			VulkanEngine::App app{};
+			app.run();
+		}
 	} catch (const std::exception &e) {
 		std::cerr << e.what() << std::endl;
 		return EXIT_FAILURE;
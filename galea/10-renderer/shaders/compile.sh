@@ -1,2 +1,4 @@
 /Library/VulkanSDK/1.3.268.1/macOS/bin/glslc simple.vert -o simple.vert.spv
 /Library/VulkanSDK/1.3.268.1/macOS/bin/glslc simple.frag -o simple.frag.spv
+/Library/VulkanSDK/1.3.268.1/macOS/bin/glslc gravity.comp -o gravity.comp.spv
+/Library/VulkanSDK/1.3.268.1/macOS/bin/glslc vec2_field.comp -o vec2_field.comp.spv
@@ -3,12 +3,21 @@
 layout(location = 0) in vec2 position;
 layout(location = 1) in vec3 color;
 
-layout(push_constant) uniform Push {
+layout(location = 0) flat out vec3 objectColor;
+
+// one per object, the draw's firstInstance is where its objects start
+struct ObjectData {
 	mat2 matrix;
 	vec2 offset;
 	vec3 color;
-} push;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Objects {
+	ObjectData objects[];
+};
 
 void main() {
-	gl_Position = vec4(push.matrix * position + push.offset, 0.0, 1.0);
+	ObjectData object = objects[gl_InstanceIndex];
+	gl_Position = vec4(object.matrix * position + object.offset, 0.0, 1.0);
+	objectColor = object.color;
 }
@@ -3,14 +3,22 @@
 
 # script to compile shaders into .spv format
 
-# Compile all .vert and .frag files in shaders/
+# Compile all .vert and .frag files in each examples/*/shaders/
 GLSLC=/Library/VulkanSDK/1.4.309.0/macOS/bin/glslc
 # GLSLC=$VULKAN_SDK/macOS/bin/glslc
-SHADERS_DIR=shaders
+for SHADERS_DIR in examples/*/shaders; do
+  for shader in $SHADERS_DIR/*.{vert,frag}; do
+    if [ -f "$shader" ]; then
+      filename=$(basename -- "$shader")
+      ${GLSLC} "$shader" -o "$SHADERS_DIR/${filename}.spv"
+    fi
+  done
+done
 
-for shader in $SHADERS_DIR/*.{vert,frag}; do
+# compute shaders used by the engine itself
+for shader in engine/shaders/*.comp; do
   if [ -f "$shader" ]; then
     filename=$(basename -- "$shader")
-    ${GLSLC} "$shader" -o "$SHADERS_DIR/${filename}.spv"
+    ${GLSLC} "$shader" -o "engine/shaders/${filename}.spv"
   fi
 done
@@ -1,13 +1,30 @@
 #include <stdexcept>
 #include "Engine.h"
+#include "profile/Trace.h"
 
-Engine::Engine() {
+// press F12 at any time to write the recent CPU timings to a file
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+    const char* path = "trace.json";
+    if (Trace::writeChromeTrace(path)) {
+      std::cout << "[INFO] wrote " << path << ", open it in about://tracing or ui.perfetto.dev" << std::endl;
+    } else {
+      std::cout << "[INFO] failed to write " << path << std::endl;
+    }
+  }
+}
+
+Engine::Engine(const EngineConfig& config) : config(config) {
   initWindow();
 
-  device = new Device(window, appName, engineName);
+  device = new Device(window, config.appName, engineName);
   buffers = new Buffers(*device);
-  swapChain = new SwapChain(*device);
-  renderer = new Renderer(*device, *swapChain, *buffers);
+  swapChain = new SwapChain(*device, config.vsync);
+  RendererOptions rendererOptions;
+  rendererOptions.depthPrepass = config.depthPrepass;
+  rendererOptions.occlusionCulling = config.occlusionCulling;
+  rendererOptions.computeMipmaps = config.computeMipmaps;
+  renderer = new Renderer(*device, *swapChain, *buffers, rendererOptions);
 }
 
 Engine::~Engine() {
@@ -21,14 +38,24 @@ Engine::~Engine() {
 }
 
 void Engine::startLoop() {
-  while (!glfwWindowShouldClose(window)) {
-    glfwPollEvents();
-    renderer->drawFrame();
-  }
+  while (runFrame()) {}
 
   vkDeviceWaitIdle(device->getDevice());
 }
 
+bool Engine::runFrame() {
+  if (glfwWindowShouldClose(window)) {
+    return false;
+  }
+  TRACE_SCOPE("frame");
+  {
+    TRACE_SCOPE("poll events");
+    glfwPollEvents();
+  }
+  renderer->drawFrame();
+  return true;
+}
+
 void Engine::initWindow() {
   if (!glfwInit()) {
     throw std::runtime_error("failed to initialize GLFW");
@@ -42,9 +69,15 @@ void Engine::initWindow() {
   // otherwise, this is how we can force disable window-resizing.
   // glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
-  window = glfwCreateWindow(WIDTH, HEIGHT, appName, nullptr, nullptr);
+  if (!config.visible) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
+
+  window = glfwCreateWindow(config.width, config.height, config.appName, nullptr, nullptr);
 
   if (!window) {
     throw std::runtime_error("failed to create window");
   }
+
+  glfwSetKeyCallback(window, keyCallback);
 }
@@ -7,12 +7,36 @@
 #include "core/SwapChain.h"
 #include "render/Renderer.h"
 
+struct EngineConfig {
+  const char* appName = "Vulkan App";
+  uint32_t width = 512;
+  uint32_t height = 512;
+  // a swap chain needs a surface, so there is always a window, but it
+  // can be hidden, which is as close to headless as we can get for now.
+  bool visible = true;
+  bool vsync = true;
+  // draw depth for everything first, then shade only the visible surfaces
+  bool depthPrepass = false;
+  // skip objects hidden behind others (and outside the view) on the GPU
+  bool occlusionCulling = false;
+  // texture mip chains from a compute shader instead of blits
+  bool computeMipmaps = false;
+};
+
 class Engine {
 public:
-  Engine();
+  Engine(const EngineConfig& config = EngineConfig{});
   ~Engine();
 
   void startLoop();
+  // poll events and draw a single frame.
+  // returns false once the window has been asked to close.
+  bool runFrame();
+
+  Renderer& getRenderer() { return *renderer; }
+
+  // GPU timings, see GpuProfiler::setLogInterval for a periodic log
+  GpuProfiler& getGpuProfiler() { return renderer->getGpuProfiler(); }
 
 private:
   void initWindow();
@@ -26,9 +50,7 @@ private:
 
   bool framebufferResized = false;
 
- 	const char *appName = "Vulkan App";
+  EngineConfig config;
   const char *engineName = "Vulkan Engine";
-  const uint32_t WIDTH = 512;
-  const uint32_t HEIGHT = 512;
 };
 
@@ -0,0 +1,20 @@
+#include "DeletionQueue.h"
+
+void DeletionQueue::push(uint64_t frame, std::function<void()> destroy) {
+  entries.push_back({ frame, std::move(destroy) });
+}
+
+void DeletionQueue::collect(uint64_t frame) {
+  lastFrame = frame;
+  while (!entries.empty() && entries.front().frame + framesInFlight <= frame) {
+    entries.front().destroy();
+    entries.pop_front();
+  }
+}
+
+void DeletionQueue::flush() {
+  while (!entries.empty()) {
+    entries.front().destroy();
+    entries.pop_front();
+  }
+}
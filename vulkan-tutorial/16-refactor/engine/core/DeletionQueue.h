@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// destroys things the GPU may still be using, once it can't be anymore.
+// something replaced while recording frame N can still be in use by the
+// frames before it which are in flight, it is safe to destroy once the
+// fence of every one of them has been waited on.
+class DeletionQueue {
+public:
+  explicit DeletionQueue(uint32_t framesInFlight) : framesInFlight(framesInFlight) {}
+  ~DeletionQueue() { flush(); }
+
+  // frame is a count of frames so far, not an index into the frames in flight
+  void push(uint64_t frame, std::function<void()> destroy);
+  // in the frame last collected, for code which does not know the frame
+  // number, like the last release of a shared asset
+  void push(std::function<void()> destroy) { push(lastFrame, std::move(destroy)); }
+  // call after waiting on the fence for this frame
+  void collect(uint64_t frame);
+  // everything, the device must be idle
+  void flush();
+
+  size_t size() const { return entries.size(); }
+
+  DeletionQueue(const DeletionQueue&) = delete;
+  DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+private:
+  struct Entry {
+    uint64_t frame;
+    std::function<void()> destroy;
+  };
+
+  uint32_t framesInFlight;
+  uint64_t lastFrame = 0;
+  // in the order they were pushed, which is also the order of frames
+  std::deque<Entry> entries;
+};
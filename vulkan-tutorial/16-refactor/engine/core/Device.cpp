@@ -1,4 +1,5 @@
 #include "Device.h"
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
 
@@ -129,6 +130,7 @@ void Device::pickPhysicalDevice() {
       //   break;
       // }
       physicalDevice = deviceCandidate;
+      properties = deviceProperties;
 
       // the number of multisample anti-aliasing possible
       // on both color and depth buffers
@@ -205,6 +207,31 @@ void Device::createLogicalDevice() {
   // multisampling
   deviceFeatures.sampleRateShading = VK_TRUE;
 
+  // optional features, only enabled when available
+  VkPhysicalDeviceFeatures supportedFeatures{};
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  // used for profiling, counting vertices, primitives, shader invocations
+  deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+  pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+  // the GPU culling's indirect draws pass each object's index as firstInstance
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+  drawIndirectFirstInstanceEnabled = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
+  // optional extensions, also only enabled when available
+  std::vector<const char*> enabledExtensions = deviceExtensions;
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+  for (const auto& extension : availableExtensions) {
+    // the mip generator writes sRGB images through UNORM storage views,
+    // the sRGB views which sample them must leave out the storage usage
+    if (strcmp(extension.extensionName, VK_KHR_MAINTENANCE_2_EXTENSION_NAME) == 0) {
+      enabledExtensions.push_back(VK_KHR_MAINTENANCE_2_EXTENSION_NAME);
+      imageViewUsageEnabled = true;
+    }
+  }
+
 	// When we create the device, provide this struct.
 	// Link the previous two structs, with count info, and set all others to 0.
   VkDeviceCreateInfo deviceCreateInfo{};
@@ -212,8 +239,8 @@ void Device::createLogicalDevice() {
   deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
   deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
-  deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
   // validation layers for debugging
   if (enableValidationLayers) {
 	  deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -257,11 +284,8 @@ void Device::createCommandPool() {
 // this will return the maximum available level of multisampling possible on both
 // the color and the depth buffers according to the current physical device.
 VkSampleCountFlagBits Device::getMaxUsableSampleCount() {
-  VkPhysicalDeviceProperties physicalDeviceProperties;
-  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
-
-  VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts
-    & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
+  VkSampleCountFlags counts = properties.limits.framebufferColorSampleCounts
+    & properties.limits.framebufferDepthSampleCounts;
 
   if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
   if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
@@ -21,6 +21,15 @@ public:
   VkCommandPool getCommandPool() const { return commandPool; }
   VkSurfaceKHR getSurface() const { return surface; }
   VkSampleCountFlagBits getMsaaSamples() const { return msaaSamples; }
+  // queried once, when the physical device is picked
+  const VkPhysicalDeviceProperties& getProperties() const { return properties; }
+  const VkPhysicalDeviceLimits& getLimits() const { return properties.limits; }
+  // optional features, these are enabled only if the hardware supports them
+  bool hasPipelineStatistics() const { return pipelineStatisticsEnabled; }
+  // indirect draws with a firstInstance other than 0
+  bool hasDrawIndirectFirstInstance() const { return drawIndirectFirstInstanceEnabled; }
+  // VK_KHR_maintenance2, for image views with fewer usages than their image
+  bool hasImageViewUsage() const { return imageViewUsageEnabled; }
 
   // these are only used by the SwapChain
   uint32_t getGraphicsQueueFamilyIndex() const { return graphicsQueueFamilyIndex; }
@@ -45,6 +54,7 @@ private:
 
   // the physical hardware device (GPU) we are initializing
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties properties{};
 
   // the logical device
   // this will be referenced by nearly every Vulkan function call
@@ -72,6 +82,10 @@ private:
   VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
   VkSampleCountFlagBits getMaxUsableSampleCount();
 
+  bool pipelineStatisticsEnabled = false;
+  bool drawIndirectFirstInstanceEnabled = false;
+  bool imageViewUsageEnabled = false;
+
   #ifdef __APPLE__
   const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
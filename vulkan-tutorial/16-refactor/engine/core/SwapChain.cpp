@@ -4,7 +4,7 @@
 #include "../memory/ImageView.h"
 #include "Debug.h"
 
-SwapChain::SwapChain(Device& device) : device(device) {
+SwapChain::SwapChain(Device& device, bool vsync) : device(device), vsync(vsync) {
   createSwapChain();
   createImageViews();
 }
@@ -197,7 +197,15 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
 // - VK_PRESENT_MODE_MAILBOX_KHR again similar to FIFO but if the queue is full, new images will
 //   be added but will replace the last item on the queue, resulting in fewer latency issues.
 //   Note: if exists, this is preferred.
+// With vsync disabled VK_PRESENT_MODE_IMMEDIATE_KHR is preferred over all of these.
 VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+	if (!vsync) {
+		for (const auto& availablePresentMode : availablePresentModes) {
+			if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+				return availablePresentMode;
+			}
+		}
+	}
 	for (const auto& availablePresentMode : availablePresentModes) {
 		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
 			return availablePresentMode;
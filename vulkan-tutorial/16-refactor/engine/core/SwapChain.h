@@ -6,7 +6,9 @@
 
 class SwapChain {
 public:
-  SwapChain(Device& device);
+  // with vsync off the frame rate is not limited by the display (if the
+  // surface supports it), which is what we want when benchmarking.
+  SwapChain(Device& device, bool vsync = true);
   ~SwapChain();
 
   VkSwapchainKHR getSwapChain() const { return swapChain; }
@@ -24,6 +26,7 @@ private:
   void createImageViews();
 
   Device& device;
+  bool vsync;
 
   // this will be cleaned up manually in the deconstructor
   VkSwapchainKHR swapChain;
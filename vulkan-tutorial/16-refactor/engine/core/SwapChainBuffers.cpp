@@ -43,7 +43,8 @@ SwapChainBuffers::SwapChainBuffers(
       msaaSamples,
       depthFormat,
       VK_IMAGE_TILING_OPTIMAL,
-      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      // sampled by the occlusion culling pass (Hi-Z)
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
     depthImageView(
       device,
@@ -124,7 +125,7 @@ void SwapChainBuffers::recreateSwapChain() {
     msaaSamples,
     depthFormat,
     VK_IMAGE_TILING_OPTIMAL,
-    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
   depthImageView = ImageView(
@@ -24,6 +24,10 @@ public:
   std::vector<VkFramebuffer> getSwapChainFramebuffers() const {
     return swapChainFramebuffers;
   }
+  VkImage getColorImage() const { return colorImage.getImage(); }
+  VkFormat getDepthFormat() const { return depthFormat; }
+  VkImage getDepthImage() const { return depthImage.getImage(); }
+  VkImageView getDepthImageView() const { return depthImageView.getImageView(); }
 
   SwapChainBuffers(const SwapChainBuffers&) = delete;
   SwapChainBuffers& operator=(const SwapChainBuffers&) = delete;
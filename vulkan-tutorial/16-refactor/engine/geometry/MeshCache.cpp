@@ -0,0 +1,216 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MeshCache.h"
+
+// bump when the layout of the file changes
+static constexpr uint32_t MESH_CACHE_VERSION = 1;
+static const char MESH_CACHE_MAGIC[8] = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+// where each array starts, the mapping itself is page aligned
+static constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+// the file starts with this, then the vertices, the positions and the
+// indices at the offsets it gives. in the byte order of the machine
+// which wrote it, which is checked like the rest.
+struct MeshCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t vertexSize;
+  uint32_t positionSize;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint64_t vertexOffset;
+  uint64_t positionOffset;
+  uint64_t indexOffset;
+  uint64_t fileSize;
+  // the source file this was made from
+  uint64_t sourceSize;
+  int64_t sourceModifiedTime;
+  uint64_t sourceHash;
+  float boundsCenter[3];
+  float boundsRadius;
+};
+
+static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+static uint64_t alignUp(uint64_t offset) {
+  return (offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+}
+
+// 64 bit FNV-1a of the whole file, which is read in pieces
+static bool hashFile(const std::string& path, uint64_t& hash) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) return false;
+  hash = 0xcbf29ce484222325ull;
+  std::vector<char> chunk(1 << 20);
+  while (file) {
+    file.read(chunk.data(), chunk.size());
+    std::streamsize count = file.gcount();
+    for (std::streamsize i = 0; i < count; i++) {
+      hash ^= static_cast<uint8_t>(chunk[i]);
+      hash *= 0x100000001b3ull;
+    }
+  }
+  return file.eof();
+}
+
+// what the header says about the source, for the source as it is now
+static bool statSource(const std::string& sourcePath, uint64_t& size, int64_t& modifiedTime) {
+  std::error_code error;
+  size = std::filesystem::file_size(sourcePath, error);
+  if (error) return false;
+  auto time = std::filesystem::last_write_time(sourcePath, error);
+  if (error) return false;
+  modifiedTime = static_cast<int64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+std::string MeshCache::cachePath(const std::string& sourcePath) {
+  return sourcePath + ".meshcache";
+}
+
+// whether count elements at offset lie after the header and inside the
+// file. the offsets come from the file, so nothing is added to them which
+// could wrap around. a 32 bit count times a small size can not overflow.
+static bool blobFits(uint64_t offset, uint32_t count, uint64_t elementSize, uint64_t fileSize) {
+  return offset >= sizeof(MeshCacheHeader)
+    && offset <= fileSize
+    && uint64_t(count) * elementSize <= fileSize - offset;
+}
+
+std::unique_ptr<MeshCache> MeshCache::open(const std::string& sourcePath) {
+  uint64_t sourceSize;
+  int64_t sourceModifiedTime;
+  if (!statSource(sourcePath, sourceSize, sourceModifiedTime)) return nullptr;
+
+  std::string path = cachePath(sourcePath);
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(MeshCacheHeader)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(info.st_size);
+  // the mapping stays valid once the descriptor is closed
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) return nullptr;
+
+  std::unique_ptr<MeshCache> cache(new MeshCache());
+  cache->mapping = mapping;
+  cache->mappingSize = size;
+
+  MeshCacheHeader header;
+  memcpy(&header, mapping, sizeof(header));
+  bool valid = memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0
+    && header.version == MESH_CACHE_VERSION
+    && header.byteOrder == BYTE_ORDER_MARK
+    && header.vertexSize == sizeof(Vertex)
+    && header.positionSize == sizeof(glm::vec3)
+    && header.fileSize == size
+    && header.sourceSize == sourceSize
+    && header.vertexCount > 0
+    && header.indexCount > 0
+    && header.vertexOffset % BLOB_ALIGNMENT == 0
+    && header.positionOffset % BLOB_ALIGNMENT == 0
+    && header.indexOffset % BLOB_ALIGNMENT == 0
+    && blobFits(header.vertexOffset, header.vertexCount, sizeof(Vertex), size)
+    && blobFits(header.positionOffset, header.vertexCount, sizeof(glm::vec3), size)
+    && blobFits(header.indexOffset, header.indexCount, sizeof(uint32_t), size);
+  if (!valid) return nullptr;
+
+  // touched but maybe not changed, the hash says. if it is the same the
+  // new time is written back, so the next load doesn't hash again.
+  if (header.sourceModifiedTime != sourceModifiedTime) {
+    uint64_t hash;
+    if (!hashFile(sourcePath, hash) || hash != header.sourceHash) return nullptr;
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (file.is_open()) {
+      file.seekp(offsetof(MeshCacheHeader, sourceModifiedTime));
+      file.write(reinterpret_cast<const char*>(&sourceModifiedTime), sizeof(sourceModifiedTime));
+    }
+  }
+
+  const char* bytes = static_cast<const char*>(mapping);
+  MeshData& mesh = cache->mesh;
+  mesh.vertices = reinterpret_cast<const Vertex*>(bytes + header.vertexOffset);
+  mesh.positions = reinterpret_cast<const glm::vec3*>(bytes + header.positionOffset);
+  mesh.vertexCount = header.vertexCount;
+  mesh.indices = reinterpret_cast<const uint32_t*>(bytes + header.indexOffset);
+  mesh.indexCount = header.indexCount;
+  mesh.boundsCenter = {header.boundsCenter[0], header.boundsCenter[1], header.boundsCenter[2]};
+  mesh.boundsRadius = header.boundsRadius;
+
+  // the indices are what a GPU would read out of bounds with
+  for (uint32_t i = 0; i < mesh.indexCount; i++) {
+    if (mesh.indices[i] >= mesh.vertexCount) return nullptr;
+  }
+  return cache;
+}
+
+// into a file next to it which then replaces the cache, so a cache is
+// never seen half written, by another process either
+bool MeshCache::write(const std::string& sourcePath, const MeshData& mesh) {
+  MeshCacheHeader header{};
+  memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+  header.version = MESH_CACHE_VERSION;
+  header.byteOrder = BYTE_ORDER_MARK;
+  header.vertexSize = sizeof(Vertex);
+  header.positionSize = sizeof(glm::vec3);
+  header.vertexCount = mesh.vertexCount;
+  header.indexCount = mesh.indexCount;
+  header.vertexOffset = alignUp(sizeof(MeshCacheHeader));
+  header.positionOffset = alignUp(header.vertexOffset + uint64_t(mesh.vertexCount) * sizeof(Vertex));
+  header.indexOffset = alignUp(header.positionOffset + uint64_t(mesh.vertexCount) * sizeof(glm::vec3));
+  header.fileSize = header.indexOffset + uint64_t(mesh.indexCount) * sizeof(uint32_t);
+  if (!statSource(sourcePath, header.sourceSize, header.sourceModifiedTime)) return false;
+  if (!hashFile(sourcePath, header.sourceHash)) return false;
+  header.boundsCenter[0] = mesh.boundsCenter.x;
+  header.boundsCenter[1] = mesh.boundsCenter.y;
+  header.boundsCenter[2] = mesh.boundsCenter.z;
+  header.boundsRadius = mesh.boundsRadius;
+
+  std::string path = cachePath(sourcePath);
+  std::string temporaryPath = path + ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    auto writeAt = [&](uint64_t offset, const void* data, uint64_t size) {
+      static const char zeros[BLOB_ALIGNMENT] = {};
+      uint64_t position = static_cast<uint64_t>(file.tellp());
+      file.write(zeros, static_cast<std::streamsize>(offset - position));
+      file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeAt(header.vertexOffset, mesh.vertices, uint64_t(mesh.vertexCount) * sizeof(Vertex));
+    writeAt(header.positionOffset, mesh.positions, uint64_t(mesh.vertexCount) * sizeof(glm::vec3));
+    writeAt(header.indexOffset, mesh.indices, uint64_t(mesh.indexCount) * sizeof(uint32_t));
+    if (!file) {
+      file.close();
+      std::remove(temporaryPath.c_str());
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, path, error);
+  if (error) {
+    std::remove(temporaryPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+MeshCache::~MeshCache() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+}
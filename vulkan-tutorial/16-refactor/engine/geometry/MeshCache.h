@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Vertex.h"
+
+// a mesh as it is uploaded: the vertices, their positions on their own
+// for the depth only passes, the indices and a bounding sphere. the
+// arrays belong to whoever made it.
+struct MeshData {
+  const Vertex* vertices = nullptr;
+  const glm::vec3* positions = nullptr;
+  uint32_t vertexCount = 0;
+  const uint32_t* indices = nullptr;
+  uint32_t indexCount = 0;
+  glm::vec3 boundsCenter{0.0f};
+  float boundsRadius = 0.0f;
+};
+
+// a binary copy of a mesh made from a source file (an OBJ), written next
+// to it the first time it is loaded, so later loads skip the parsing.
+// the file is a header and the arrays of MeshData as they are in memory,
+// so it is mapped and uploaded from directly.
+//
+// the header has the source file's size, modification time and a hash
+// of its contents. a cache whose source has a different size is stale.
+// one with a different modification time is checked against the hash,
+// so touching (or checking out) the source doesn't throw the cache away.
+// a cache written by another version of the format, or with another
+// Vertex layout, is stale too.
+class MeshCache {
+public:
+  // the cache of sourcePath, mapped, or null if there is none or it is stale
+  static std::unique_ptr<MeshCache> open(const std::string& sourcePath);
+  // writes (or replaces) the cache of sourcePath. returns false if it
+  // could not, which only means the next load parses the source again.
+  static bool write(const std::string& sourcePath, const MeshData& mesh);
+  static std::string cachePath(const std::string& sourcePath);
+
+  ~MeshCache();
+
+  MeshCache(const MeshCache&) = delete;
+  MeshCache& operator=(const MeshCache&) = delete;
+
+  // points into the mapping, valid for as long as this lives
+  const MeshData& getMesh() const { return mesh; }
+
+private:
+  MeshCache() = default;
+
+  // the whole file, mapped read only
+  void* mapping = nullptr;
+  size_t mappingSize = 0;
+  MeshData mesh;
+};
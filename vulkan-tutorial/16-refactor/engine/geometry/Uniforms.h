@@ -1,10 +1,23 @@
+#pragma once
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
-struct UniformBufferObject {
-  alignas(16) glm::mat4 model;
-  glm::mat4 view;
+// set 0, binding 0. the camera, written once per frame and shared by
+// every draw.
+struct FrameUniforms {
+  alignas(16) glm::mat4 view;
   glm::mat4 projection;
+  // projection * view, so the vertex shader does one less multiply
+  glm::mat4 viewProjection;
+};
+
+// set 0, binding 1. one per render object, in the same order as the
+// renderer's objects, and written for all of them at once every frame.
+// shaders find theirs with gl_InstanceIndex, each draw's firstInstance
+// is the object's index. std430, so keep the size a multiple of 16.
+struct ObjectData {
+  alignas(16) glm::mat4 model;
 };
@@ -45,6 +45,25 @@ struct Vertex {
 
     return attributeDescriptions;
   }
+
+  // a second stream containing only positions (tightly packed glm::vec3),
+  // used by the depth pre-pass which has no use for the other attributes.
+  static VkVertexInputBindingDescription getPositionBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(glm::vec3);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescription;
+  }
+
+  static std::array<VkVertexInputAttributeDescription, 1> getPositionAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = 0;
+    return attributeDescriptions;
+  }
 };
 
 namespace std {
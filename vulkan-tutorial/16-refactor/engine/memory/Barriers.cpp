@@ -0,0 +1,219 @@
+#include <stdexcept>
+#include "Barriers.h"
+
+static const VkAccessFlags WRITE_ACCESS =
+  VK_ACCESS_SHADER_WRITE_BIT |
+  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+  VK_ACCESS_TRANSFER_WRITE_BIT |
+  VK_ACCESS_HOST_WRITE_BIT |
+  VK_ACCESS_MEMORY_WRITE_BIT;
+
+bool ResourceState::isWrite() const {
+  return (access & WRITE_ACCESS) != 0;
+}
+
+VkAccessFlags getWriteAccess(VkAccessFlags access) {
+  return access & WRITE_ACCESS;
+}
+
+ResourceState getResourceState(ResourceUsage usage) {
+  switch (usage) {
+    case ResourceUsage::Undefined:
+      return { 0, 0, VK_IMAGE_LAYOUT_UNDEFINED };
+    case ResourceUsage::TransferRead:
+      return {
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    case ResourceUsage::TransferWrite:
+      return {
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    case ResourceUsage::VertexBufferRead:
+      return {
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED };
+    case ResourceUsage::IndexBufferRead:
+      return {
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_ACCESS_INDEX_READ_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED };
+    case ResourceUsage::IndirectRead:
+      return {
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED };
+    case ResourceUsage::UniformRead:
+      return {
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_UNIFORM_READ_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED };
+    case ResourceUsage::FragmentShaderRead:
+      return {
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case ResourceUsage::ComputeShaderRead:
+      return {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case ResourceUsage::ComputeShaderWrite:
+      return {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL };
+    case ResourceUsage::ComputeShaderReadWrite:
+      return {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL };
+    case ResourceUsage::ComputeDepthRead:
+      return {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    case ResourceUsage::ColorAttachment:
+      return {
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    case ResourceUsage::DepthAttachment:
+      return {
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    case ResourceUsage::Present:
+      return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+  }
+  throw std::invalid_argument("unknown resource usage");
+}
+
+ResourceState getResourceState(ResourceUsage usage, VkImageLayout layout) {
+  ResourceState state = getResourceState(usage);
+  state.layout = layout;
+  return state;
+}
+
+ResourceState getLayoutState(VkImageLayout layout) {
+  switch (layout) {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+      return getResourceState(ResourceUsage::Undefined);
+    case VK_IMAGE_LAYOUT_GENERAL:
+      return getResourceState(ResourceUsage::ComputeShaderReadWrite);
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+      return getResourceState(ResourceUsage::TransferRead);
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+      return getResourceState(ResourceUsage::TransferWrite);
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+      return getResourceState(ResourceUsage::FragmentShaderRead);
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+      return getResourceState(ResourceUsage::ColorAttachment);
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+      return getResourceState(ResourceUsage::DepthAttachment);
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+      return {
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        layout };
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+      return getResourceState(ResourceUsage::Present);
+    default:
+      throw std::invalid_argument("unsupported image layout");
+  }
+}
+
+VkImageAspectFlags getImageAspect(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+// a stage mask of 0 is not allowed, "nothing" is the top (or bottom) of the pipe
+static VkPipelineStageFlags sourceStages(const ResourceState& state) {
+  return state.stages != 0 ? state.stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+}
+
+static VkPipelineStageFlags destinationStages(const ResourceState& state) {
+  return state.stages != 0 ? state.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+}
+
+VkImageMemoryBarrier makeImageBarrier(
+  VkImage image,
+  VkImageAspectFlags aspect,
+  uint32_t baseMipLevel,
+  uint32_t levelCount,
+  const ResourceState& from,
+  const ResourceState& to
+) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = from.layout;
+  barrier.newLayout = to.layout == VK_IMAGE_LAYOUT_UNDEFINED ? from.layout : to.layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = aspect;
+  barrier.subresourceRange.baseMipLevel = baseMipLevel;
+  barrier.subresourceRange.levelCount = levelCount;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  // only writes need to be made available, reads only need to have finished
+  barrier.srcAccessMask = from.access & WRITE_ACCESS;
+  barrier.dstAccessMask = to.access;
+  return barrier;
+}
+
+void recordImageBarrier(
+  VkCommandBuffer commandBuffer,
+  VkImage image,
+  VkImageAspectFlags aspect,
+  uint32_t baseMipLevel,
+  uint32_t levelCount,
+  const ResourceState& from,
+  const ResourceState& to
+) {
+  VkImageMemoryBarrier barrier = makeImageBarrier(image, aspect, baseMipLevel, levelCount, from, to);
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    sourceStages(from),
+    destinationStages(to),
+    0,
+    0, nullptr,
+    0, nullptr,
+    1, &barrier);
+}
+
+void recordMemoryBarrier(
+  VkCommandBuffer commandBuffer,
+  const ResourceState& from,
+  const ResourceState& to
+) {
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = from.access & WRITE_ACCESS;
+  barrier.dstAccessMask = to.access;
+
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    sourceStages(from),
+    destinationStages(to),
+    0,
+    1, &barrier,
+    0, nullptr,
+    0, nullptr);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// how a resource is used at one point in a command buffer: the pipeline
+// stages which touch it, how they touch it, and (for images) the layout
+// it needs to be in. a barrier goes from one of these to the next.
+struct ResourceState {
+  VkPipelineStageFlags stages = 0;
+  VkAccessFlags access = 0;
+  VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  bool isWrite() const;
+};
+
+// only the write bits of an access mask, which are the ones a barrier
+// needs to make available
+VkAccessFlags getWriteAccess(VkAccessFlags access);
+
+// the common ways the engine uses images and buffers
+enum class ResourceUsage {
+  Undefined,
+  TransferRead,
+  TransferWrite,
+  VertexBufferRead,
+  IndexBufferRead,
+  IndirectRead,
+  UniformRead,
+  FragmentShaderRead,
+  ComputeShaderRead,
+  ComputeShaderWrite,
+  ComputeShaderReadWrite,
+  // a depth buffer sampled by a compute shader
+  ComputeDepthRead,
+  ColorAttachment,
+  DepthAttachment,
+  Present,
+};
+
+ResourceState getResourceState(ResourceUsage usage);
+// the same, but with a different image layout. for example a storage
+// image which is also sampled stays in VK_IMAGE_LAYOUT_GENERAL.
+ResourceState getResourceState(ResourceUsage usage, VkImageLayout layout);
+// the usage an image in this layout is typically waiting for (or done with)
+ResourceState getLayoutState(VkImageLayout layout);
+
+VkImageAspectFlags getImageAspect(VkFormat format);
+
+// a barrier between two states of (some mip levels of) an image.
+// if "to" has an undefined layout, the layout is left as it is.
+// several of these can go into one vkCmdPipelineBarrier, with the
+// stage masks of every "from" and "to" combined.
+VkImageMemoryBarrier makeImageBarrier(
+  VkImage image,
+  VkImageAspectFlags aspect,
+  uint32_t baseMipLevel,
+  uint32_t levelCount,
+  const ResourceState& from,
+  const ResourceState& to);
+
+// record one barrier made by makeImageBarrier on its own
+void recordImageBarrier(
+  VkCommandBuffer commandBuffer,
+  VkImage image,
+  VkImageAspectFlags aspect,
+  uint32_t baseMipLevel,
+  uint32_t levelCount,
+  const ResourceState& from,
+  const ResourceState& to);
+
+// record a barrier between two states of any buffer (a global memory barrier)
+void recordMemoryBarrier(
+  VkCommandBuffer commandBuffer,
+  const ResourceState& from,
+  const ResourceState& to);
@@ -1,5 +1,7 @@
 #include "Buffers.h"
 #include "../core/Device.h"
+#include "../profile/GpuProfiler.h"
+#include "Barriers.h"
 
 void Buffers::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
@@ -29,6 +31,7 @@ void Buffers::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemory
 
 void Buffers::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+  if (profiler) profiler->beginUpload(commandBuffer);
 
   VkBufferCopy copyRegion{};
   copyRegion.srcOffset = 0; // Optional
@@ -36,7 +39,11 @@ void Buffers::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize si
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
+  if (profiler) profiler->endUpload(commandBuffer);
   endSingleTimeCommands(commandBuffer);
+  if (profiler) profiler->collectUpload("upload buffer");
+  uploadCount++;
+  uploadBytes += size;
 }
 
 void Buffers::copyBufferToImage(
@@ -45,6 +52,7 @@ void Buffers::copyBufferToImage(
 	uint32_t width,
 	uint32_t height) {
 	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+  if (profiler) profiler->beginUpload(commandBuffer);
 
   VkBufferImageCopy region{};
   region.bufferOffset = 0;
@@ -68,7 +76,12 @@ void Buffers::copyBufferToImage(
     &region
   );
 
+  if (profiler) profiler->endUpload(commandBuffer);
   endSingleTimeCommands(commandBuffer);
+  if (profiler) profiler->collectUpload("upload image");
+  uploadCount++;
+  // all textures are RGBA8 for now
+  uploadBytes += static_cast<uint64_t>(width) * height * 4;
 }
 
 void Buffers::createImage(
@@ -81,7 +94,8 @@ void Buffers::createImage(
 	VkImageUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkImage& image,
-	VkDeviceMemory& imageMemory) {
+	VkDeviceMemory& imageMemory,
+	VkImageCreateFlags flags) {
 	VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -96,7 +110,7 @@ void Buffers::createImage(
   imageInfo.usage = usage;
   imageInfo.samples = numSamples;
   imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-  imageInfo.flags = 0; // Optional
+  imageInfo.flags = flags;
 
   if (vkCreateImage(device.getDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image");
@@ -121,7 +135,8 @@ VkImageView Buffers::createImageView(
 	VkImage image,
 	VkFormat format,
 	VkImageAspectFlags aspectFlags,
-	uint32_t mipLevels) {
+	uint32_t mipLevels,
+	VkImageUsageFlags usage) {
 	VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = image;
@@ -133,6 +148,13 @@ VkImageView Buffers::createImageView(
   viewInfo.subresourceRange.baseArrayLayer = 0;
   viewInfo.subresourceRange.layerCount = 1;
 
+  VkImageViewUsageCreateInfo usageInfo{};
+  usageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO;
+  usageInfo.usage = usage;
+  if (usage != 0) {
+    viewInfo.pNext = &usageInfo;
+  }
+
   VkImageView imageView;
   if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
     throw std::runtime_error("failed to create texture image view");
@@ -147,47 +169,17 @@ void Buffers::transitionImageLayout(
 	VkImageLayout oldLayout,
 	VkImageLayout newLayout,
 	uint32_t mipLevels) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-  VkPipelineStageFlags sourceStage;
-  VkPipelineStageFlags destinationStage;
-
-  VkImageMemoryBarrier barrier{};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.oldLayout = oldLayout;
-  barrier.newLayout = newLayout;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = image;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = mipLevels;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-
-  if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-  } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  } else {
-    throw std::invalid_argument("unsupported layout transition");
-  }
-
-  vkCmdPipelineBarrier(
+  // the stages and access on either side are the ones an image in that
+  // layout is usually used with, see getLayoutState
+  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+  recordImageBarrier(
     commandBuffer,
-    sourceStage,
-    destinationStage,
+    image,
+    getImageAspect(format),
     0,
-    0, nullptr,
-    0, nullptr,
-    1, &barrier
-  );
-
+    mipLevels,
+    getLayoutState(oldLayout),
+    getLayoutState(newLayout));
   endSingleTimeCommands(commandBuffer);
 }
 
@@ -206,37 +198,20 @@ void Buffers::generateMipmaps(
   }
 
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+  if (profiler) profiler->beginUpload(commandBuffer);
 
-  VkImageMemoryBarrier barrier{};
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  barrier.image = image;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
-  barrier.subresourceRange.levelCount = 1;
+  ResourceState transferWrite = getResourceState(ResourceUsage::TransferWrite);
+  ResourceState transferRead = getResourceState(ResourceUsage::TransferRead);
+  ResourceState shaderRead = getResourceState(ResourceUsage::FragmentShaderRead);
 
   int32_t mipWidth = texWidth;
   int32_t mipHeight = texHeight;
 
   // note: starting with 1
   for (uint32_t i = 1; i < mipLevels; i++) {
-    barrier.subresourceRange.baseMipLevel = i - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-    vkCmdPipelineBarrier(
-      commandBuffer,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier
-    );
+    // the level above was written (by the copy or the previous blit),
+    // it is now read by this blit
+    recordImageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, transferWrite, transferRead);
 
     VkImageBlit blit{};
     blit.srcOffsets[0] = { 0, 0, 0 };
@@ -264,42 +239,18 @@ void Buffers::generateMipmaps(
       VK_FILTER_LINEAR
     );
 
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    vkCmdPipelineBarrier(
-      commandBuffer,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier
-    );
+    recordImageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, transferRead, shaderRead);
 
     if (mipWidth > 1) mipWidth /= 2;
     if (mipHeight > 1) mipHeight /= 2;
   }
 
-  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-  vkCmdPipelineBarrier(
-    commandBuffer,
-    VK_PIPELINE_STAGE_TRANSFER_BIT,
-    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-    0,
-    0, nullptr,
-    0, nullptr,
-    1, &barrier
-  );
+  // the last level is only ever written
+  recordImageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - 1, 1, transferWrite, shaderRead);
 
+  if (profiler) profiler->endUpload(commandBuffer);
   endSingleTimeCommands(commandBuffer);
+  if (profiler) profiler->collectUpload("generate mipmaps");
 }
 
 uint32_t Buffers::findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
@@ -370,3 +321,8 @@ void Buffers::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 
   vkFreeCommandBuffers(device.getDevice(), device.getCommandPool(), 1, &commandBuffer);
 }
+
+void Buffers::discardSingleTimeCommands(VkCommandBuffer commandBuffer) {
+  vkEndCommandBuffer(commandBuffer);
+  vkFreeCommandBuffers(device.getDevice(), device.getCommandPool(), 1, &commandBuffer);
+}
@@ -5,6 +5,7 @@
 #include <vector>
 
 class Device;
+class GpuProfiler;
 
 class Buffers {
 public:
@@ -44,13 +45,17 @@ public:
 		VkImageUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,
-		VkDeviceMemory& imageMemory);
+		VkDeviceMemory& imageMemory,
+		VkImageCreateFlags flags = 0);
 
+	// usage restricts the view to some of the image's usages, which needs
+	// Device::hasImageViewUsage(). 0 is all of them.
 	VkImageView createImageView(
 		VkImage image,
 		VkFormat format,
 		VkImageAspectFlags aspectFlags,
-		uint32_t mipLevels);
+		uint32_t mipLevels,
+		VkImageUsageFlags usage = 0);
 
 	void transitionImageLayout(
 		VkImage image,
@@ -70,9 +75,25 @@ public:
 
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	// frees the command buffer without submitting it, when recording failed
+	void discardSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+	// optional, uploads will be timed on the GPU if this is set
+	void setProfiler(GpuProfiler* gpuProfiler) { profiler = gpuProfiler; }
+
+	GpuProfiler* getProfiler() const { return profiler; }
+
+	// running totals of every copy to device memory since creation
+	uint64_t getUploadCount() const { return uploadCount; }
+	uint64_t getUploadBytes() const { return uploadBytes; }
+	// for copies recorded somewhere else, like the TextureLoader
+	void countUpload(uint64_t bytes) { uploadCount++; uploadBytes += bytes; }
 
 private:
 	Device& device;
+	GpuProfiler* profiler = nullptr;
+	uint64_t uploadCount = 0;
+	uint64_t uploadBytes = 0;
 
 	// for the depth buffer
 	VkFormat findSupportedFormat(
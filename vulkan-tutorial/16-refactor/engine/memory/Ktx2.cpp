@@ -0,0 +1,244 @@
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include "Ktx2.h"
+
+static const uint8_t KTX2_IDENTIFIER[12] = {
+  0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+// the file starts with these, all little endian
+struct Ktx2Header {
+  uint8_t identifier[12];
+  uint32_t vkFormat;
+  uint32_t typeSize;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t layerCount;
+  uint32_t faceCount;
+  uint32_t levelCount;
+  uint32_t supercompressionScheme;
+  // index
+  uint32_t dfdByteOffset;
+  uint32_t dfdByteLength;
+  uint32_t kvdByteOffset;
+  uint32_t kvdByteLength;
+  uint64_t sgdByteOffset;
+  uint64_t sgdByteLength;
+};
+
+// followed by one of these per level, largest level first
+struct Ktx2LevelIndex {
+  uint64_t byteOffset;
+  uint64_t byteLength;
+  uint64_t uncompressedByteLength;
+};
+
+static Ktx2Header readHeader(std::ifstream& file, const std::string& path) {
+  Ktx2Header header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+    throw std::runtime_error("not a KTX2 file " + path);
+  }
+  return header;
+}
+
+// the size of a level is counted in blocks of blockWidth x blockHeight
+// texels, a single texel for the uncompressed formats
+struct Ktx2Block {
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes;
+};
+
+// the formats the size of a level can be checked for. the header comes
+// from the file, any other format is refused rather than trusted.
+static bool getBlock(VkFormat format, Ktx2Block& block) {
+  switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+      block = { 1, 1, 1 };
+      return true;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R16_SFLOAT:
+      block = { 1, 1, 2 };
+      return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+      block = { 1, 1, 4 };
+      return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+      block = { 1, 1, 8 };
+      return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      block = { 1, 1, 16 };
+      return true;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+      block = { 4, 4, 8 };
+      return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+    case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+      block = { 4, 4, 16 };
+      return true;
+    default:
+      break;
+  }
+
+  // ASTC comes in pairs of UNORM and SRGB, from 4x4 to 12x12, every
+  // block is 16 bytes whatever its size
+  static const uint32_t ASTC_BLOCKS[][2] = {
+    { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+    { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+  };
+  if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+    uint32_t i = (format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2;
+    block = { ASTC_BLOCKS[i][0], ASTC_BLOCKS[i][1], 16 };
+    return true;
+  }
+  return false;
+}
+
+bool isKtx2Path(const std::string& path) {
+  const std::string extension = ".ktx2";
+  return path.size() >= extension.size()
+    && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+Ktx2Info readKtx2Info(const std::string& path) {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file " + path);
+  }
+  uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+  file.seekg(0);
+
+  Ktx2Header header = readHeader(file, path);
+  if (header.vkFormat == VK_FORMAT_UNDEFINED) {
+    throw std::runtime_error("KTX2 file needs transcoding " + path);
+  }
+  if (header.supercompressionScheme != 0) {
+    throw std::runtime_error("KTX2 supercompression is not supported " + path);
+  }
+  if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1) {
+    throw std::runtime_error("KTX2 file is not a 2D texture " + path);
+  }
+  if (header.layerCount > 1 || header.faceCount != 1) {
+    throw std::runtime_error("KTX2 arrays and cube maps are not supported " + path);
+  }
+
+  VkFormat format = static_cast<VkFormat>(header.vkFormat);
+  Ktx2Block block;
+  if (!getBlock(format, block)) {
+    throw std::runtime_error("KTX2 format is not supported " + path);
+  }
+
+  // a level count of 0 asks for the mips to be made at load time,
+  // there is only level 0 in the file then. TextureLoader blits them.
+  // more levels than the full chain has would be an invalid image.
+  uint64_t largest = std::max(header.pixelWidth, header.pixelHeight);
+  uint32_t maxLevelCount = 1;
+  while ((largest >> maxLevelCount) > 0) maxLevelCount++;
+  if (header.levelCount > maxLevelCount) {
+    throw std::runtime_error("KTX2 file has more levels than its size allows " + path);
+  }
+  uint32_t levelCount = header.levelCount == 0 ? 1 : header.levelCount;
+  std::vector<Ktx2LevelIndex> index(levelCount);
+  file.read(reinterpret_cast<char*>(index.data()), sizeof(Ktx2LevelIndex) * levelCount);
+  if (!file) {
+    throw std::runtime_error("KTX2 file is truncated " + path);
+  }
+
+  Ktx2Info info{};
+  info.format = format;
+  info.width = header.pixelWidth;
+  info.height = header.pixelHeight;
+  info.generateMips = header.levelCount == 0;
+  for (uint32_t i = 0; i < levelCount; i++) {
+    const Ktx2LevelIndex& level = index[i];
+    // written so that nothing wraps around, whatever the file says
+    if (level.byteOffset > fileSize || level.byteLength > fileSize - level.byteOffset) {
+      throw std::runtime_error("KTX2 level is outside the file " + path);
+    }
+    // the copy into the image reads this much of the level
+    uint64_t blocksWide = (std::max(header.pixelWidth >> i, 1u) + block.width - 1) / block.width;
+    uint64_t blocksHigh = (std::max(header.pixelHeight >> i, 1u) + block.height - 1) / block.height;
+    if (level.byteLength < blocksWide * blocksHigh * block.bytes) {
+      throw std::runtime_error("KTX2 level is smaller than its size " + path);
+    }
+    info.levels.push_back({ static_cast<size_t>(level.byteOffset), static_cast<size_t>(level.byteLength) });
+  }
+  return info;
+}
+
+Ktx2Texture loadKtx2(const std::string& path) {
+  return loadKtx2(path, readKtx2Info(path), 0);
+}
+
+Ktx2Texture loadKtx2(const std::string& path, const Ktx2Info& info, uint32_t firstLevel) {
+  if (firstLevel >= info.levels.size()) {
+    throw std::runtime_error("KTX2 file does not have that level " + path);
+  }
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file " + path);
+  }
+
+  // the levels are read into one block, largest first
+  Ktx2Texture texture{};
+  texture.format = info.format;
+  texture.width = std::max(info.width >> firstLevel, 1u);
+  texture.height = std::max(info.height >> firstLevel, 1u);
+  texture.generateMips = info.generateMips;
+
+  size_t dataSize = 0;
+  for (size_t level = firstLevel; level < info.levels.size(); level++) {
+    texture.levels.push_back({ dataSize, info.levels[level].size });
+    dataSize += info.levels[level].size;
+  }
+
+  texture.data.resize(dataSize);
+  for (size_t level = firstLevel; level < info.levels.size(); level++) {
+    const Ktx2Level& loaded = texture.levels[level - firstLevel];
+    file.seekg(static_cast<std::streamoff>(info.levels[level].offset));
+    file.read(
+      reinterpret_cast<char*>(texture.data.data() + loaded.offset),
+      static_cast<std::streamsize>(loaded.size));
+    if (!file) {
+      throw std::runtime_error("KTX2 file is truncated " + path);
+    }
+  }
+  return texture;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a texture from a KTX2 file (https://registry.khronos.org/KTX/specs/2.0/),
+// in whatever format it was written in, usually a block compressed one
+// (BC1/3/5/7, ETC2, ASTC), mostly with its mip chain already built. only 2D
+// textures without supercompression are supported, a file which uses
+// Basis Universal or zstd has to be transcoded first. the file is not
+// trusted, a format whose level sizes can not be checked is refused.
+struct Ktx2Level {
+  // into the file, or into data once loaded
+  size_t offset;
+  size_t size;
+};
+
+// what the header and the level index say
+struct Ktx2Info {
+  VkFormat format;
+  uint32_t width;
+  uint32_t height;
+  // level 0 is the largest
+  std::vector<Ktx2Level> levels;
+  // the file only has level 0 and leaves the rest of the chain to the
+  // loader, which can only blit it for an uncompressed format
+  bool generateMips;
+};
+
+struct Ktx2Texture {
+  VkFormat format;
+  uint32_t width;
+  uint32_t height;
+  // level 0 is the largest
+  std::vector<Ktx2Level> levels;
+  bool generateMips;
+  std::vector<uint8_t> data;
+};
+
+bool isKtx2Path(const std::string& path);
+
+// only reads the header and the level index, for example to check if the
+// device supports the format before loading the rest
+Ktx2Info readKtx2Info(const std::string& path);
+Ktx2Texture loadKtx2(const std::string& path);
+// only levels firstLevel and below, which become levels 0 and below.
+// for streaming, the small levels can be loaded without the large ones.
+Ktx2Texture loadKtx2(const std::string& path, const Ktx2Info& info, uint32_t firstLevel);
@@ -0,0 +1,101 @@
+#include <stdexcept>
+#include <functional>
+#include "SamplerCache.h"
+#include "../core/Device.h"
+
+// field by field, the padding of the struct is not guaranteed to be zero
+bool SamplerCache::Key::operator==(const Key& other) const {
+  const VkSamplerCreateInfo& a = info;
+  const VkSamplerCreateInfo& b = other.info;
+  return a.flags == b.flags
+    && a.magFilter == b.magFilter
+    && a.minFilter == b.minFilter
+    && a.mipmapMode == b.mipmapMode
+    && a.addressModeU == b.addressModeU
+    && a.addressModeV == b.addressModeV
+    && a.addressModeW == b.addressModeW
+    && a.mipLodBias == b.mipLodBias
+    && a.anisotropyEnable == b.anisotropyEnable
+    && a.maxAnisotropy == b.maxAnisotropy
+    && a.compareEnable == b.compareEnable
+    && a.compareOp == b.compareOp
+    && a.minLod == b.minLod
+    && a.maxLod == b.maxLod
+    && a.borderColor == b.borderColor
+    && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const {
+  const VkSamplerCreateInfo& info = key.info;
+  size_t hash = 0;
+  auto combine = [&hash](size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  };
+  combine(info.flags);
+  combine(info.magFilter);
+  combine(info.minFilter);
+  combine(info.mipmapMode);
+  combine(info.addressModeU);
+  combine(info.addressModeV);
+  combine(info.addressModeW);
+  combine(std::hash<float>()(info.mipLodBias));
+  combine(info.anisotropyEnable);
+  combine(std::hash<float>()(info.maxAnisotropy));
+  combine(info.compareEnable);
+  combine(info.compareOp);
+  combine(std::hash<float>()(info.minLod));
+  combine(std::hash<float>()(info.maxLod));
+  combine(info.borderColor);
+  combine(info.unnormalizedCoordinates);
+  return hash;
+}
+
+SamplerCache::~SamplerCache() {
+  for (const auto& entry : samplers) {
+    vkDestroySampler(device.getDevice(), entry.second, nullptr);
+  }
+}
+
+VkSampler SamplerCache::get(const VkSamplerCreateInfo& info) {
+  if (info.pNext != nullptr) {
+    throw std::runtime_error("sampler cache does not support pNext chains");
+  }
+
+  Key key{ info };
+  auto found = samplers.find(key);
+  if (found != samplers.end()) return found->second;
+
+  if (samplers.size() >= device.getLimits().maxSamplerAllocationCount) {
+    throw std::runtime_error("too many samplers for the device");
+  }
+
+  VkSampler sampler;
+  if (vkCreateSampler(device.getDevice(), &info, nullptr, &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture sampler");
+  }
+  samplers.emplace(key, sampler);
+  return sampler;
+}
+
+VkSamplerCreateInfo SamplerCache::makeTextureInfo(const Device& device) {
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.anisotropyEnable = VK_TRUE;
+  samplerInfo.maxAnisotropy = device.getLimits().maxSamplerAnisotropy;
+  samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+  samplerInfo.compareEnable = VK_FALSE;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  // the image view limits sampling to the levels the image has, which
+  // change for streamed textures
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.mipLodBias = 0.0f;
+  return samplerInfo;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <unordered_map>
+
+class Device;
+
+// one VkSampler for every distinct sampler state. a sampler is only
+// state, two materials which filter and address their textures the same
+// way can use the same one, and a device only allows so many of them
+// (maxSamplerAllocationCount, which can be as low as 4000).
+//
+// samplers live as long as the cache. since the same ones are used
+// again and again, there are only ever a handful.
+class SamplerCache {
+public:
+  explicit SamplerCache(Device& device) : device(device) {}
+  ~SamplerCache();
+
+  // info must not have a pNext chain, those are not part of the key
+  VkSampler get(const VkSamplerCreateInfo& info);
+
+  // linear filtering and repeat addressing, with as much anisotropy as
+  // the device has and no limit on the mip levels
+  static VkSamplerCreateInfo makeTextureInfo(const Device& device);
+
+  size_t size() const { return samplers.size(); }
+
+  SamplerCache(const SamplerCache&) = delete;
+  SamplerCache& operator=(const SamplerCache&) = delete;
+
+private:
+  struct Key {
+    VkSamplerCreateInfo info;
+
+    bool operator==(const Key& other) const;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  Device& device;
+  std::unordered_map<Key, VkSampler, KeyHash> samplers;
+};
@@ -0,0 +1,42 @@
+#include <utility>
+#include "Texture.h"
+
+Texture::Texture(
+  VkDevice device,
+  VkImage image,
+  VkDeviceMemory memory,
+  VkDeviceSize memorySize,
+  VkImageView imageView,
+  VkFormat format,
+  uint32_t width,
+  uint32_t height,
+  uint32_t mipLevels)
+  : device(device),
+    image(image),
+    memory(memory),
+    memorySize(memorySize),
+    imageView(imageView),
+    format(format),
+    width(width),
+    height(height),
+    mipLevels(mipLevels) {}
+
+Texture::~Texture() {
+  vkDestroyImageView(device, imageView, nullptr);
+  vkDestroyImage(device, image, nullptr);
+  vkFreeMemory(device, memory, nullptr);
+}
+
+void Texture::swap(Texture& other) {
+  std::swap(device, other.device);
+  std::swap(image, other.image);
+  std::swap(memory, other.memory);
+  std::swap(memorySize, other.memorySize);
+  std::swap(imageView, other.imageView);
+  std::swap(format, other.format);
+  std::swap(width, other.width);
+  std::swap(height, other.height);
+  std::swap(mipLevels, other.mipLevels);
+  version++;
+  other.version++;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// a sampled image with a full mip chain, in SHADER_READ_ONLY_OPTIMAL.
+// made by the TextureLoader, any number of materials can share one.
+class Texture {
+public:
+  Texture(
+    VkDevice device,
+    VkImage image,
+    VkDeviceMemory memory,
+    VkDeviceSize memorySize,
+    VkImageView imageView,
+    VkFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipLevels);
+  ~Texture();
+
+  VkImage getImage() const { return image; }
+  VkImageView getImageView() const { return imageView; }
+  VkFormat getFormat() const { return format; }
+  uint32_t getWidth() const { return width; }
+  uint32_t getHeight() const { return height; }
+  uint32_t getMipLevels() const { return mipLevels; }
+  // the bytes allocated for the image, every mip level and whatever
+  // padding the device wants
+  VkDeviceSize getMemorySize() const { return memorySize; }
+
+  // for streaming, where the image is replaced by a larger or smaller one.
+  // the two textures trade images, whoever has the old one destroys it
+  // once the GPU is done with it. the version changes every time, so that
+  // descriptor sets which point at the old image can be found.
+  void swap(Texture& other);
+  uint32_t getVersion() const { return version; }
+
+  Texture(const Texture&) = delete;
+  Texture& operator=(const Texture&) = delete;
+
+private:
+  VkDevice device;
+  VkImage image;
+  VkDeviceMemory memory;
+  VkDeviceSize memorySize;
+  VkImageView imageView;
+  VkFormat format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipLevels;
+  uint32_t version = 0;
+};
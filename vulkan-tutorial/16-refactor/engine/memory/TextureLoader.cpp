@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "TextureLoader.h"
+#include "Buffers.h"
+#include "Barriers.h"
+#include "../core/Device.h"
+#include "../core/ThreadPool.h"
+#include "../profile/GpuProfiler.h"
+#include "../profile/Trace.h"
+#include "../render/MipGenerator.h"
+#include "Ktx2.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "../third_party/stb_image.h"
+
+size_t TextureLoader::add(const std::string& path) {
+  if (isKtx2Path(path)) {
+    Ktx2Texture ktx2 = loadKtx2(path);
+    if (!supportsFormat(ktx2.format)) {
+      throw std::runtime_error("texture format is not supported by the device " + path);
+    }
+    return add(std::move(ktx2));
+  }
+
+  // only the header for now, which is enough to lay out the staging buffer
+  int texWidth, texHeight, texChannels;
+  if (!stbi_info(path.c_str(), &texWidth, &texHeight, &texChannels)) {
+    throw std::runtime_error("failed to load texture image " + path);
+  }
+
+  Pending texture{};
+  texture.path = path;
+  texture.width = static_cast<uint32_t>(texWidth);
+  texture.height = static_cast<uint32_t>(texHeight);
+  texture.size = static_cast<size_t>(texture.width) * texture.height * 4;
+  texture.levels.push_back({ 0, texture.size });
+  texture.format = decodedFormat;
+  texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texture.width, texture.height)))) + 1;
+  pending.push_back(std::move(texture));
+  return pending.size() - 1;
+}
+
+size_t TextureLoader::add(Ktx2Texture ktx2) {
+  Pending texture{};
+  texture.format = ktx2.format;
+  texture.width = ktx2.width;
+  texture.height = ktx2.height;
+  texture.mipLevels = static_cast<uint32_t>(ktx2.levels.size());
+  if (ktx2.generateMips) {
+    // a block compressed format can not be blitted into, and the mip
+    // generator only does RGBA8. better no texture than one without mips.
+    if (!supportsBlit(ktx2.format)) {
+      throw std::runtime_error("KTX2 file leaves its mips to be generated, which its format does not support");
+    }
+    texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texture.width, texture.height)))) + 1;
+  }
+  for (const auto& level : ktx2.levels) {
+    texture.levels.push_back({ level.offset, level.size });
+  }
+  texture.data = std::move(ktx2.data);
+  texture.size = texture.data.size();
+  pending.push_back(std::move(texture));
+  return pending.size() - 1;
+}
+
+size_t TextureLoader::addFirstSupported(const std::vector<std::string>& paths) {
+  for (const auto& path : paths) {
+    if (!isKtx2Path(path)) return add(path);
+    Ktx2Info info = readKtx2Info(path);
+    if (supportsFormat(info.format) && (!info.generateMips || supportsBlit(info.format))) {
+      return add(path);
+    }
+  }
+  throw std::runtime_error("none of the texture formats are supported by the device");
+}
+
+bool TextureLoader::supportsFormat(VkFormat format) const {
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), format, &formatProperties);
+  VkFormatFeatureFlags needed =
+    VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return (formatProperties.optimalTilingFeatures & needed) == needed;
+}
+
+bool TextureLoader::supportsBlit(VkFormat format) const {
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), format, &formatProperties);
+  VkFormatFeatureFlags needed =
+    VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return (formatProperties.optimalTilingFeatures & needed) == needed;
+}
+
+size_t TextureLoader::add(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+  if (pixels.size() < static_cast<size_t>(width) * height * 4) {
+    throw std::runtime_error("texture pixels do not match the texture size");
+  }
+  return add(pixels.data(), width, height);
+}
+
+size_t TextureLoader::add(const uint8_t* pixels, uint32_t width, uint32_t height) {
+  if (width == 0 || height == 0) {
+    throw std::runtime_error("texture pixels do not match the texture size");
+  }
+
+  Pending texture{};
+  texture.data.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+  texture.size = texture.data.size();
+  texture.levels.push_back({ 0, texture.size });
+  texture.format = decodedFormat;
+  texture.width = width;
+  texture.height = height;
+  texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+  pending.push_back(std::move(texture));
+  return pending.size() - 1;
+}
+
+// decoding is most of the time a batch of image files takes, and every
+// image is independent of the others. stb_image decodes into memory of
+// its own, the copy out of it into the staging buffer happens on the same
+// thread while the pixels are still in its cache.
+void TextureLoader::fillStaging(uint8_t* staging) {
+  auto fill = [this, staging](size_t index) {
+    const Pending& texture = pending[index];
+    if (texture.path.empty()) {
+      memcpy(staging + texture.stagingOffset, texture.data.data(), texture.size);
+      return;
+    }
+
+    TRACE_SCOPE("decode texture");
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(
+      texture.path.c_str(),
+      &texWidth,
+      &texHeight,
+      &texChannels,
+      STBI_rgb_alpha);
+    if (!pixels) {
+      throw std::runtime_error("failed to load texture image " + texture.path);
+    }
+    if (static_cast<uint32_t>(texWidth) != texture.width || static_cast<uint32_t>(texHeight) != texture.height) {
+      stbi_image_free(pixels);
+      throw std::runtime_error("texture image changed size while loading " + texture.path);
+    }
+    memcpy(staging + texture.stagingOffset, pixels, texture.size);
+    stbi_image_free(pixels);
+  };
+
+  if (threadPool) {
+    threadPool->parallelFor(pending.size(), fill);
+  } else {
+    for (size_t i = 0; i < pending.size(); i++) fill(i);
+  }
+}
+
+std::vector<std::unique_ptr<Texture>> TextureLoader::upload() {
+  if (pending.empty()) return {};
+
+  // each texture whose format the mip generator supports uses it, the
+  // others are blitted
+  bool compute = mipGenerator != nullptr;
+
+  VkCommandBuffer commandBuffer = buffers.beginSingleTimeCommands();
+  GpuProfiler* profiler = buffers.getProfiler();
+  if (profiler) profiler->beginUpload(commandBuffer);
+
+  StagingBuffer staging;
+  std::vector<std::unique_ptr<Texture>> textures;
+  try {
+    textures = record(commandBuffer, staging, compute);
+  } catch (...) {
+    // nothing was submitted, so everything recorded can go right away
+    buffers.discardSingleTimeCommands(commandBuffer);
+    if (compute) mipGenerator->reset();
+    throw;
+  }
+
+  if (profiler) profiler->endUpload(commandBuffer);
+  buffers.endSingleTimeCommands(commandBuffer);
+  if (profiler) profiler->collectUpload("upload textures");
+  if (compute) mipGenerator->reset();
+
+  vkDestroyBuffer(device.getDevice(), staging.buffer, nullptr);
+  vkFreeMemory(device.getDevice(), staging.memory, nullptr);
+  return textures;
+}
+
+std::vector<std::unique_ptr<Texture>> TextureLoader::record(VkCommandBuffer commandBuffer, StagingBuffer& staging) {
+  // the mip generator's views and descriptor sets would have to outlive
+  // the commands too, blits need nothing of the sort
+  return record(commandBuffer, staging, false);
+}
+
+std::vector<std::unique_ptr<Texture>> TextureLoader::record(
+  VkCommandBuffer commandBuffer,
+  StagingBuffer& staging,
+  bool compute
+) {
+  std::vector<std::unique_ptr<Texture>> textures;
+  if (pending.empty()) return textures;
+
+  for (auto& texture : pending) {
+    texture.computeMips = compute && texture.generatesMips() && mipGenerator->supports(texture.format);
+    // check if image format supports linear blitting
+    if (texture.blitsMips() && !supportsBlit(texture.format)) {
+      throw std::runtime_error("texture image format does not support linear blitting");
+    }
+  }
+
+  // one staging buffer for the whole batch, each texture at its own offset.
+  // a copy of a block compressed format has to start on a whole block,
+  // 16 bytes is a multiple of every block (and of 4, for RGBA8).
+  VkDeviceSize stagingSize = 0;
+  for (auto& texture : pending) {
+    stagingSize = (stagingSize + 15) & ~static_cast<VkDeviceSize>(15);
+    texture.stagingOffset = stagingSize;
+    stagingSize += texture.size;
+  }
+
+  buffers.createBuffer(
+    stagingSize,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    staging.buffer,
+    staging.memory);
+
+  // decoding throws for a missing or broken file, and nothing may be left
+  // of the staging buffer then. the caller never gets to see it.
+  try {
+    void* data;
+    vkMapMemory(device.getDevice(), staging.memory, 0, stagingSize, 0, &data);
+    try {
+      fillStaging(static_cast<uint8_t*>(data));
+    } catch (...) {
+      vkUnmapMemory(device.getDevice(), staging.memory);
+      throw;
+    }
+    vkUnmapMemory(device.getDevice(), staging.memory);
+
+    recordTextures(commandBuffer, staging.buffer, compute, textures);
+  } catch (...) {
+    vkDestroyBuffer(device.getDevice(), staging.buffer, nullptr);
+    vkFreeMemory(device.getDevice(), staging.memory, nullptr);
+    staging = StagingBuffer{};
+    throw;
+  }
+
+  for (const auto& texture : pending) buffers.countUpload(texture.size);
+  pending.clear();
+  return textures;
+}
+
+// the textures own their images as soon as they exist, if anything below
+// throws they are cleaned up with the vector
+void TextureLoader::recordTextures(
+  VkCommandBuffer commandBuffer,
+  VkBuffer stagingBuffer,
+  bool compute,
+  std::vector<std::unique_ptr<Texture>>& textures
+) {
+  textures.reserve(pending.size());
+  for (auto& texture : pending) {
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    VkImageCreateFlags flags = 0;
+    VkImageUsageFlags viewUsage = 0;
+    if (texture.computeMips) {
+      usage |= MipGenerator::getImageUsage();
+      flags |= MipGenerator::getImageFlags(texture.format);
+      viewUsage = MipGenerator::getViewUsage(texture.format);
+    } else if (texture.blitsMips()) {
+      usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    VkImage image;
+    VkDeviceMemory memory;
+    buffers.createImage(
+      texture.width,
+      texture.height,
+      texture.mipLevels,
+      VK_SAMPLE_COUNT_1_BIT,
+      texture.format,
+      VK_IMAGE_TILING_OPTIMAL,
+      usage,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      image,
+      memory,
+      flags);
+    // the size createImage allocated
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device.getDevice(), image, &memoryRequirements);
+    VkImageView imageView = buffers.createImageView(
+      image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels, viewUsage);
+    textures.push_back(std::make_unique<Texture>(
+      device.getDevice(),
+      image,
+      memory,
+      memoryRequirements.size,
+      imageView,
+      texture.format,
+      texture.width,
+      texture.height,
+      texture.mipLevels));
+    texture.image = image;
+  }
+
+  recordCopies(commandBuffer, stagingBuffer);
+  recordLoadedMipmaps(commandBuffer);
+  if (compute) recordComputeMipmaps(commandBuffer);
+  recordMipmaps(commandBuffer);
+}
+
+void TextureLoader::recordCopies(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer) {
+  ResourceState undefined = getResourceState(ResourceUsage::Undefined);
+  ResourceState transferWrite = getResourceState(ResourceUsage::TransferWrite);
+
+  // every level of every image is ready to be written, in one barrier
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.reserve(pending.size());
+  for (const auto& texture : pending) {
+    barriers.push_back(makeImageBarrier(
+      texture.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, undefined, transferWrite));
+  }
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0,
+    0, nullptr,
+    0, nullptr,
+    static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  // one region per level in the staging buffer. a level of a block
+  // compressed image does not have to be a whole number of blocks, the
+  // last row and column of blocks are cut off at the edge of the level.
+  std::vector<VkBufferImageCopy> regions;
+  for (const auto& texture : pending) {
+    regions.clear();
+    for (uint32_t level = 0; level < texture.levels.size(); level++) {
+      VkBufferImageCopy region{};
+      region.bufferOffset = texture.stagingOffset + texture.levels[level].offset;
+      region.bufferRowLength = 0;
+      region.bufferImageHeight = 0;
+      region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel = level;
+      region.imageSubresource.baseArrayLayer = 0;
+      region.imageSubresource.layerCount = 1;
+      region.imageOffset = { 0, 0, 0 };
+      region.imageExtent = {
+        std::max(texture.width >> level, 1u),
+        std::max(texture.height >> level, 1u),
+        1
+      };
+      regions.push_back(region);
+    }
+
+    vkCmdCopyBufferToImage(
+      commandBuffer,
+      stagingBuffer,
+      texture.image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      static_cast<uint32_t>(regions.size()),
+      regions.data());
+  }
+}
+
+// textures which came with all their levels are done after the copy
+void TextureLoader::recordLoadedMipmaps(VkCommandBuffer commandBuffer) {
+  ResourceState transferWrite = getResourceState(ResourceUsage::TransferWrite);
+  ResourceState shaderRead = getResourceState(ResourceUsage::FragmentShaderRead);
+
+  std::vector<VkImageMemoryBarrier> barriers;
+  for (const auto& texture : pending) {
+    if (texture.generatesMips()) continue;
+    barriers.push_back(makeImageBarrier(
+      texture.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, transferWrite, shaderRead));
+  }
+  if (barriers.empty()) return;
+
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+    0,
+    0, nullptr,
+    0, nullptr,
+    static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+// the same as Buffers::generateMipmaps, one level at a time, but for
+// every texture at once. step i blits level i - 1 into level i, and the
+// barrier before it (one for the whole batch) does three things:
+// - level i - 1 was just written, now it is read by this step's blit,
+// - level i - 2 was read by the previous step's blit, it is done,
+// - a texture with only i levels has just written its last one, done.
+void TextureLoader::recordMipmaps(VkCommandBuffer commandBuffer) {
+  ResourceState transferWrite = getResourceState(ResourceUsage::TransferWrite);
+  ResourceState transferRead = getResourceState(ResourceUsage::TransferRead);
+  ResourceState shaderRead = getResourceState(ResourceUsage::FragmentShaderRead);
+
+  uint32_t maxLevels = 0;
+  for (const auto& texture : pending) {
+    if (texture.blitsMips()) maxLevels = std::max(maxLevels, texture.mipLevels);
+  }
+
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.reserve(pending.size() * 2);
+
+  // note: starting with 1, and one step past the last level to finish it
+  for (uint32_t i = 1; i <= maxLevels; i++) {
+    barriers.clear();
+    for (const auto& texture : pending) {
+      if (!texture.blitsMips()) continue;
+      if (texture.mipLevels > i) {
+        barriers.push_back(makeImageBarrier(
+          texture.image, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, transferWrite, transferRead));
+      } else if (texture.mipLevels == i) {
+        barriers.push_back(makeImageBarrier(
+          texture.image, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, transferWrite, shaderRead));
+      }
+      if (i >= 2 && texture.mipLevels >= i) {
+        barriers.push_back(makeImageBarrier(
+          texture.image, VK_IMAGE_ASPECT_COLOR_BIT, i - 2, 1, transferRead, shaderRead));
+      }
+    }
+    if (barriers.empty()) continue;
+
+    vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0,
+      0, nullptr,
+      0, nullptr,
+      static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    for (const auto& texture : pending) {
+      if (!texture.blitsMips() || texture.mipLevels <= i) continue;
+
+      int32_t srcWidth = static_cast<int32_t>(std::max(texture.width >> (i - 1), 1u));
+      int32_t srcHeight = static_cast<int32_t>(std::max(texture.height >> (i - 1), 1u));
+
+      VkImageBlit blit{};
+      blit.srcOffsets[0] = { 0, 0, 0 };
+      blit.srcOffsets[1] = { srcWidth, srcHeight, 1 };
+      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel = i - 1;
+      blit.srcSubresource.baseArrayLayer = 0;
+      blit.srcSubresource.layerCount = 1;
+      blit.dstOffsets[0] = { 0, 0, 0 };
+      blit.dstOffsets[1] = {
+        srcWidth > 1 ? srcWidth / 2 : 1,
+        srcHeight > 1 ? srcHeight / 2 : 1,
+        1
+      };
+      blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.dstSubresource.mipLevel = i;
+      blit.dstSubresource.baseArrayLayer = 0;
+      blit.dstSubresource.layerCount = 1;
+
+      vkCmdBlitImage(
+        commandBuffer,
+        texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &blit,
+        VK_FILTER_LINEAR);
+    }
+  }
+}
+
+// level 0 was copied, the levels below it have nothing in them worth
+// keeping. they all go to GENERAL, one dispatch per texture fills in the
+// levels, then they all go to SHADER_READ_ONLY, each step in one barrier.
+void TextureLoader::recordComputeMipmaps(VkCommandBuffer commandBuffer) {
+  ResourceState undefined = getResourceState(ResourceUsage::Undefined);
+  ResourceState transferWrite = getResourceState(ResourceUsage::TransferWrite);
+  ResourceState computeReadWrite = getResourceState(ResourceUsage::ComputeShaderReadWrite);
+  ResourceState shaderRead = getResourceState(ResourceUsage::FragmentShaderRead);
+
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.reserve(pending.size() * 2);
+  for (const auto& texture : pending) {
+    if (!texture.computeMips) continue;
+    barriers.push_back(makeImageBarrier(
+      texture.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, transferWrite, computeReadWrite));
+    barriers.push_back(makeImageBarrier(
+      texture.image, VK_IMAGE_ASPECT_COLOR_BIT, 1, texture.mipLevels - 1, undefined, computeReadWrite));
+  }
+  if (barriers.empty()) return;
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0,
+    0, nullptr,
+    0, nullptr,
+    static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  for (const auto& texture : pending) {
+    if (!texture.computeMips) continue;
+    mipGenerator->record(
+      commandBuffer, texture.image, texture.format, texture.width, texture.height, texture.mipLevels);
+  }
+
+  barriers.clear();
+  for (const auto& texture : pending) {
+    if (!texture.computeMips) continue;
+    barriers.push_back(makeImageBarrier(
+      texture.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, computeReadWrite, shaderRead));
+  }
+  vkCmdPipelineBarrier(
+    commandBuffer,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+    0,
+    0, nullptr,
+    0, nullptr,
+    static_cast<uint32_t>(barriers.size()), barriers.data());
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Texture.h"
+#include "Ktx2.h"
+
+class Device;
+class Buffers;
+class MipGenerator;
+class ThreadPool;
+
+// uploads a batch of textures at once. every texture's layout
+// transitions, copy and mip blits go into a single command buffer, and
+// the barriers of all the textures at the same step are merged, so a
+// batch costs one submit (and one wait) however many textures it has.
+//
+// usage: add() every texture, then upload() once.
+//
+// add() only reads the size of an image file, the decoding happens in
+// upload() (or record()), every image at once on the thread pool, each
+// straight into its place in the staging buffer.
+//
+// images (png, jpg, ...) are decoded to RGBA8 and get a mip chain on the
+// GPU. with a MipGenerator the mip chains are made by compute shaders, one
+// dispatch per texture. without one they are blitted, one level at a time,
+// which needs a format that supports linear filtering.
+//
+// KTX2 files are uploaded as they are, in their own (usually block
+// compressed) format and with the mip levels they come with. nothing is
+// decoded or generated, and they take 4 to 8 times less memory. a file
+// with only level 0 that asks for its mips gets them like an image does,
+// which is refused for a format that can not be blitted.
+class TextureLoader {
+public:
+  // without a thread pool, images are decoded one after the other
+  TextureLoader(
+    Device& device,
+    Buffers& buffers,
+    MipGenerator* mipGenerator = nullptr,
+    ThreadPool* threadPool = nullptr)
+    : device(device), buffers(buffers), mipGenerator(mipGenerator), threadPool(threadPool) {}
+
+  // read now, uploaded by upload(). returns the index of the texture
+  // in the vector upload() returns.
+  size_t add(const std::string& path);
+  // the first of these files the device can sample, for example the same
+  // texture as BC7, ASTC and ETC2 KTX2 files, then a png which always works
+  size_t addFirstSupported(const std::vector<std::string>& paths);
+  // tightly packed RGBA8 pixels (sRGB), width * height * 4 bytes. copied.
+  size_t add(const uint8_t* pixels, uint32_t width, uint32_t height);
+  size_t add(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+  // already loaded, with all of its levels (or generating them)
+  size_t add(Ktx2Texture texture);
+
+  size_t size() const { return pending.size(); }
+
+  // waits for the GPU to finish, then forgets the pending textures
+  std::vector<std::unique_ptr<Texture>> upload();
+
+  struct StagingBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+  };
+  // upload() without the submit, for uploads which should not wait, like
+  // streaming. everything is recorded into commandBuffer, the staging
+  // buffer has to be destroyed by the caller after it has executed, and
+  // the textures must not be used before then. mips are always blitted.
+  // if it throws there is no staging buffer, and whatever was recorded
+  // into commandBuffer must not be submitted.
+  std::vector<std::unique_ptr<Texture>> record(VkCommandBuffer commandBuffer, StagingBuffer& staging);
+
+  // can be sampled with a linear filter from an optimally tiled image
+  bool supportsFormat(VkFormat format) const;
+  // can have its mip chain blitted, which no block compressed format can
+  bool supportsBlit(VkFormat format) const;
+
+  TextureLoader(const TextureLoader&) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
+
+private:
+  // the format of decoded images
+  const VkFormat decodedFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+  struct Level {
+    // into data
+    size_t offset;
+    size_t size;
+  };
+
+  struct Pending {
+    // empty for an image file which is decoded straight into staging memory
+    std::vector<uint8_t> data;
+    // the image file to decode, if data is empty
+    std::string path;
+    // of data, or of the decoded image
+    size_t size;
+    // the levels in data, the rest of the mip chain is generated
+    std::vector<Level> levels;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    VkDeviceSize stagingOffset;
+    VkImage image;
+    // by the mip generator, or else blitted
+    bool computeMips;
+
+    bool generatesMips() const { return levels.size() < mipLevels; }
+    bool blitsMips() const { return generatesMips() && !computeMips; }
+  };
+
+  Device& device;
+  Buffers& buffers;
+  MipGenerator* mipGenerator;
+  ThreadPool* threadPool;
+  std::vector<Pending> pending;
+
+  // copy or decode every pending texture to its staging offset
+  void fillStaging(uint8_t* staging);
+
+  std::vector<std::unique_ptr<Texture>> record(
+    VkCommandBuffer commandBuffer,
+    StagingBuffer& staging,
+    bool compute);
+  // creates the textures and records everything after the staging buffer
+  // has been filled
+  void recordTextures(
+    VkCommandBuffer commandBuffer,
+    VkBuffer stagingBuffer,
+    bool compute,
+    std::vector<std::unique_ptr<Texture>>& textures);
+  void recordCopies(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer);
+  void recordLoadedMipmaps(VkCommandBuffer commandBuffer);
+  void recordMipmaps(VkCommandBuffer commandBuffer);
+  void recordComputeMipmaps(VkCommandBuffer commandBuffer);
+};
@@ -0,0 +1,289 @@
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include "TextureStreamer.h"
+#include "Buffers.h"
+#include "../core/Device.h"
+#include "../core/DeletionQueue.h"
+
+TextureStreamer::TextureStreamer(
+  Device& device,
+  Buffers& buffers,
+  DeletionQueue& deletionQueue,
+  VkDeviceSize memoryBudget)
+  : device(device),
+    buffers(buffers),
+    deletionQueue(deletionQueue),
+    memoryBudget(memoryBudget) {
+  worker = std::thread(&TextureStreamer::work, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  worker.join();
+
+  for (auto& upload : uploads) {
+    vkWaitForFences(device.getDevice(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+    destroyUpload(upload);
+  }
+}
+
+std::vector<Texture*> TextureStreamer::add(const std::vector<std::string>& paths) {
+  TextureLoader loader(device, buffers);
+  std::vector<Stream> added;
+
+  for (const auto& path : paths) {
+    Stream stream;
+    stream.path = path;
+    stream.info = readKtx2Info(path);
+    if (!loader.supportsFormat(stream.info.format)) {
+      throw std::runtime_error("texture format is not supported by the device " + path);
+    }
+
+    // the largest level which is no bigger than INITIAL_SIZE, or the
+    // smallest level there is
+    uint32_t levelCount = static_cast<uint32_t>(stream.info.levels.size());
+    uint32_t level = 0;
+    while (level + 1 < levelCount
+      && std::max(stream.info.width >> level, stream.info.height >> level) > INITIAL_SIZE) {
+      level++;
+    }
+    stream.firstLevel = level;
+    stream.requestedLevel = level;
+    stream.initialLevel = level;
+
+    loader.add(loadKtx2(path, stream.info, level));
+    added.push_back(std::move(stream));
+  }
+
+  std::vector<std::unique_ptr<Texture>> textures = loader.upload();
+  std::vector<Texture*> result;
+  for (size_t i = 0; i < added.size(); i++) {
+    added[i].texture = std::move(textures[i]);
+    result.push_back(added[i].texture.get());
+    streams.push_back(std::move(added[i]));
+  }
+  return result;
+}
+
+void TextureStreamer::update(uint64_t frame) {
+  finishUploads(frame);
+  startUploads();
+  requestLevels();
+}
+
+VkDeviceSize TextureStreamer::getBytes(const Stream& stream, uint32_t firstLevel) const {
+  VkDeviceSize bytes = 0;
+  for (size_t level = firstLevel; level < stream.info.levels.size(); level++) {
+    bytes += stream.info.levels[level].size;
+  }
+  return bytes;
+}
+
+VkDeviceSize TextureStreamer::getResidentBytes() const {
+  VkDeviceSize bytes = 0;
+  for (const auto& stream : streams) bytes += getBytes(stream, stream.firstLevel);
+  return bytes;
+}
+
+size_t TextureStreamer::getBusyCount() const {
+  return static_cast<size_t>(std::count_if(streams.begin(), streams.end(), [](const Stream& stream) {
+    return stream.busy;
+  }));
+}
+
+// a finished upload swaps its images into the textures materials use,
+// the images they had are destroyed once no frame in flight uses them
+void TextureStreamer::finishUploads(uint64_t frame) {
+  for (size_t i = 0; i < uploads.size();) {
+    Upload& upload = uploads[i];
+    if (vkGetFenceStatus(device.getDevice(), upload.fence) != VK_SUCCESS) {
+      i++;
+      continue;
+    }
+
+    for (size_t j = 0; j < upload.streams.size(); j++) {
+      Stream& stream = streams[upload.streams[j]];
+      stream.texture->swap(*upload.textures[j]);
+      stream.firstLevel = upload.firstLevels[j];
+      stream.requestedLevel = stream.firstLevel;
+      stream.busy = false;
+
+      std::shared_ptr<Texture> old(std::move(upload.textures[j]));
+      deletionQueue.push(frame, [old]() mutable { old.reset(); });
+    }
+
+    destroyUpload(upload);
+    uploads.erase(uploads.begin() + i);
+  }
+}
+
+void TextureStreamer::destroyUpload(Upload& upload) {
+  vkDestroyFence(device.getDevice(), upload.fence, nullptr);
+  vkFreeCommandBuffers(device.getDevice(), device.getCommandPool(), 1, &upload.commandBuffer);
+  vkDestroyBuffer(device.getDevice(), upload.staging.buffer, nullptr);
+  vkFreeMemory(device.getDevice(), upload.staging.memory, nullptr);
+}
+
+// everything the background thread has read since the last frame goes
+// into one command buffer, which is submitted without waiting for it
+void TextureStreamer::startUploads() {
+  std::vector<Loaded> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.swap(loaded);
+  }
+  if (ready.empty()) return;
+
+  // a file which could not be read keeps the levels it has, the others
+  // in the batch are uploaded all the same
+  Upload upload{};
+  TextureLoader loader(device, buffers);
+  for (auto& result : ready) {
+    if (!result.error.empty()) {
+      std::cout << "[INFO] failed to stream texture: " << result.error << std::endl;
+      release(streams[result.stream]);
+      continue;
+    }
+    upload.streams.push_back(result.stream);
+    upload.firstLevels.push_back(result.firstLevel);
+    loader.add(std::move(result.texture));
+  }
+  if (upload.streams.empty()) return;
+
+  // nothing of the upload may be left if any of it fails, and its streams
+  // have to be free to be requested again
+  try {
+    submitUpload(loader, upload);
+  } catch (...) {
+    destroyUpload(upload);
+    for (size_t index : upload.streams) release(streams[index]);
+    throw;
+  }
+  uploads.push_back(std::move(upload));
+}
+
+void TextureStreamer::release(Stream& stream) {
+  stream.requestedLevel = stream.firstLevel;
+  stream.busy = false;
+}
+
+void TextureStreamer::submitUpload(TextureLoader& loader, Upload& upload) {
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = device.getCommandPool();
+  allocInfo.commandBufferCount = 1;
+  if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &upload.commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate texture streaming command buffer");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+  upload.textures = loader.record(upload.commandBuffer, upload.staging);
+  vkEndCommandBuffer(upload.commandBuffer);
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &upload.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture streaming fence");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &upload.commandBuffer;
+  if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, upload.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit texture streaming upload");
+  }
+}
+
+void TextureStreamer::request(Stream& stream, size_t index, uint32_t firstLevel) {
+  stream.requestedLevel = firstLevel;
+  stream.busy = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.push_back({ index, stream.path, stream.info, firstLevel });
+  }
+  wake.notify_one();
+}
+
+// the budget counts every texture at the size it is going to be once the
+// requests in flight are done. over it, the texture with the largest
+// resident level loses it. under it, the texture with the smallest
+// resident level gets the next one up, if that fits.
+void TextureStreamer::requestLevels() {
+  VkDeviceSize projected = 0;
+  size_t busy = 0;
+  for (const auto& stream : streams) {
+    projected += getBytes(stream, stream.requestedLevel);
+    if (stream.busy) busy++;
+  }
+
+  while (busy < MAX_BUSY && projected > memoryBudget) {
+    Stream* largest = nullptr;
+    size_t index = 0;
+    for (size_t i = 0; i < streams.size(); i++) {
+      Stream& stream = streams[i];
+      if (stream.busy || stream.firstLevel >= stream.initialLevel) continue;
+      if (!largest || stream.firstLevel < largest->firstLevel) {
+        largest = &stream;
+        index = i;
+      }
+    }
+    if (!largest) break;
+
+    projected -= largest->info.levels[largest->firstLevel].size;
+    request(*largest, index, largest->firstLevel + 1);
+    busy++;
+  }
+
+  while (busy < MAX_BUSY) {
+    Stream* smallest = nullptr;
+    size_t index = 0;
+    for (size_t i = 0; i < streams.size(); i++) {
+      Stream& stream = streams[i];
+      if (stream.busy || stream.firstLevel == 0) continue;
+      if (projected + stream.info.levels[stream.firstLevel - 1].size > memoryBudget) continue;
+      if (!smallest || stream.firstLevel > smallest->firstLevel) {
+        smallest = &stream;
+        index = i;
+      }
+    }
+    if (!smallest) break;
+
+    projected += smallest->info.levels[smallest->firstLevel - 1].size;
+    request(*smallest, index, smallest->firstLevel - 1);
+    busy++;
+  }
+}
+
+void TextureStreamer::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return stopping || !requests.empty(); });
+    if (stopping) return;
+
+    Request next = std::move(requests.front());
+    requests.pop_front();
+    lock.unlock();
+
+    Loaded result{};
+    result.stream = next.stream;
+    result.firstLevel = next.firstLevel;
+    try {
+      result.texture = loadKtx2(next.path, next.info, next.firstLevel);
+    } catch (const std::exception& error) {
+      result.error = error.what();
+    }
+
+    lock.lock();
+    loaded.push_back(std::move(result));
+  }
+}
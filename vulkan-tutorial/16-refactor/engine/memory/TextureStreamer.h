@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Ktx2.h"
+#include "Texture.h"
+#include "TextureLoader.h"
+
+class Device;
+class Buffers;
+class DeletionQueue;
+
+// KTX2 textures which are usable right away, at a low resolution, and
+// get sharper over the next frames as their larger mip levels stream in.
+//
+// add() uploads the levels of at most INITIAL_SIZE texels, which is
+// quick. from then on update(), once per frame, asks a background thread
+// to read the next level of a texture from disk, one level at a time,
+// smallest textures first. once it is read, the texture is recreated
+// with that level added on top, uploaded without waiting, and swapped
+// in when its fence signals. the old image goes on the deletion queue.
+//
+// a texture only has the levels which are resident, so sampling is
+// clamped to them without any change to the sampler, and when the
+// resident levels of every texture add up to more than the memory budget
+// the largest ones are recreated without their top level, which frees it.
+class TextureStreamer {
+public:
+  // levels this size and smaller are loaded by add()
+  static const uint32_t INITIAL_SIZE = 64;
+
+  TextureStreamer(
+    Device& device,
+    Buffers& buffers,
+    DeletionQueue& deletionQueue,
+    VkDeviceSize memoryBudget = 256ull * 1024 * 1024);
+  // waits for the uploads in flight
+  ~TextureStreamer();
+
+  // in one submission. the textures stay valid as long as the streamer,
+  // their images change, see Texture::getVersion.
+  std::vector<Texture*> add(const std::vector<std::string>& paths);
+
+  // once per frame, after waiting on the fence of the frame and before
+  // recording it. frame counts frames, the same as for the deletion queue.
+  void update(uint64_t frame);
+
+  void setMemoryBudget(VkDeviceSize bytes) { memoryBudget = bytes; }
+  VkDeviceSize getMemoryBudget() const { return memoryBudget; }
+  // the levels of every texture which are resident now
+  VkDeviceSize getResidentBytes() const;
+  // textures which have levels being read or uploaded
+  size_t getBusyCount() const;
+
+  TextureStreamer(const TextureStreamer&) = delete;
+  TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+private:
+  // a few levels at a time, the upload of a 4096 texel level is 16MB
+  // uncompressed, this is meant to be spread out over frames
+  static const size_t MAX_BUSY = 4;
+
+  struct Stream {
+    std::string path;
+    Ktx2Info info;
+    std::unique_ptr<Texture> texture;
+    // resident levels of the file are firstLevel and below
+    uint32_t firstLevel;
+    // where the texture is going, the same as firstLevel when not busy
+    uint32_t requestedLevel;
+    // the levels add() loaded, never evicted
+    uint32_t initialLevel;
+    bool busy = false;
+  };
+
+  // for the background thread
+  struct Request {
+    size_t stream;
+    std::string path;
+    Ktx2Info info;
+    uint32_t firstLevel;
+  };
+
+  struct Loaded {
+    size_t stream;
+    uint32_t firstLevel;
+    Ktx2Texture texture;
+    std::string error;
+  };
+
+  // one submission of every level which was read since the last update
+  struct Upload {
+    std::vector<size_t> streams;
+    std::vector<uint32_t> firstLevels;
+    std::vector<std::unique_ptr<Texture>> textures;
+    TextureLoader::StagingBuffer staging;
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+  };
+
+  Device& device;
+  Buffers& buffers;
+  DeletionQueue& deletionQueue;
+  VkDeviceSize memoryBudget;
+
+  std::vector<Stream> streams;
+  std::vector<Upload> uploads;
+
+  // shared with the background thread
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Request> requests;
+  std::vector<Loaded> loaded;
+  bool stopping = false;
+  std::thread worker;
+
+  void work();
+  void finishUploads(uint64_t frame);
+  void startUploads();
+  // records and submits everything added to loader
+  void submitUpload(TextureLoader& loader, Upload& upload);
+  // back to the levels it has, free to be requested again
+  void release(Stream& stream);
+  void requestLevels();
+  void request(Stream& stream, size_t index, uint32_t firstLevel);
+  void destroyUpload(Upload& upload);
+  VkDeviceSize getBytes(const Stream& stream, uint32_t firstLevel) const;
+};
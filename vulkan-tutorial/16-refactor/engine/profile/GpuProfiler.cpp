@@ -0,0 +1,242 @@
+#include <stdexcept>
+#include <algorithm>
+#include <iomanip>
+#include "GpuProfiler.h"
+#include "../core/Device.h"
+#include "../Debug.h"
+
+GpuProfiler::GpuProfiler(Device& device, uint32_t framesInFlight, uint32_t maxScopesPerFrame)
+  : device(device),
+    framesInFlight(framesInFlight),
+    maxScopesPerFrame(maxScopesPerFrame) {
+
+  const VkPhysicalDeviceProperties& properties = device.getProperties();
+
+  // not all queues are able to write timestamps, the number of valid bits
+  // is reported per queue family, and 0 means no support at all.
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+  uint32_t validBits = queueFamilies[device.getGraphicsQueueFamilyIndex()].timestampValidBits;
+
+  if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+    DEBUG_LOG("timestamp queries are not supported, GPU profiler disabled");
+    return;
+  }
+
+  timestampPeriod = static_cast<double>(properties.limits.timestampPeriod);
+  timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+  // two queries (begin, end) per scope, per frame in flight,
+  // plus one more pair at the very end used by uploads.
+  VkQueryPoolCreateInfo queryPoolInfo{};
+  queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolInfo.queryCount = uploadQuery() + 2;
+
+  if (vkCreateQueryPool(device.getDevice(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create timestamp query pool");
+  }
+
+  pendingScopes.resize(framesInFlight);
+  supported = true;
+}
+
+GpuProfiler::~GpuProfiler() {
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device.getDevice(), queryPool, nullptr);
+  }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!supported) return;
+  currentFrame = frameIndex;
+  nextQuery = firstQuery(frameIndex);
+
+  // the fence for this frame index has already been waited on,
+  // so the results should be ready. we ask for availability instead of
+  // waiting, anything not yet available is simply skipped.
+  auto& pending = pendingScopes[frameIndex];
+  if (!pending.empty()) {
+    uint32_t count = pending.back().query + 2 - firstQuery(frameIndex);
+    std::vector<uint64_t> results(count * 2);
+    vkGetQueryPoolResults(
+      device.getDevice(),
+      queryPool,
+      firstQuery(frameIndex),
+      count,
+      results.size() * sizeof(uint64_t),
+      results.data(),
+      sizeof(uint64_t) * 2,
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    for (const auto& scope : pending) {
+      size_t i = (scope.query - firstQuery(frameIndex)) * 2;
+      bool available = results[i + 1] != 0 && results[i + 3] != 0;
+      if (available) {
+        addSample(scope.scopeIndex, results[i], results[i + 2]);
+      }
+    }
+    pending.clear();
+  }
+
+  vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery(frameIndex), maxScopesPerFrame * 2);
+}
+
+void GpuProfiler::endFrame() {
+  if (!supported) return;
+  frameCount++;
+  if (logInterval != 0 && frameCount % logInterval == 0) {
+    printStats(std::cout);
+  }
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+  if (!supported) return UINT32_MAX;
+
+  // out of queries for this frame, the scope is dropped. the stats of
+  // whatever comes after it are missing then, which is said once.
+  if (nextQuery + 2 > firstQuery(currentFrame) + maxScopesPerFrame * 2) {
+    if (!droppedScopes) {
+      std::cout << "[INFO] more than " << maxScopesPerFrame
+        << " GPU profiler scopes in a frame, the rest are dropped" << std::endl;
+      droppedScopes = true;
+    }
+    return UINT32_MAX;
+  }
+
+  uint32_t query = nextQuery;
+  nextQuery += 2;
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query);
+  pendingScopes[currentFrame].push_back({ getScopeIndex(name), query });
+  return query;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (!supported || scope == UINT32_MAX) return;
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, scope + 1);
+}
+
+void GpuProfiler::beginUpload(VkCommandBuffer commandBuffer) {
+  if (!supported) return;
+  vkCmdResetQueryPool(commandBuffer, queryPool, uploadQuery(), 2);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, uploadQuery());
+  uploadInProgress = true;
+}
+
+void GpuProfiler::endUpload(VkCommandBuffer commandBuffer) {
+  if (!supported || !uploadInProgress) return;
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, uploadQuery() + 1);
+}
+
+// only call this after the upload command buffer has finished executing,
+// (Buffers::endSingleTimeCommands waits for the queue to be idle)
+void GpuProfiler::collectUpload(const std::string& name) {
+  if (!supported || !uploadInProgress) return;
+  uploadInProgress = false;
+
+  uint64_t results[2];
+  VkResult result = vkGetQueryPoolResults(
+    device.getDevice(),
+    queryPool,
+    uploadQuery(),
+    2,
+    sizeof(results),
+    results,
+    sizeof(uint64_t),
+    VK_QUERY_RESULT_64_BIT);
+
+  if (result == VK_SUCCESS) {
+    addSample(getScopeIndex(name), results[0], results[1]);
+  }
+}
+
+size_t GpuProfiler::getScopeIndex(const std::string& name) {
+  auto found = scopeIndices.find(name);
+  if (found != scopeIndices.end()) {
+    return found->second;
+  }
+  size_t index = scopes.size();
+  scopes.push_back({ name, {}, 0 });
+  scopes.back().samples.reserve(HISTORY_SIZE);
+  scopeIndices[name] = index;
+  return index;
+}
+
+void GpuProfiler::addSample(size_t scopeIndex, uint64_t begin, uint64_t end) {
+  uint64_t ticks = ((end & timestampMask) - (begin & timestampMask)) & timestampMask;
+  double milliseconds = static_cast<double>(ticks) * timestampPeriod / 1e6;
+
+  // samples are kept in a ring buffer, overwriting the oldest
+  ScopeHistory& scope = scopes[scopeIndex];
+  if (scope.samples.size() < HISTORY_SIZE) {
+    scope.samples.push_back(milliseconds);
+  } else {
+    scope.samples[scope.next] = milliseconds;
+  }
+  scope.next = (scope.next + 1) % HISTORY_SIZE;
+  scope.total += milliseconds;
+  scope.count++;
+}
+
+GpuScopeStats GpuProfiler::calculateStats(const ScopeHistory& scope) const {
+  GpuScopeStats stats{};
+  stats.name = scope.name;
+  stats.samples = scope.samples.size();
+  stats.total = scope.total;
+  stats.count = scope.count;
+  if (scope.samples.empty()) {
+    return stats;
+  }
+
+  std::vector<double> sorted = scope.samples;
+  std::sort(sorted.begin(), sorted.end());
+
+  double sum = 0.0;
+  for (double sample : sorted) sum += sample;
+
+  stats.mean = sum / sorted.size();
+  stats.p50 = sorted[(sorted.size() - 1) * 50 / 100];
+  stats.p99 = sorted[(sorted.size() - 1) * 99 / 100];
+  return stats;
+}
+
+GpuScopeStats GpuProfiler::getStats(const std::string& name) const {
+  auto found = scopeIndices.find(name);
+  if (found == scopeIndices.end()) {
+    GpuScopeStats stats{};
+    stats.name = name;
+    return stats;
+  }
+  return calculateStats(scopes[found->second]);
+}
+
+std::vector<GpuScopeStats> GpuProfiler::getAllStats() const {
+  std::vector<GpuScopeStats> allStats;
+  allStats.reserve(scopes.size());
+  for (const auto& scope : scopes) {
+    allStats.push_back(calculateStats(scope));
+  }
+  return allStats;
+}
+
+void GpuProfiler::printStats(std::ostream& out) const {
+  out << "[GPU]" << std::fixed << std::setprecision(3);
+  for (const auto& stats : getAllStats()) {
+    out << " | " << stats.name
+      << " mean " << stats.mean
+      << " p50 " << stats.p50
+      << " p99 " << stats.p99 << " ms";
+  }
+  out << std::defaultfloat << std::endl;
+}
+
+void GpuProfiler::resetStats() {
+  for (auto& scope : scopes) {
+    scope.samples.clear();
+    scope.next = 0;
+    scope.total = 0.0;
+    scope.count = 0;
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Device;
+
+// rolling statistics for one named scope, all values in milliseconds
+struct GpuScopeStats {
+  std::string name;
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p99 = 0.0;
+  size_t samples = 0;
+  // every sample since the last resetStats(), not only the rolling window
+  double total = 0.0;
+  size_t count = 0;
+};
+
+// GPU timing using timestamp queries. each frame in flight owns its own
+// range of queries inside one query pool. results for a frame are read back
+// the next time that same frame index comes around (after its fence has
+// been waited on), so reading them never stalls the CPU.
+class GpuProfiler {
+public:
+  GpuProfiler(Device& device, uint32_t framesInFlight, uint32_t maxScopesPerFrame = 512);
+  ~GpuProfiler();
+
+  // false if the graphics queue cannot write timestamps,
+  // in which case every other call becomes a no-op.
+  bool isSupported() const { return supported; }
+
+  // collect the results from the last time this frame index was used,
+  // then reset its queries. must be called outside of a render pass.
+  void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+  void endFrame();
+
+  // returns a handle which needs to be passed back into endScope
+  uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+  void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // uploads are recorded into single time command buffers which are
+  // waited on immediately, so they have their own pair of queries which
+  // are read right after the submission has completed.
+  void beginUpload(VkCommandBuffer commandBuffer);
+  void endUpload(VkCommandBuffer commandBuffer);
+  void collectUpload(const std::string& name);
+
+  GpuScopeStats getStats(const std::string& name) const;
+  std::vector<GpuScopeStats> getAllStats() const;
+  void printStats(std::ostream& out) const;
+  // forget every sample collected so far, for example after a warm up
+  void resetStats();
+
+  // print a line of stats every n frames, 0 turns the log off
+  void setLogInterval(uint32_t frames) { logInterval = frames; }
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+private:
+  // how many samples are kept per scope to calculate the rolling stats
+  static const size_t HISTORY_SIZE = 128;
+
+  struct ScopeHistory {
+    std::string name;
+    std::vector<double> samples;
+    size_t next = 0;
+    double total = 0.0;
+    size_t count = 0;
+  };
+
+  struct PendingScope {
+    size_t scopeIndex;
+    uint32_t query;
+  };
+
+  Device& device;
+  uint32_t framesInFlight;
+  uint32_t maxScopesPerFrame;
+  bool supported = false;
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+
+  // nanoseconds per timestamp tick
+  double timestampPeriod = 1.0;
+  uint64_t timestampMask = ~0ull;
+
+  uint32_t currentFrame = 0;
+  uint32_t nextQuery = 0;
+  std::vector<std::vector<PendingScope>> pendingScopes;
+  bool uploadInProgress = false;
+  // a frame ran out of queries, it is only logged the first time
+  bool droppedScopes = false;
+
+  std::unordered_map<std::string, size_t> scopeIndices;
+  std::vector<ScopeHistory> scopes;
+
+  uint32_t logInterval = 0;
+  uint64_t frameCount = 0;
+
+  uint32_t firstQuery(uint32_t frameIndex) const { return frameIndex * maxScopesPerFrame * 2; }
+  uint32_t uploadQuery() const { return framesInFlight * maxScopesPerFrame * 2; }
+  size_t getScopeIndex(const std::string& name);
+  void addSample(size_t scopeIndex, uint64_t begin, uint64_t end);
+  GpuScopeStats calculateStats(const ScopeHistory& scope) const;
+};
@@ -0,0 +1,85 @@
+#include <stdexcept>
+#include "PipelineStatisticsQuery.h"
+#include "../core/Device.h"
+#include "../Debug.h"
+
+// the results are written in the order of the bits, lowest bit first
+static const VkQueryPipelineStatisticFlags STATISTICS =
+  VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+  VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+static const uint32_t STATISTICS_COUNT = 6;
+
+PipelineStatisticsQuery::PipelineStatisticsQuery(Device& device, uint32_t framesInFlight)
+  : device(device), framesInFlight(framesInFlight) {
+
+  if (!device.hasPipelineStatistics()) {
+    DEBUG_LOG("pipeline statistics queries are not supported");
+    return;
+  }
+
+  VkQueryPoolCreateInfo queryPoolInfo{};
+  queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  queryPoolInfo.queryCount = framesInFlight;
+  queryPoolInfo.pipelineStatistics = STATISTICS;
+
+  if (vkCreateQueryPool(device.getDevice(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline statistics query pool");
+  }
+
+  pending.resize(framesInFlight, false);
+  supported = true;
+}
+
+PipelineStatisticsQuery::~PipelineStatisticsQuery() {
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device.getDevice(), queryPool, nullptr);
+  }
+}
+
+void PipelineStatisticsQuery::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!supported) return;
+  currentFrame = frameIndex;
+
+  if (pending[frameIndex]) {
+    // one value per statistic, followed by the availability
+    uint64_t results[STATISTICS_COUNT + 1] = {};
+    vkGetQueryPoolResults(
+      device.getDevice(),
+      queryPool,
+      frameIndex,
+      1,
+      sizeof(results),
+      results,
+      sizeof(results),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (results[STATISTICS_COUNT] != 0) {
+      latest.inputAssemblyVertices = results[0];
+      latest.inputAssemblyPrimitives = results[1];
+      latest.vertexShaderInvocations = results[2];
+      latest.clippingInvocations = results[3];
+      latest.clippingPrimitives = results[4];
+      latest.fragmentShaderInvocations = results[5];
+      resultAvailable = true;
+    }
+    pending[frameIndex] = false;
+  }
+
+  vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex, 1);
+}
+
+void PipelineStatisticsQuery::begin(VkCommandBuffer commandBuffer) {
+  if (!supported) return;
+  vkCmdBeginQuery(commandBuffer, queryPool, currentFrame, 0);
+}
+
+void PipelineStatisticsQuery::end(VkCommandBuffer commandBuffer) {
+  if (!supported) return;
+  vkCmdEndQuery(commandBuffer, queryPool, currentFrame);
+  pending[currentFrame] = true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "RenderStats.h"
+
+class Device;
+
+// hardware pipeline statistics for one section of each frame.
+// like GpuProfiler, every frame in flight has its own query, and the result
+// is read back (without waiting) when that frame index is used again.
+// this requires the pipelineStatisticsQuery device feature, without it
+// every call is a no-op.
+class PipelineStatisticsQuery {
+public:
+  PipelineStatisticsQuery(Device& device, uint32_t framesInFlight);
+  ~PipelineStatisticsQuery();
+
+  bool isSupported() const { return supported; }
+
+  // reads the result from the last time this frame index was used into
+  // latest, then resets the query. must be called outside of a render pass.
+  void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  // surround the render pass with these, not inside of it
+  void begin(VkCommandBuffer commandBuffer);
+  void end(VkCommandBuffer commandBuffer);
+
+  // false until the first result has been read back
+  bool hasResult() const { return resultAvailable; }
+  const PipelineStatistics& getLatest() const { return latest; }
+
+  PipelineStatisticsQuery(const PipelineStatisticsQuery&) = delete;
+  PipelineStatisticsQuery& operator=(const PipelineStatisticsQuery&) = delete;
+
+private:
+  Device& device;
+  uint32_t framesInFlight;
+  bool supported = false;
+
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  uint32_t currentFrame = 0;
+  // which frame indices have a query that has been written to
+  std::vector<bool> pending;
+
+  bool resultAvailable = false;
+  PipelineStatistics latest;
+};
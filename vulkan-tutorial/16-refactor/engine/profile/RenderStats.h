@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+// counted on the CPU while recording a frame
+struct RenderCounters {
+  uint64_t drawCalls = 0;
+  uint64_t triangles = 0;
+  uint64_t pipelineBinds = 0;
+  uint64_t descriptorBinds = 0;
+  uint64_t vertexBufferBinds = 0;
+  uint64_t indexBufferBinds = 0;
+  // pipeline barriers recorded by the render graph
+  uint64_t barriers = 0;
+  // copies into device memory which happened since the previous frame
+  uint64_t uploads = 0;
+  uint64_t uploadBytes = 0;
+};
+
+// counted by the GPU during the main render pass.
+// comparing fragment invocations to the number of pixels on screen is a
+// measure of overdraw, input assembly vs. clipping shows how much
+// geometry is submitted but never makes it to the screen.
+struct PipelineStatistics {
+  uint64_t inputAssemblyVertices = 0;
+  uint64_t inputAssemblyPrimitives = 0;
+  uint64_t vertexShaderInvocations = 0;
+  uint64_t clippingInvocations = 0;
+  uint64_t clippingPrimitives = 0;
+  uint64_t fragmentShaderInvocations = 0;
+};
+
+struct FrameStats {
+  RenderCounters counters;
+  // the GPU results arrive a few frames late, they are from the most
+  // recent frame which has finished. false if the device has no support.
+  bool hasPipelineStatistics = false;
+  PipelineStatistics pipeline;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const FrameStats& stats) {
+  out << "[STATS] draws " << stats.counters.drawCalls
+    << " | triangles " << stats.counters.triangles
+    << " | pipeline binds " << stats.counters.pipelineBinds
+    << " | descriptor binds " << stats.counters.descriptorBinds
+    << " | vertex buffer binds " << stats.counters.vertexBufferBinds
+    << " | index buffer binds " << stats.counters.indexBufferBinds
+    << " | barriers " << stats.counters.barriers
+    << " | uploads " << stats.counters.uploads
+    << " (" << stats.counters.uploadBytes << " bytes)";
+  if (stats.hasPipelineStatistics) {
+    out << " | IA vertices " << stats.pipeline.inputAssemblyVertices
+      << " | IA primitives " << stats.pipeline.inputAssemblyPrimitives
+      << " | VS invocations " << stats.pipeline.vertexShaderInvocations
+      << " | clipping invocations " << stats.pipeline.clippingInvocations
+      << " | clipping primitives " << stats.pipeline.clippingPrimitives
+      << " | FS invocations " << stats.pipeline.fragmentShaderInvocations;
+  }
+  return out;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Trace.h"
+
+namespace {
+
+// per thread, around 1.5MB. at ~10 events per frame this is
+// close to two minutes of history at 60fps before wrapping.
+const uint64_t EVENTS_PER_THREAD = 1 << 16;
+
+struct TraceEvent {
+  const char* name;
+  uint64_t start;
+  uint64_t end;
+};
+
+// a TraceEvent which can be read while its thread overwrites it. the
+// fields are relaxed atomics, which are plain loads and stores on x86
+// and ARM, a torn read is thrown away by the reader (see copyEvents).
+struct TraceSlot {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<uint64_t> start{0};
+  std::atomic<uint64_t> end{0};
+};
+
+// only the owning thread writes into a buffer. it publishes each event
+// by incrementing count (release), readers only look at events below it.
+struct ThreadBuffer {
+  uint32_t threadId = 0;
+  std::atomic<uint64_t> count{0};
+  std::unique_ptr<TraceSlot[]> events;
+};
+
+const auto epoch = std::chrono::steady_clock::now();
+
+// the registry keeps every buffer alive, even after its thread has exited,
+// the lock is only taken once per thread, and while writing a trace file.
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+ThreadBuffer& getThreadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+    auto newBuffer = std::make_shared<ThreadBuffer>();
+    newBuffer->events.reset(new TraceSlot[EVENTS_PER_THREAD]);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    newBuffer->threadId = static_cast<uint32_t>(registry.size());
+    registry.push_back(newBuffer);
+    return newBuffer;
+  }();
+  return *buffer;
+}
+
+// the buffer's events, as of now. the thread keeps recording while they
+// are copied and may wrap around onto the oldest ones, those are dropped
+// once the copy is done: event i is overwritten by event i + EVENTS_PER_THREAD,
+// which can be in progress as soon as count reaches that.
+void copyEvents(const ThreadBuffer& buffer, std::vector<TraceEvent>& events) {
+  uint64_t count = buffer.count.load(std::memory_order_acquire);
+  uint64_t begin = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+  events.clear();
+  events.reserve(count - begin);
+  for (uint64_t i = begin; i < count; i++) {
+    const TraceSlot& slot = buffer.events[i % EVENTS_PER_THREAD];
+    events.push_back({
+      slot.name.load(std::memory_order_relaxed),
+      slot.start.load(std::memory_order_relaxed),
+      slot.end.load(std::memory_order_relaxed) });
+  }
+
+  // pairs with the fence in record(), if any of the above saw an event
+  // which overwrote slot i, count is now past i + EVENTS_PER_THREAD
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t after = buffer.count.load(std::memory_order_relaxed);
+  uint64_t valid = after >= EVENTS_PER_THREAD ? after - EVENTS_PER_THREAD + 1 : 0;
+  if (valid > begin) {
+    events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(std::min(valid, count) - begin));
+  }
+}
+
+void writeEscaped(std::ostream& out, const char* text) {
+  for (const char* c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') out << '\\';
+    out << *c;
+  }
+}
+
+}
+
+uint64_t Trace::now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - epoch).count());
+}
+
+void Trace::record(const char* name, uint64_t start, uint64_t end) {
+  ThreadBuffer& buffer = getThreadBuffer();
+  uint64_t index = buffer.count.load(std::memory_order_relaxed);
+  TraceSlot& slot = buffer.events[index % EVENTS_PER_THREAD];
+  // a reader which sees any of the stores below also sees count at index
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.start.store(start, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+// Chrome trace event format, "complete" events (ph: X) with times in microseconds
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+bool Trace::writeChromeTrace(const std::string& path) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffers = registry;
+  }
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  file << std::fixed << std::setprecision(3);
+  bool first = true;
+  std::vector<TraceEvent> events;
+  for (const auto& buffer : buffers) {
+    // copied first, writing the file is too slow to do while the thread
+    // records over the events
+    copyEvents(*buffer, events);
+    for (const TraceEvent& event : events) {
+      file << (first ? "" : ",") << "\n{\"name\":\"";
+      writeEscaped(file, event.name);
+      file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+        << ",\"ts\":" << event.start / 1000.0
+        << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+      first = false;
+    }
+  }
+  file << "\n]}\n";
+  return file.good();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Scoped CPU instrumentation, viewable in about://tracing or ui.perfetto.dev
+//
+// TRACE_SCOPE("name") times everything until the end of the current scope.
+// the name must be a string literal (only the pointer is stored).
+// every thread writes into its own fixed size ring buffer, so recording an
+// event never takes a lock. the oldest events are overwritten once full.
+// compile with -DDISABLE_TRACE to remove all instrumentation.
+class Trace {
+public:
+  class Scope {
+  public:
+    Scope(const char* name) : name(name), start(Trace::now()) {}
+    ~Scope() { Trace::record(name, start, Trace::now()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const char* name;
+    uint64_t start;
+  };
+
+  // nanoseconds since the program started
+  static uint64_t now();
+  static void record(const char* name, uint64_t start, uint64_t end);
+
+  // write every thread's events as Chrome trace event JSON.
+  // this can be called at any time from any thread.
+  static bool writeChromeTrace(const std::string& path);
+};
+
+#ifndef DISABLE_TRACE
+  #define TRACE_CONCAT_INNER(a, b) a##b
+  #define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+  #define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+  #define TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,120 @@
+#include <filesystem>
+#include "AssetCache.h"
+#include "../memory/TextureLoader.h"
+
+AssetCache::AssetCache(
+  Device& device,
+  Buffers& buffers,
+  DeletionQueue& deletionQueue,
+  MipGenerator* mipGenerator,
+  ThreadPool* threadPool)
+  : device(device),
+    buffers(buffers),
+    deletionQueue(deletionQueue),
+    mipGenerator(mipGenerator),
+    threadPool(threadPool) {}
+
+std::string AssetCache::makeKey(const std::string& path) {
+  // weakly, so that a missing file gets the loader's error and not this one
+  std::error_code error;
+  std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+  return error ? path : canonical.string();
+}
+
+// the deleter runs wherever the last reference goes away, which can be
+// in the middle of recording a frame that still uses the asset
+template <typename Asset>
+std::shared_ptr<Asset> AssetCache::share(std::unique_ptr<Asset> asset) {
+  DeletionQueue& queue = deletionQueue;
+  return std::shared_ptr<Asset>(asset.release(), [&queue](Asset* released) {
+    queue.push([released]() { delete released; });
+  });
+}
+
+std::shared_ptr<Texture> AssetCache::getTexture(const std::string& path) {
+  return getTextures({ path }).front();
+}
+
+std::vector<std::shared_ptr<Texture>> AssetCache::getTextures(const std::vector<std::string>& paths) {
+  std::vector<std::shared_ptr<Texture>> result(paths.size());
+  TextureLoader loader(device, buffers, mipGenerator, threadPool);
+  // the textures each loaded texture goes to, a path can be in paths twice
+  std::unordered_map<std::string, std::vector<size_t>> misses;
+  std::vector<std::string> missOrder;
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    std::string key = makeKey(paths[i]);
+    auto found = textures.find(key);
+    if (found != textures.end()) {
+      result[i] = found->second.lock();
+      if (result[i]) {
+        textureHits++;
+        continue;
+      }
+    }
+
+    auto pending = misses.find(key);
+    if (pending != misses.end()) {
+      textureHits++;
+      pending->second.push_back(i);
+      continue;
+    }
+    textureMisses++;
+    loader.add(paths[i]);
+    misses[key].push_back(i);
+    missOrder.push_back(key);
+  }
+  if (missOrder.empty()) return result;
+
+  std::vector<std::unique_ptr<Texture>> loaded = loader.upload();
+  for (size_t i = 0; i < missOrder.size(); i++) {
+    std::shared_ptr<Texture> texture = share(std::move(loaded[i]));
+    textures[missOrder[i]] = texture;
+    for (size_t index : misses[missOrder[i]]) result[index] = texture;
+  }
+  return result;
+}
+
+std::shared_ptr<Model> AssetCache::getModel(const std::string& path) {
+  std::string key = makeKey(path);
+  auto found = models.find(key);
+  if (found != models.end()) {
+    if (std::shared_ptr<Model> model = found->second.lock()) {
+      modelHits++;
+      return model;
+    }
+  }
+
+  modelMisses++;
+  std::shared_ptr<Model> model = share(std::make_unique<Model>(device, buffers, path));
+  models[key] = model;
+  return model;
+}
+
+AssetCacheStats AssetCache::getStats() const {
+  AssetCacheStats stats;
+  stats.textureHits = textureHits;
+  stats.textureMisses = textureMisses;
+  stats.modelHits = modelHits;
+  stats.modelMisses = modelMisses;
+  for (const auto& entry : textures) {
+    std::shared_ptr<Texture> texture = entry.second.lock();
+    if (!texture) continue;
+    stats.textures++;
+    stats.textureBytes += texture->getMemorySize();
+  }
+  for (const auto& entry : models) {
+    std::shared_ptr<Model> model = entry.second.lock();
+    if (!model) continue;
+    stats.models++;
+    stats.modelBytes += VkDeviceSize(model->vertexCount) * sizeof(Vertex) + VkDeviceSize(model->indexCount) * sizeof(uint32_t);
+  }
+  return stats;
+}
+
+void AssetCache::resetStats() {
+  textureHits = 0;
+  textureMisses = 0;
+  modelHits = 0;
+  modelMisses = 0;
+}
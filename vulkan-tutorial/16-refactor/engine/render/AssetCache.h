@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/Device.h"
+#include "../core/DeletionQueue.h"
+#include "../core/ThreadPool.h"
+#include "../memory/Buffers.h"
+#include "../memory/Texture.h"
+#include "MipGenerator.h"
+#include "Model.h"
+
+// how often a load was answered by the cache, and what it holds now
+struct AssetCacheStats {
+  uint64_t textureHits = 0;
+  uint64_t textureMisses = 0;
+  uint64_t modelHits = 0;
+  uint64_t modelMisses = 0;
+  // assets which are still referenced
+  size_t textures = 0;
+  size_t models = 0;
+  // the device memory of the textures, with their mip levels, and the
+  // vertex and index data of the models
+  VkDeviceSize textureBytes = 0;
+  VkDeviceSize modelBytes = 0;
+};
+
+// textures and models loaded from files, once per file. the same path
+// (after following "..", "." and symlinks) with the same options gives
+// back the same asset for as long as anyone holds on to it. the last
+// one to let go hands it to the deletion queue, so it is destroyed once
+// no frame in flight can be using it.
+//
+// assets made from memory are not cached, there is nothing to key them by.
+class AssetCache {
+public:
+  AssetCache(
+    Device& device,
+    Buffers& buffers,
+    DeletionQueue& deletionQueue,
+    MipGenerator* mipGenerator = nullptr,
+    ThreadPool* threadPool = nullptr);
+
+  std::shared_ptr<Texture> getTexture(const std::string& path);
+  // the ones not cached yet are uploaded in one submission
+  std::vector<std::shared_ptr<Texture>> getTextures(const std::vector<std::string>& paths);
+  std::shared_ptr<Model> getModel(const std::string& path);
+
+  AssetCacheStats getStats() const;
+  void resetStats();
+
+  AssetCache(const AssetCache&) = delete;
+  AssetCache& operator=(const AssetCache&) = delete;
+
+private:
+  Device& device;
+  Buffers& buffers;
+  DeletionQueue& deletionQueue;
+  MipGenerator* mipGenerator;
+  ThreadPool* threadPool;
+
+  // weak, the cache does not keep anything alive. an expired entry is
+  // replaced the next time its path is loaded.
+  std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+  std::unordered_map<std::string, std::weak_ptr<Model>> models;
+
+  uint64_t textureHits = 0;
+  uint64_t textureMisses = 0;
+  uint64_t modelHits = 0;
+  uint64_t modelMisses = 0;
+
+  // the key of a file. the loaders have no options which change what
+  // they make yet, except for the way texture mips are generated, which
+  // is the same for every texture of a cache.
+  static std::string makeKey(const std::string& path);
+
+  template <typename Asset>
+  std::shared_ptr<Asset> share(std::unique_ptr<Asset> asset);
+};
@@ -0,0 +1,13 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include "Camera.h"
+
+glm::mat4 Camera::getView() const {
+  return glm::lookAt(position, target, up);
+}
+
+glm::mat4 Camera::getProjection(float aspectRatio) const {
+  glm::mat4 projection = glm::perspective(fieldOfView, aspectRatio, nearPlane, farPlane);
+  // GLM was designed for OpenGL, where the Y coordinate of the clip coordinates is inverted
+  projection[1][1] *= -1;
+  return projection;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// a perspective camera looking from position towards target. the
+// renderer turns it into view and projection matrices once per frame.
+class Camera {
+public:
+  glm::vec3 position = glm::vec3(2.0f, 2.0f, 2.0f);
+  glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
+  glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
+  // vertical, in radians
+  float fieldOfView = glm::radians(45.0f);
+  float nearPlane = 0.1f;
+  float farPlane = 10.0f;
+
+  glm::mat4 getView() const;
+  // with Y pointing down, the way Vulkan's clip space has it
+  glm::mat4 getProjection(float aspectRatio) const;
+};
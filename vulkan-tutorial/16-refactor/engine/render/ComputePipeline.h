@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+// a compute shader with one descriptor set and an optional
+// block of push constants (0 for none)
+class ComputePipeline {
+public:
+  ComputePipeline(
+    VkDevice device,
+    const std::string& shaderPath,
+    VkDescriptorSetLayout descriptorSetLayout,
+    uint32_t pushConstantSize);
+  ~ComputePipeline();
+
+  VkPipeline get() const { return computePipeline; }
+  VkPipelineLayout getLayout() const { return pipelineLayout; }
+
+  ComputePipeline(const ComputePipeline&) = delete;
+  ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+private:
+  VkDevice device;
+  VkPipeline computePipeline;
+  VkPipelineLayout pipelineLayout;
+
+  VkShaderModule createShaderModule(const std::vector<char>& code);
+  std::vector<char> readFile(const std::string& filename);
+};
@@ -0,0 +1,98 @@
+#include <stdexcept>
+#include <algorithm>
+#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(
+  VkDevice device,
+  uint32_t setsPerPool,
+  std::vector<PoolRatio> ratios)
+  : device(device),
+    ratios(std::move(ratios)),
+    setsPerPool(setsPerPool) {}
+
+DescriptorAllocator::~DescriptorAllocator() {
+  if (currentPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(device, currentPool, nullptr);
+  for (VkDescriptorPool pool : fullPools) vkDestroyDescriptorPool(device, pool, nullptr);
+  for (VkDescriptorPool pool : freePools) vkDestroyDescriptorPool(device, pool, nullptr);
+}
+
+std::vector<DescriptorAllocator::PoolRatio> DescriptorAllocator::defaultRatios() {
+  return {
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.5f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.25f },
+  };
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets) {
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  for (const auto& ratio : ratios) {
+    uint32_t count = std::max(1u, static_cast<uint32_t>(ratio.ratio * maxSets));
+    poolSizes.push_back({ ratio.type, count });
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = maxSets;
+
+  VkDescriptorPool pool;
+  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor pool");
+  }
+  return pool;
+}
+
+// a pool which was reset if there is one, or a new one half again as large
+VkDescriptorPool DescriptorAllocator::nextPool() {
+  if (!freePools.empty()) {
+    VkDescriptorPool pool = freePools.back();
+    freePools.pop_back();
+    return pool;
+  }
+  VkDescriptorPool pool = createPool(setsPerPool);
+  setsPerPool = std::min(MAX_SETS_PER_POOL, setsPerPool + setsPerPool / 2);
+  return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+  return allocate(layout, 1).front();
+}
+
+std::vector<VkDescriptorSet> DescriptorAllocator::allocate(VkDescriptorSetLayout layout, uint32_t count) {
+  std::vector<VkDescriptorSetLayout> layouts(count, layout);
+  std::vector<VkDescriptorSet> sets(count);
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorSetCount = count;
+  allocInfo.pSetLayouts = layouts.data();
+
+  if (currentPool == VK_NULL_HANDLE) currentPool = nextPool();
+  allocInfo.descriptorPool = currentPool;
+  VkResult result = vkAllocateDescriptorSets(device, &allocInfo, sets.data());
+
+  // out of space, this pool is done. a fresh one gets one more try.
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+    fullPools.push_back(currentPool);
+    currentPool = nextPool();
+    allocInfo.descriptorPool = currentPool;
+    result = vkAllocateDescriptorSets(device, &allocInfo, sets.data());
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate descriptor sets");
+  }
+  return sets;
+}
+
+void DescriptorAllocator::reset() {
+  if (currentPool != VK_NULL_HANDLE) fullPools.push_back(currentPool);
+  currentPool = VK_NULL_HANDLE;
+  for (VkDescriptorPool pool : fullPools) {
+    vkResetDescriptorPool(device, pool, 0);
+    freePools.push_back(pool);
+  }
+  fullPools.clear();
+}
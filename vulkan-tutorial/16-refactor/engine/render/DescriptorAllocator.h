@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+// hands out descriptor sets from a chain of pools. when a pool runs out
+// another one is made (each larger than the last, up to a limit), so
+// there is no fixed number of sets to plan for. sets are never freed one
+// by one, reset() returns all of them at once and keeps the pools.
+class DescriptorAllocator {
+public:
+  // descriptors of each type per set, on average, in each pool
+  struct PoolRatio {
+    VkDescriptorType type;
+    float ratio;
+  };
+
+  DescriptorAllocator(
+    VkDevice device,
+    uint32_t setsPerPool = 64,
+    std::vector<PoolRatio> ratios = defaultRatios());
+  ~DescriptorAllocator();
+
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+  // all in the same pool
+  std::vector<VkDescriptorSet> allocate(VkDescriptorSetLayout layout, uint32_t count);
+
+  // every set allocated so far is invalid after this
+  void reset();
+
+  size_t getPoolCount() const { return fullPools.size() + freePools.size() + (currentPool ? 1 : 0); }
+
+  // uniform buffers and combined image samplers, what materials use,
+  // and a few of the other common types
+  static std::vector<PoolRatio> defaultRatios();
+
+  DescriptorAllocator(const DescriptorAllocator&) = delete;
+  DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+private:
+  // pools stop growing here, past a point larger pools only waste memory
+  static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+  VkDevice device;
+  std::vector<PoolRatio> ratios;
+  uint32_t setsPerPool;
+
+  VkDescriptorPool currentPool = VK_NULL_HANDLE;
+  std::vector<VkDescriptorPool> fullPools;
+  // reset, ready to be used again
+  std::vector<VkDescriptorPool> freePools;
+
+  VkDescriptorPool nextPool();
+  VkDescriptorPool createPool(uint32_t maxSets);
+};
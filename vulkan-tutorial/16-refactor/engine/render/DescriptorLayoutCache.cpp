@@ -0,0 +1,71 @@
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include "DescriptorLayoutCache.h"
+
+bool DescriptorLayoutCache::Binding::operator==(const Binding& other) const {
+  return binding == other.binding
+    && type == other.type
+    && count == other.count
+    && stages == other.stages
+    && immutableSamplers == other.immutableSamplers;
+}
+
+bool DescriptorLayoutCache::Key::operator==(const Key& other) const {
+  return flags == other.flags && bindings == other.bindings;
+}
+
+size_t DescriptorLayoutCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = key.flags;
+  auto combine = [&hash](size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  };
+  for (const auto& binding : key.bindings) {
+    combine(binding.binding);
+    combine(binding.type);
+    combine(binding.count);
+    combine(binding.stages);
+    for (VkSampler sampler : binding.immutableSamplers) {
+      combine(std::hash<uint64_t>()((uint64_t)(sampler)));
+    }
+  }
+  return hash;
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache() {
+  for (const auto& entry : layouts) {
+    vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+  }
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(const VkDescriptorSetLayoutCreateInfo& info) {
+  if (info.pNext != nullptr) {
+    throw std::runtime_error("descriptor layout cache does not support pNext chains");
+  }
+
+  Key key;
+  key.flags = info.flags;
+  for (uint32_t i = 0; i < info.bindingCount; i++) {
+    const VkDescriptorSetLayoutBinding& binding = info.pBindings[i];
+    Binding entry{ binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags, {} };
+    if (binding.pImmutableSamplers) {
+      entry.immutableSamplers.assign(
+        binding.pImmutableSamplers,
+        binding.pImmutableSamplers + binding.descriptorCount);
+    }
+    key.bindings.push_back(std::move(entry));
+  }
+  std::sort(key.bindings.begin(), key.bindings.end(), [](const Binding& a, const Binding& b) {
+    return a.binding < b.binding;
+  });
+
+  auto found = layouts.find(key);
+  if (found != layouts.end()) return found->second;
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(device, &info, nullptr, &layout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor set layout");
+  }
+  layouts.emplace(std::move(key), layout);
+  return layout;
+}
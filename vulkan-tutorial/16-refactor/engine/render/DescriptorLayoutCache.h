@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// one VkDescriptorSetLayout for every distinct set of bindings. every
+// material has the same bindings, so they all share one layout, and
+// pipelines made with the same layouts are compatible with each other.
+// layouts live as long as the cache.
+class DescriptorLayoutCache {
+public:
+  explicit DescriptorLayoutCache(VkDevice device) : device(device) {}
+  ~DescriptorLayoutCache();
+
+  // info must not have a pNext chain. the order of the bindings does
+  // not matter.
+  VkDescriptorSetLayout get(const VkDescriptorSetLayoutCreateInfo& info);
+
+  size_t size() const { return layouts.size(); }
+
+  DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+  DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+private:
+  struct Binding {
+    uint32_t binding;
+    VkDescriptorType type;
+    uint32_t count;
+    VkShaderStageFlags stages;
+    // the handles, the same sampler state is the same handle thanks to
+    // the sampler cache
+    std::vector<VkSampler> immutableSamplers;
+
+    bool operator==(const Binding& other) const;
+  };
+  struct Key {
+    VkDescriptorSetLayoutCreateFlags flags;
+    // sorted by binding
+    std::vector<Binding> bindings;
+
+    bool operator==(const Key& other) const;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  VkDevice device;
+  std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> layouts;
+};
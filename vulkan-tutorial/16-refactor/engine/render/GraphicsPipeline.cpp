@@ -13,11 +13,16 @@ GraphicsPipeline::~GraphicsPipeline() {
 }
 
 void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
-  auto vertShaderCode = readFile(config.vertPath);
-  auto fragShaderCode = readFile(config.fragPath);
+  // a depth only pipeline has no fragment shader
+  bool hasFragmentShader = !config.fragPath.empty();
 
+  auto vertShaderCode = readFile(config.vertPath);
   VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-  VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+  VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+  if (hasFragmentShader) {
+    auto fragShaderCode = readFile(config.fragPath);
+    fragShaderModule = createShaderModule(fragShaderCode);
+  }
 
   VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
   vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -36,13 +41,22 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
   // our custom Vertex type
   auto bindingDescription = Vertex::getBindingDescription();
   auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  // or only its positions
+  auto positionBindingDescription = Vertex::getPositionBindingDescription();
+  auto positionAttributeDescriptions = Vertex::getPositionAttributeDescriptions();
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
  	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+  if (config.positionOnly) {
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionAttributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = &positionBindingDescription;
+    vertexInputInfo.pVertexAttributeDescriptions = positionAttributeDescriptions.data();
+  } else {
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+  }
 
   VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
   inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -96,7 +110,8 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
 
   VkPipelineMultisampleStateCreateInfo multisampling{};
   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.sampleShadingEnable = VK_TRUE;
+  // per sample shading only matters when there is something to shade
+  multisampling.sampleShadingEnable = hasFragmentShader ? VK_TRUE : VK_FALSE;
   multisampling.rasterizationSamples = config.msaaSamples;
   multisampling.minSampleShading = 0.2f;
 	multisampling.pSampleMask = nullptr; // Optional
@@ -127,7 +142,8 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-	colorBlending.attachmentCount = 1;
+	// a depth only subpass has no color attachments to blend into
+	colorBlending.attachmentCount = hasFragmentShader ? 1 : 0;
 	colorBlending.pAttachments = &colorBlendAttachment;
 	colorBlending.blendConstants[0] = 0.0f; // Optional
 	colorBlending.blendConstants[1] = 0.0f; // Optional
@@ -136,11 +152,16 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  // 1 now that we are using uniforms, otherwise this would be 0
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &config.descriptorSetLayout;
-	// pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	// pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(config.descriptorSetLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = config.descriptorSetLayouts.data();
+
+	// small per draw data, like the model matrix, without a buffer
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = config.pushConstantSize;
+	pipelineLayoutInfo.pushConstantRangeCount = config.pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
   if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout");
@@ -149,8 +170,8 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
   VkPipelineDepthStencilStateCreateInfo depthStencil{};
   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencil.depthTestEnable = VK_TRUE;
-  depthStencil.depthWriteEnable = VK_TRUE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencil.depthWriteEnable = config.depthWrite ? VK_TRUE : VK_FALSE;
+  depthStencil.depthCompareOp = config.depthCompareOp;
   depthStencil.depthBoundsTestEnable = VK_FALSE;
   depthStencil.minDepthBounds = 0.0f; // Optional
   depthStencil.maxDepthBounds = 1.0f; // Optional
@@ -160,7 +181,7 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = hasFragmentShader ? 2 : 1;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -172,7 +193,7 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
   pipelineInfo.pDynamicState = &dynamicState;
   pipelineInfo.layout = pipelineLayout;
   pipelineInfo.renderPass = config.renderPass;
-  pipelineInfo.subpass = 0;
+  pipelineInfo.subpass = config.subpass;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
@@ -180,7 +201,9 @@ void GraphicsPipeline::createGraphicsPipeline(const PipelineConfig& config) {
     throw std::runtime_error("failed to create graphics pipeline");
   }
 
-  vkDestroyShaderModule(device, fragShaderModule, nullptr);
+  if (fragShaderModule != VK_NULL_HANDLE) {
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+  }
   vkDestroyShaderModule(device, vertShaderModule, nullptr);
 }
 
@@ -1,8 +1,8 @@
 #include "Material.h"
 #include "../geometry/Uniforms.h"
 #include "Renderer.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "../third_party/stb_image.h"
+#include "../memory/TextureLoader.h"
+#include "../memory/SamplerCache.h"
 
 Material::Material(
   Device& device,
@@ -17,6 +17,71 @@ Material::Material(
     texturePath(texturePath)
   {
 
+  // a batch of one, for many textures use a TextureLoader directly
+  TextureLoader loader = renderer.createTextureLoader();
+  loader.add(texturePath);
+  ownedTexture = std::move(loader.upload().front());
+  texture = ownedTexture.get();
+  init();
+}
+
+Material::Material(
+  Device& device,
+  Buffers& buffers,
+  SwapChain& swapChain,
+  Renderer& renderer,
+  const std::vector<uint8_t>& pixels,
+  uint32_t width,
+  uint32_t height)
+  : device(device),
+    buffers(buffers),
+    swapChain(swapChain),
+    renderer(renderer)
+  {
+
+  TextureLoader loader = renderer.createTextureLoader();
+  loader.add(pixels, width, height);
+  ownedTexture = std::move(loader.upload().front());
+  texture = ownedTexture.get();
+  init();
+}
+
+Material::Material(
+  Device& device,
+  Buffers& buffers,
+  SwapChain& swapChain,
+  Renderer& renderer,
+  Texture& texture)
+  : device(device),
+    buffers(buffers),
+    swapChain(swapChain),
+    renderer(renderer),
+    texture(&texture)
+  {
+
+  init();
+}
+
+Material::Material(
+  Device& device,
+  Buffers& buffers,
+  SwapChain& swapChain,
+  Renderer& renderer,
+  std::shared_ptr<Texture> texture)
+  : device(device),
+    buffers(buffers),
+    swapChain(swapChain),
+    renderer(renderer),
+    ownedTexture(std::move(texture))
+  {
+
+  this->texture = ownedTexture.get();
+  init();
+}
+
+void Material::init() {
+  // the layout has the sampler in it
+  createTextureSampler();
   createDescriptorSetLayout();
 
   // viking room example
@@ -26,7 +91,8 @@ Material::Material(
   config.renderPass = renderer.getRenderPass();
   config.extent = swapChain.getSwapChainExtent();
   config.msaaSamples = device.getMsaaSamples();
-  config.descriptorSetLayout = descriptorSetLayout;
+  // the camera and the model matrices come from the frame's set
+  config.descriptorSetLayouts = { renderer.getFrameSetLayout(), descriptorSetLayout };
   config.inputAssemblyTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
   /*config(*/
   /*  "./shaders/simple.vert.spv",*/
@@ -36,14 +102,25 @@ Material::Material(
   /*  device.getMsaaSamples(),*/
   /*  descriptorSetLayout),*/
 
-  createUniformBuffers();
-
-  createTextureImage();
-  createTextureImageView();
-  createTextureSampler();
-
   createDescriptorSets();
 
+  // with a depth pre-pass, depth has already been written by the time
+  // this pipeline runs, only the closest surface passes an EQUAL test.
+  if (renderer.hasDepthPrepass()) {
+    config.subpass = 1;
+    config.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    config.depthWrite = false;
+
+    PipelineConfig depthConfig = config;
+    depthConfig.vertPath = "./examples/viking_room/shaders/depth.vert.spv";
+    depthConfig.fragPath = "";
+    depthConfig.subpass = 0;
+    depthConfig.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthConfig.depthWrite = true;
+    depthConfig.positionOnly = true;
+    depthPipeline = std::make_unique<GraphicsPipeline>(device.getDevice(), depthConfig);
+  }
+
   graphicsPipeline = std::make_unique<GraphicsPipeline>(device.getDevice(), config);
   /*graphicsPipeline = GraphicsPipeline(device.getDevice(), config);*/
 }
@@ -53,42 +130,23 @@ void Material::updateExtent(VkExtent2D newExtent) {
   /*graphicsPipeline.config.extent = newExtent;*/
 }
 
-Material::~Material() {
-  vkDestroyDescriptorSetLayout(device.getDevice(), descriptorSetLayout, nullptr);
-
-  // textures
-  vkDestroySampler(device.getDevice(), textureSampler, nullptr);
-  vkDestroyImageView(device.getDevice(), textureImageView, nullptr);
-  vkDestroyImage(device.getDevice(), textureImage, nullptr);
-  vkFreeMemory(device.getDevice(), textureImageMemory, nullptr);
-
-  // uniforms
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroyBuffer(device.getDevice(), uniformBuffers[i], nullptr);
-    vkFreeMemory(device.getDevice(), uniformBuffersMemory[i], nullptr);
-  }
-}
+// the sampler, layout and descriptor sets belong to the renderer's
+// caches and allocator
+Material::~Material() {}
 
-// for uniforms
-// the rest of the uniform related code is in the Renderer class.
+// set 1, what is specific to the material. the camera is in set 0, which
+// the renderer owns, see Renderer::getFrameSetLayout.
 void Material::createDescriptorSetLayout() {
-  VkDescriptorSetLayoutBinding uboLayoutBinding{};
-  uboLayoutBinding.binding = 0;
-  uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  uboLayoutBinding.descriptorCount = 1;
-  uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-  // uboLayoutBinding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
-  uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
-
   VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-  samplerLayoutBinding.binding = 1;
+  samplerLayoutBinding.binding = 0;
   samplerLayoutBinding.descriptorCount = 1;
   samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  samplerLayoutBinding.pImmutableSamplers = nullptr;
+  // an immutable sampler is part of the layout, the descriptor set only
+  // holds the image, and drivers can bake the sampler into the shader
+  samplerLayoutBinding.pImmutableSamplers = &textureSampler;
   samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {
-    uboLayoutBinding,
+  std::array<VkDescriptorSetLayoutBinding, 1> bindings = {
     samplerLayoutBinding,
   };
 
@@ -97,57 +155,33 @@ void Material::createDescriptorSetLayout() {
   layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
   layoutInfo.pBindings = bindings.data();
 
-  if (vkCreateDescriptorSetLayout(device.getDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create descriptor set layout");
-  }
+  // every material has the same bindings (and sampler), so the same layout
+  descriptorSetLayout = renderer.getDescriptorLayoutCache().get(layoutInfo);
 }
 
 void Material::createDescriptorSets() {
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-
-  VkDescriptorSetAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = renderer.getDescriptorPool();
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-  allocInfo.pSetLayouts = layouts.data();
-
-  descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-  if (vkAllocateDescriptorSets(device.getDevice(), &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate descriptor sets");
-  }
+  descriptorSets = renderer.getDescriptorAllocator().allocate(
+    descriptorSetLayout,
+    static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+  textureVersions.assign(MAX_FRAMES_IN_FLIGHT, texture->getVersion());
 
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = uniformBuffers[i];
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(UniformBufferObject);
-
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = textureImageView;
+    imageInfo.imageView = texture->getImageView();
     imageInfo.sampler = textureSampler;
 
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[0].dstSet = descriptorSets[i];
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
-    descriptorWrites[0].pImageInfo = nullptr; // Optional
+    descriptorWrites[0].pImageInfo = &imageInfo;
+    descriptorWrites[0].pBufferInfo = nullptr; // Optional
     descriptorWrites[0].pTexelBufferView = nullptr; // Optional
 
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = descriptorSets[i];
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &imageInfo;
-    descriptorWrites[1].pBufferInfo = nullptr; // Optional
-    descriptorWrites[1].pTexelBufferView = nullptr; // Optional
-
     vkUpdateDescriptorSets(
       device.getDevice(),
       static_cast<uint32_t>(descriptorWrites.size()),
@@ -157,161 +191,31 @@ void Material::createDescriptorSets() {
   }
 }
 
-void Material::createUniformBuffers() {
-  VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    buffers.createBuffer(
-      bufferSize,
-      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      uniformBuffers[i],
-      uniformBuffersMemory[i]);
-    vkMapMemory(
-      device.getDevice(),
-      uniformBuffersMemory[i],
-      0,
-      bufferSize,
-      0,
-      &uniformBuffersMapped[i]);
-  }
-}
-
-void Material::updateUniformBuffer(uint32_t currentImage) {
-  static auto startTime = std::chrono::high_resolution_clock::now();
-  auto currentTime = std::chrono::high_resolution_clock::now();
-  float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
-  UniformBufferObject ubo{};
-  ubo.model = glm::rotate(
-    glm::mat4(1.0f),
-    time * glm::radians(90.0f),
-    glm::vec3(0.0f, 0.0f, 1.0f));
-  ubo.view = glm::lookAt(
-    glm::vec3(2.0f, 2.0f, 2.0f),
-    glm::vec3(0.0f, 0.0f, 0.0f),
-    glm::vec3(0.0f, 0.0f, 1.0f));
-  ubo.projection = glm::perspective(
-    glm::radians(45.0f),
-    swapChain.getSwapChainExtent().width / (float) swapChain.getSwapChainExtent().height,
-    0.1f,
-    10.0f);
-  ubo.projection[1][1] *= -1;
-
-  memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
-}
-
-void Material::createTextureImage() {
-  int texWidth, texHeight, texChannels;
-
-  stbi_uc* pixels = stbi_load(
-    texturePath.c_str(),
-    &texWidth,
-    &texHeight,
-    &texChannels,
-    STBI_rgb_alpha);
-
-  VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-  if (!pixels) {
-    throw std::runtime_error("failed to load texture image");
-  }
-  mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-
-  buffers.createBuffer(
-    imageSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    stagingBuffer,
-    stagingBufferMemory);
-
-  void* data;
-  vkMapMemory(device.getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, pixels, static_cast<size_t>(imageSize));
-  vkUnmapMemory(device.getDevice(), stagingBufferMemory);
-
-  stbi_image_free(pixels);
-
-  buffers.createImage(
-    static_cast<uint32_t>(texWidth),
-    static_cast<uint32_t>(texHeight),
-    mipLevels,
-    VK_SAMPLE_COUNT_1_BIT,
-    VK_FORMAT_R8G8B8A8_SRGB,
-    VK_IMAGE_TILING_OPTIMAL,
-    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    textureImage,
-    textureImageMemory
-  );
-
-  buffers.transitionImageLayout(
-    textureImage,
-    VK_FORMAT_R8G8B8A8_SRGB,
-    VK_IMAGE_LAYOUT_UNDEFINED,
-    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-    mipLevels);
-
-  buffers.copyBufferToImage(
-    stagingBuffer,
-    textureImage,
-    static_cast<uint32_t>(texWidth),
-    static_cast<uint32_t>(texHeight));
-
-  // present from before we added mipmaps
-  // transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
-
-  buffers.generateMipmaps(
-    textureImage,
-    VK_FORMAT_R8G8B8A8_SRGB,
-    texWidth,
-    texHeight,
-    mipLevels);
-
-  vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-  vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
-}
-
-void Material::createTextureImageView() {
-  textureImageView = buffers.createImageView(
-    textureImage,
-    VK_FORMAT_R8G8B8A8_SRGB,
-    VK_IMAGE_ASPECT_COLOR_BIT,
-    mipLevels);
+// the descriptor set of a frame can only be written once the frame is
+// done with it, so each one catches up with the texture on its own turn
+void Material::updateTexture(uint32_t currentImage) {
+  if (textureVersions[currentImage] == texture->getVersion()) return;
+  textureVersions[currentImage] = texture->getVersion();
+
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView = texture->getImageView();
+  imageInfo.sampler = textureSampler;
+
+  VkWriteDescriptorSet descriptorWrite{};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstSet = descriptorSets[currentImage];
+  descriptorWrite.dstBinding = 0;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pImageInfo = &imageInfo;
+
+  vkUpdateDescriptorSets(device.getDevice(), 1, &descriptorWrite, 0, nullptr);
 }
 
+// shared with every material which samples the same way, the cache owns it
 void Material::createTextureSampler() {
-  VkPhysicalDeviceProperties deviceProperties{};
-  vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &deviceProperties);
-
-  VkSamplerCreateInfo samplerInfo{};
-  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  samplerInfo.magFilter = VK_FILTER_LINEAR;
-  samplerInfo.minFilter = VK_FILTER_LINEAR;
-  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.anisotropyEnable = VK_TRUE;
-  samplerInfo.maxAnisotropy = deviceProperties.limits.maxSamplerAnisotropy;
-  samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-  samplerInfo.unnormalizedCoordinates = VK_FALSE;
-  samplerInfo.compareEnable = VK_FALSE;
-  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-  samplerInfo.maxLod = static_cast<float>(mipLevels);
-  // samplerInfo.minLod = static_cast<float>(mipLevels / 2);
-  samplerInfo.minLod = 0.0f; // Optional
-  samplerInfo.mipLodBias = 0.0f; // Optional
-
-  if (vkCreateSampler(device.getDevice(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create texture sampler");
-  }
+  textureSampler = renderer.getSamplerCache().get(SamplerCache::makeTextureInfo(device));
 }
 
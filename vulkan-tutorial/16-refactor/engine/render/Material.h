@@ -2,11 +2,14 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <memory>
 #include "../core/Device.h"
 #include "../core/SwapChain.h"
 #include "../memory/Buffers.h"
+#include "../memory/Texture.h"
 #include "GraphicsPipeline.h"
 #include "PipelineConfig.h"
+#include "../geometry/Uniforms.h"
 
 class Renderer;
 
@@ -18,18 +21,47 @@ public:
     SwapChain& swapChain,
     Renderer& renderer,
     std::string texturePath);
+  // texture from tightly packed RGBA8 pixels (sRGB), width * height * 4 bytes
+  Material(
+    Device& device,
+    Buffers& buffers,
+    SwapChain& swapChain,
+    Renderer& renderer,
+    const std::vector<uint8_t>& pixels,
+    uint32_t width,
+    uint32_t height);
+  // a texture uploaded by a TextureLoader, it has to outlive the material
+  Material(
+    Device& device,
+    Buffers& buffers,
+    SwapChain& swapChain,
+    Renderer& renderer,
+    Texture& texture);
+  // a shared texture, from the asset cache, which lives at least as long
+  // as the material
+  Material(
+    Device& device,
+    Buffers& buffers,
+    SwapChain& swapChain,
+    Renderer& renderer,
+    std::shared_ptr<Texture> texture);
 
   ~Material();
 
   VkPipeline getPipeline() const { return graphicsPipeline.get()->get(); }
   VkPipelineLayout getPipelineLayout() const { return graphicsPipeline.get()->getLayout(); }
+  // only exists if the renderer has a depth pre-pass
+  VkPipeline getDepthPipeline() const { return depthPipeline.get()->get(); }
+  VkPipelineLayout getDepthPipelineLayout() const { return depthPipeline.get()->getLayout(); }
 
   std::vector<VkDescriptorSet> getDescriptorSets() const { return descriptorSets; }
   VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
 
   void createDescriptorSets();
   void createDescriptorSetLayout();
-  void updateUniformBuffer(uint32_t currentImage);
+  // points the descriptor set of this frame at the image the texture
+  // has now, if it changed. call after waiting on the frame's fence.
+  void updateTexture(uint32_t currentImage);
   // essentially "recreateSwapChain"
   void updateExtent(VkExtent2D newExtent);
 
@@ -50,31 +82,28 @@ private:
   Renderer& renderer;
 
   std::unique_ptr<GraphicsPipeline> graphicsPipeline;
+  std::unique_ptr<GraphicsPipeline> depthPipeline;
 
   // descriptor sets are used for shader uniforms
   // this is used to create pipelineLayout,
-  // which in turn is used to create graphicsPipeline
+  // which in turn is used to create graphicsPipeline.
+  // owned by the renderer's layout cache.
   VkDescriptorSetLayout descriptorSetLayout;
 
-  // descriptor sets are automatically freed when the descriptor pool is destroyed
+  // descriptor sets are returned all at once when the renderer's
+  // descriptor allocator is reset
   std::vector<VkDescriptorSet> descriptorSets;
 
-  // uniforms
-  std::vector<VkBuffer> uniformBuffers;
-  std::vector<VkDeviceMemory> uniformBuffersMemory;
-  std::vector<void*> uniformBuffersMapped;
-
-  // texture
+  // texture. either borrowed, or owned here (alone or with others)
   std::string texturePath;
-  uint32_t mipLevels;
-  VkImage textureImage;
-  VkDeviceMemory textureImageMemory;
-  VkImageView textureImageView;
+  std::shared_ptr<Texture> ownedTexture;
+  Texture* texture = nullptr;
+  // owned by the renderer's sampler cache
   VkSampler textureSampler;
+  // the version of the texture each descriptor set points at
+  std::vector<uint32_t> textureVersions;
 
-  void createTextureImage();
-  void createTextureImageView();
+  void init();
   void createTextureSampler();
-  void createUniformBuffers();
 };
 
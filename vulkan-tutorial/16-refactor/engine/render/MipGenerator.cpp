@@ -0,0 +1,255 @@
+#include <stdexcept>
+#include <array>
+#include <algorithm>
+#include "MipGenerator.h"
+#include "../memory/Barriers.h"
+
+// the size of the tile one workgroup reduces to a single texel
+static const uint32_t TILE_SIZE = 64;
+
+MipGenerator::MipGenerator(Device& device, Buffers& buffers, uint32_t maxDispatches)
+  : device(device),
+    buffers(buffers),
+    maxDispatches(maxDispatches) {
+  createCounterBuffer();
+  createDescriptorSetLayout();
+  createDescriptorPool();
+
+  pipeline = std::make_unique<ComputePipeline>(
+    device.getDevice(),
+    "./engine/shaders/spd.comp.spv",
+    descriptorSetLayout,
+    sizeof(Constants));
+}
+
+MipGenerator::~MipGenerator() {
+  reset();
+  vkDestroyDescriptorPool(device.getDevice(), descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(device.getDevice(), descriptorSetLayout, nullptr);
+  vkDestroyBuffer(device.getDevice(), counterBuffer, nullptr);
+  vkFreeMemory(device.getDevice(), counterBufferMemory, nullptr);
+}
+
+// the levels are always written through R8G8B8A8_UNORM views
+bool MipGenerator::supports(VkFormat format) const {
+  if (format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB) return false;
+  if (format == VK_FORMAT_R8G8B8A8_SRGB && !device.hasImageViewUsage()) return false;
+
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+  return formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+}
+
+void MipGenerator::createCounterBuffer() {
+  VkDeviceSize size = sizeof(uint32_t) * maxDispatches;
+  buffers.createBuffer(
+    size,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    counterBuffer,
+    counterBufferMemory);
+
+  // zero once, every dispatch puts its counter back when it is done
+  VkCommandBuffer commandBuffer = buffers.beginSingleTimeCommands();
+  vkCmdFillBuffer(commandBuffer, counterBuffer, 0, size, 0);
+  buffers.endSingleTimeCommands(commandBuffer);
+}
+
+void MipGenerator::createDescriptorSetLayout() {
+  // source level, destination levels, counters
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[1].descriptorCount = MAX_LEVELS_PER_DISPATCH;
+  bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[2].binding = 2;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[2].descriptorCount = 1;
+  bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(device.getDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create mip generator descriptor set layout");
+  }
+}
+
+void MipGenerator::createDescriptorPool() {
+  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  poolSizes[0].descriptorCount = (1 + MAX_LEVELS_PER_DISPATCH) * maxDispatches;
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[1].descriptorCount = maxDispatches;
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = maxDispatches;
+
+  if (vkCreateDescriptorPool(device.getDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create mip generator descriptor pool");
+  }
+}
+
+// storage images can not be sRGB, the shader does the conversion itself
+VkImageView MipGenerator::createLevelView(VkImage image, VkFormat format, uint32_t level) {
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format == VK_FORMAT_R8G8B8A8_SRGB ? VK_FORMAT_R8G8B8A8_UNORM : format;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = level;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  VkImageView view;
+  if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create mip level image view");
+  }
+  views.push_back(view);
+  return view;
+}
+
+void MipGenerator::record(
+  VkCommandBuffer commandBuffer,
+  VkImage image,
+  VkFormat format,
+  uint32_t width,
+  uint32_t height,
+  uint32_t mipLevels
+) {
+  if (!supports(format)) {
+    throw std::runtime_error("mip generator does not support this image format");
+  }
+  if (mipLevels <= 1) return;
+
+  std::vector<VkImageView> levelViews(mipLevels);
+  for (uint32_t level = 0; level < mipLevels; level++) {
+    levelViews[level] = createLevelView(image, format, level);
+  }
+
+  // the second half of a dispatch reduces a single 64x64 tile, so a
+  // source larger than 4096 texels only gets 6 levels out of it, then
+  // the next dispatch carries on from the last level written.
+  uint32_t base = 0;
+  while (base + 1 < mipLevels) {
+    uint32_t baseWidth = std::max(width >> base, 1u);
+    uint32_t baseHeight = std::max(height >> base, 1u);
+    uint32_t reach = std::max(baseWidth, baseHeight) > TILE_SIZE * TILE_SIZE
+      ? MAX_LEVELS_PER_DISPATCH / 2
+      : MAX_LEVELS_PER_DISPATCH;
+    uint32_t levels = std::min(mipLevels - 1 - base, reach);
+
+    if (base > 0) {
+      ResourceState computeReadWrite = getResourceState(ResourceUsage::ComputeShaderReadWrite);
+      recordMemoryBarrier(commandBuffer, computeReadWrite, computeReadWrite);
+    }
+    dispatch(commandBuffer, levelViews, base, levels, baseWidth, baseHeight, format == VK_FORMAT_R8G8B8A8_SRGB);
+    base += levels;
+  }
+}
+
+void MipGenerator::dispatch(
+  VkCommandBuffer commandBuffer,
+  const std::vector<VkImageView>& levelViews,
+  uint32_t base,
+  uint32_t levels,
+  uint32_t width,
+  uint32_t height,
+  bool srgb
+) {
+  if (dispatchCount >= maxDispatches) {
+    throw std::runtime_error("too many mip generator dispatches before a reset");
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &descriptorSetLayout;
+
+  VkDescriptorSet descriptorSet;
+  if (vkAllocateDescriptorSets(device.getDevice(), &allocInfo, &descriptorSet) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate mip generator descriptor set");
+  }
+
+  VkDescriptorImageInfo sourceInfo{ VK_NULL_HANDLE, levelViews[base], VK_IMAGE_LAYOUT_GENERAL };
+  std::array<VkDescriptorImageInfo, MAX_LEVELS_PER_DISPATCH> destinationInfos{};
+  for (uint32_t i = 0; i < MAX_LEVELS_PER_DISPATCH; i++) {
+    uint32_t level = base + 1 + std::min(i, levels - 1);
+    destinationInfos[i] = { VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+  }
+  VkDescriptorBufferInfo counterInfo{ counterBuffer, 0, VK_WHOLE_SIZE };
+
+  std::array<VkWriteDescriptorSet, 3> writes{};
+  for (auto& write : writes) {
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  }
+  writes[0].dstBinding = 0;
+  writes[0].pImageInfo = &sourceInfo;
+  writes[1].dstBinding = 1;
+  writes[1].descriptorCount = MAX_LEVELS_PER_DISPATCH;
+  writes[1].pImageInfo = destinationInfos.data();
+  writes[2].dstBinding = 2;
+  writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  writes[2].pBufferInfo = &counterInfo;
+
+  vkUpdateDescriptorSets(
+    device.getDevice(),
+    static_cast<uint32_t>(writes.size()),
+    writes.data(),
+    0,
+    nullptr);
+
+  uint32_t groupsX = (width + TILE_SIZE - 1) / TILE_SIZE;
+  uint32_t groupsY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+  Constants constants{};
+  constants.sourceWidth = width;
+  constants.sourceHeight = height;
+  constants.levels = levels;
+  constants.srgb = srgb ? 1 : 0;
+  constants.workgroups = groupsX * groupsY;
+  constants.counter = dispatchCount++;
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->get());
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_COMPUTE,
+    pipeline->getLayout(),
+    0,
+    1,
+    &descriptorSet,
+    0,
+    nullptr);
+  vkCmdPushConstants(
+    commandBuffer,
+    pipeline->getLayout(),
+    VK_SHADER_STAGE_COMPUTE_BIT,
+    0,
+    sizeof(constants),
+    &constants);
+  vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+}
+
+void MipGenerator::reset() {
+  for (auto view : views) {
+    vkDestroyImageView(device.getDevice(), view, nullptr);
+  }
+  views.clear();
+  vkResetDescriptorPool(device.getDevice(), descriptorPool, 0);
+  dispatchCount = 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <vector>
+#include "../core/Device.h"
+#include "../memory/Buffers.h"
+#include "ComputePipeline.h"
+
+// fills in the mip chain of an RGBA8 image with a compute shader
+// (engine/shaders/spd.comp), up to 12 levels in a single dispatch instead
+// of a blit and two barriers per level. sRGB images are filtered in linear
+// space. unlike vkCmdBlitImage it does not need the format to support
+// linear filtering, only R8G8B8A8_UNORM storage images. sRGB images are
+// written through UNORM views, their own views must be made with
+// getViewUsage() since the sRGB format can not be a storage image.
+//
+// the image must be created with getImageUsage() and getImageFlags().
+class MipGenerator {
+public:
+  // levels made by one dispatch, from a source of at most 4096 texels
+  static const uint32_t MAX_LEVELS_PER_DISPATCH = 12;
+
+  // maxDispatches is how many can be recorded between calls to reset()
+  MipGenerator(Device& device, Buffers& buffers, uint32_t maxDispatches = 1024);
+  ~MipGenerator();
+
+  // whether this device can make the mips of images of this format
+  bool supports(VkFormat format) const;
+  static VkImageUsageFlags getImageUsage() { return VK_IMAGE_USAGE_STORAGE_BIT; }
+  // the sRGB image is written through UNORM views, and has the storage
+  // usage which its own format doesn't support
+  static VkImageCreateFlags getImageFlags(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_SRGB
+      ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT
+      : 0;
+  }
+  // the usage of the image's views other than the mip generator's own
+  static VkImageUsageFlags getViewUsage(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_SRGB ? VK_IMAGE_USAGE_SAMPLED_BIT : 0;
+  }
+
+  // writes levels 1 to mipLevels - 1 from level 0. every level must be in
+  // VK_IMAGE_LAYOUT_GENERAL, with level 0 visible to compute shaders, and
+  // they are left that way. a barrier after this is up to the caller.
+  void record(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    VkFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipLevels);
+
+  // frees the image views and descriptor sets of everything recorded
+  // since the last reset. the GPU must be done with all of it.
+  void reset();
+
+  MipGenerator(const MipGenerator&) = delete;
+  MipGenerator& operator=(const MipGenerator&) = delete;
+
+private:
+  // mirrored by spd.comp
+  struct Constants {
+    uint32_t sourceWidth;
+    uint32_t sourceHeight;
+    uint32_t levels;
+    uint32_t srgb;
+    uint32_t workgroups;
+    uint32_t counter;
+  };
+
+  Device& device;
+  Buffers& buffers;
+  uint32_t maxDispatches;
+  uint32_t dispatchCount = 0;
+
+  // one uint per dispatch, to find the last workgroup
+  VkBuffer counterBuffer;
+  VkDeviceMemory counterBufferMemory;
+
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSetLayout descriptorSetLayout;
+  std::unique_ptr<ComputePipeline> pipeline;
+  std::vector<VkImageView> views;
+
+  void createCounterBuffer();
+  void createDescriptorSetLayout();
+  void createDescriptorPool();
+  VkImageView createLevelView(VkImage image, VkFormat format, uint32_t level);
+  void dispatch(
+    VkCommandBuffer commandBuffer,
+    const std::vector<VkImageView>& levelViews,
+    uint32_t base,
+    uint32_t levels,
+    uint32_t width,
+    uint32_t height,
+    bool srgb);
+};
@@ -1,23 +1,87 @@
 #include <stdio.h>
+#include <limits>
+#include <algorithm>
 #include "Model.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "../third_party/tiny_obj_loader.h"
 
+// the positions are copied out on their own, for the depth only passes.
+// the bounds are not the smallest sphere, but a cheap one, centered on
+// the bounding box.
+static MeshData meshOf(
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices,
+  std::vector<glm::vec3>& positions) {
+  positions.clear();
+  positions.reserve(vertices.size());
+  glm::vec3 minimum(std::numeric_limits<float>::max());
+  glm::vec3 maximum(std::numeric_limits<float>::lowest());
+  for (const auto& vertex : vertices) {
+    positions.push_back(vertex.position);
+    minimum = glm::min(minimum, vertex.position);
+    maximum = glm::max(maximum, vertex.position);
+  }
+
+  MeshData mesh;
+  mesh.vertices = vertices.data();
+  mesh.positions = positions.data();
+  mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+  mesh.indices = indices.data();
+  mesh.indexCount = static_cast<uint32_t>(indices.size());
+  mesh.boundsCenter = (minimum + maximum) * 0.5f;
+  mesh.boundsRadius = 0.0f;
+  for (const auto& position : positions) {
+    mesh.boundsRadius = std::max(mesh.boundsRadius, glm::length(position - mesh.boundsCenter));
+  }
+  return mesh;
+}
+
 Model::Model(Device& device, Buffers& buffers, std::string modelPath)
   : device(device), buffers(buffers) {
-  loadObj(modelPath);
-  createVertexBuffer();
-  createIndexBuffer();
+  // uploaded straight from the mapped file
+  if (auto cache = MeshCache::open(modelPath)) {
+    create(cache->getMesh());
+    return;
+  }
+
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  loadObj(modelPath, vertices, indices);
+  if (vertices.empty() || indices.empty()) {
+    throw std::runtime_error("model has no geometry " + modelPath);
+  }
+  std::vector<glm::vec3> positions;
+  MeshData mesh = meshOf(vertices, indices, positions);
+  create(mesh);
+  MeshCache::write(modelPath, mesh);
+}
+
+Model::Model(
+  Device& device,
+  Buffers& buffers,
+  const std::vector<Vertex>& vertices,
+  const std::vector<uint32_t>& indices)
+  : device(device), buffers(buffers) {
+  if (vertices.empty() || indices.empty()) {
+    throw std::runtime_error("model has no geometry");
+  }
+  std::vector<glm::vec3> positions;
+  create(meshOf(vertices, indices, positions));
 }
 
 Model::~Model() {
+  vkDestroyBuffer(device.getDevice(), positionBuffer, nullptr);
+  vkFreeMemory(device.getDevice(), positionBufferMemory, nullptr);
   vkDestroyBuffer(device.getDevice(), indexBuffer, nullptr);
   vkFreeMemory(device.getDevice(), indexBufferMemory, nullptr);
   vkDestroyBuffer(device.getDevice(), vertexBuffer, nullptr);
   vkFreeMemory(device.getDevice(), vertexBufferMemory, nullptr);
 }
 
-void Model::loadObj(std::string modelPath) {
+void Model::loadObj(
+  const std::string& modelPath,
+  std::vector<Vertex>& vertices,
+  std::vector<uint32_t>& indices) {
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
@@ -56,62 +120,60 @@ void Model::loadObj(std::string modelPath) {
   }
 }
 
-void Model::createVertexBuffer() {
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+void Model::create(const MeshData& mesh) {
+  vertexCount = mesh.vertexCount;
+  indexCount = mesh.indexCount;
+  boundsCenter = mesh.boundsCenter;
+  boundsRadius = mesh.boundsRadius;
+  uploadBuffer(
+    mesh.vertices,
+    sizeof(Vertex) * mesh.vertexCount,
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    vertexBuffer,
+    vertexBufferMemory);
+  uploadBuffer(
+    mesh.positions,
+    sizeof(glm::vec3) * mesh.vertexCount,
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    positionBuffer,
+    positionBufferMemory);
+  uploadBuffer(
+    mesh.indices,
+    sizeof(uint32_t) * mesh.indexCount,
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    indexBuffer,
+    indexBufferMemory);
+}
 
+// copy data into a new device local buffer, by way of a staging buffer
+void Model::uploadBuffer(
+  const void* data,
+  VkDeviceSize size,
+  VkBufferUsageFlags usage,
+  VkBuffer& buffer,
+  VkDeviceMemory& bufferMemory) {
   VkBuffer stagingBuffer;
   VkDeviceMemory stagingBufferMemory;
   buffers.createBuffer(
-    bufferSize,
+    size,
     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
     stagingBuffer,
     stagingBufferMemory);
 
-  void* data;
-  vkMapMemory(device.getDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, vertices.data(), (size_t)bufferSize);
+  void* mapped;
+  vkMapMemory(device.getDevice(), stagingBufferMemory, 0, size, 0, &mapped);
+  memcpy(mapped, data, (size_t)size);
   vkUnmapMemory(device.getDevice(), stagingBufferMemory);
 
   buffers.createBuffer(
-    bufferSize,
-    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    size,
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    vertexBuffer,
-    vertexBufferMemory);
-
-  buffers.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    buffer,
+    bufferMemory);
+  buffers.copyBuffer(stagingBuffer, buffer, size);
 
   vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
   vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
 }
-
-void Model::createIndexBuffer() {
-  VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
-
-  VkBuffer indexStagingBuffer;
-  VkDeviceMemory indexStagingBufferMemory;
-  buffers.createBuffer(
-    indexBufferSize,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    indexStagingBuffer,
-    indexStagingBufferMemory);
-
-  void* indexData;
-  vkMapMemory(device.getDevice(), indexStagingBufferMemory, 0, indexBufferSize, 0, &indexData);
-  memcpy(indexData, indices.data(), (size_t)indexBufferSize);
-  vkUnmapMemory(device.getDevice(), indexStagingBufferMemory);
-
-  buffers.createBuffer(
-    indexBufferSize,
-    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-    indexBuffer,
-    indexBufferMemory);
-  buffers.copyBuffer(indexStagingBuffer, indexBuffer, indexBufferSize);
-
-  vkDestroyBuffer(device.getDevice(), indexStagingBuffer, nullptr);
-  vkFreeMemory(device.getDevice(), indexStagingBufferMemory, nullptr);
-}
-
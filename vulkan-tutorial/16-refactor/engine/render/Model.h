@@ -6,24 +6,41 @@
 #include "../core/Device.h"
 #include "../memory/Buffers.h"
 #include "../geometry/Vertex.h"
+#include "../geometry/MeshCache.h"
 
 class Model {
 public:
+  // an OBJ file, from its MeshCache if that is up to date. otherwise the
+  // file is parsed and the cache written for next time.
   Model(
     Device& device,
     Buffers& buffers,
     std::string modelPath);
+  // build a model from geometry which already exists in memory
+  Model(
+    Device& device,
+    Buffers& buffers,
+    const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices);
   ~Model();
 
-  // the mesh geometry to be rendered
-  std::vector<Vertex> vertices;
-  std::vector<uint32_t> indices;
+  // the mesh geometry to be rendered is only kept on the GPU
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+
+  // a sphere in model space containing every vertex, used for culling
+  glm::vec3 boundsCenter;
+  float boundsRadius;
 
   // model
   VkBuffer vertexBuffer;
   VkDeviceMemory vertexBufferMemory;
   VkBuffer indexBuffer;
   VkDeviceMemory indexBufferMemory;
+  // vertex positions only, for depth only passes. this is a copy
+  // so that those passes fetch a third of the vertex data.
+  VkBuffer positionBuffer;
+  VkDeviceMemory positionBufferMemory;
 
   // Disallow copying
   Model(const Model&) = delete;
@@ -37,8 +54,17 @@ private:
   Device& device;
   Buffers& buffers;
 
-  void loadObj(std::string modelPath);
-  void createVertexBuffer();
-  void createIndexBuffer();
+  static void loadObj(
+    const std::string& modelPath,
+    std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices);
+  // fills in the bounds and every buffer
+  void create(const MeshData& mesh);
+  void uploadBuffer(
+    const void* data,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory);
 };
 
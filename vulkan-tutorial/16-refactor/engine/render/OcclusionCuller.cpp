@@ -0,0 +1,465 @@
+#include <stdexcept>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include "OcclusionCuller.h"
+#include "../memory/Barriers.h"
+
+OcclusionCuller::OcclusionCuller(
+  Device& device,
+  Buffers& buffers,
+  uint32_t framesInFlight,
+  uint32_t maxObjects)
+  : device(device),
+    buffers(buffers),
+    framesInFlight(framesInFlight),
+    maxObjects(maxObjects) {
+  createBuffers();
+  createSamplers();
+  createDescriptorSetLayouts();
+  createDescriptorPool();
+
+  cullPipeline = std::make_unique<ComputePipeline>(
+    device.getDevice(),
+    "./engine/shaders/cull.comp.spv",
+    cullSetLayout,
+    sizeof(CullConstants));
+  reducePipeline = std::make_unique<ComputePipeline>(
+    device.getDevice(),
+    "./engine/shaders/hiz_reduce.comp.spv",
+    reduceSetLayout,
+    sizeof(ReduceConstants));
+}
+
+OcclusionCuller::~OcclusionCuller() {
+  destroyPyramid();
+
+  vkDestroyDescriptorPool(device.getDevice(), descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(device.getDevice(), cullSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device.getDevice(), initSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device.getDevice(), reduceSetLayout, nullptr);
+
+  vkDestroySampler(device.getDevice(), pyramidSampler, nullptr);
+  vkDestroySampler(device.getDevice(), depthSampler, nullptr);
+
+  vkDestroyBuffer(device.getDevice(), visibilityBuffer, nullptr);
+  vkFreeMemory(device.getDevice(), visibilityBufferMemory, nullptr);
+  for (size_t i = 0; i < framesInFlight; i++) {
+    vkDestroyBuffer(device.getDevice(), objectBuffers[i], nullptr);
+    vkFreeMemory(device.getDevice(), objectBuffersMemory[i], nullptr);
+    vkDestroyBuffer(device.getDevice(), indirectBuffers[i], nullptr);
+    vkFreeMemory(device.getDevice(), indirectBuffersMemory[i], nullptr);
+  }
+}
+
+void OcclusionCuller::createBuffers() {
+  VkDeviceSize objectsSize = sizeof(CullObject) * maxObjects;
+  // early draws followed by late draws
+  VkDeviceSize indirectSize = sizeof(VkDrawIndexedIndirectCommand) * maxObjects * 2;
+
+  objectBuffers.resize(framesInFlight);
+  objectBuffersMemory.resize(framesInFlight);
+  objectBuffersMapped.resize(framesInFlight);
+  indirectBuffers.resize(framesInFlight);
+  indirectBuffersMemory.resize(framesInFlight);
+
+  for (size_t i = 0; i < framesInFlight; i++) {
+    buffers.createBuffer(
+      objectsSize,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      objectBuffers[i],
+      objectBuffersMemory[i]);
+    vkMapMemory(device.getDevice(), objectBuffersMemory[i], 0, objectsSize, 0, &objectBuffersMapped[i]);
+
+    buffers.createBuffer(
+      indirectSize,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      indirectBuffers[i],
+      indirectBuffersMemory[i]);
+  }
+
+  VkDeviceSize visibilitySize = sizeof(uint32_t) * maxObjects;
+  buffers.createBuffer(
+    visibilitySize,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    visibilityBuffer,
+    visibilityBufferMemory);
+
+  // nothing was visible before the first frame, it will all be drawn late
+  VkCommandBuffer commandBuffer = buffers.beginSingleTimeCommands();
+  vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, visibilitySize, 0);
+  buffers.endSingleTimeCommands(commandBuffer);
+}
+
+void OcclusionCuller::createSamplers() {
+  // both are only read with texelFetch, filtering never happens
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = static_cast<float>(MAX_PYRAMID_LEVELS);
+
+  if (vkCreateSampler(device.getDevice(), &samplerInfo, nullptr, &pyramidSampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create Hi-Z sampler");
+  }
+
+  samplerInfo.maxLod = 0.0f;
+  if (vkCreateSampler(device.getDevice(), &samplerInfo, nullptr, &depthSampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth sampler");
+  }
+}
+
+VkDescriptorSetLayout OcclusionCuller::createSetLayout(const std::vector<VkDescriptorType>& types) {
+  std::vector<VkDescriptorSetLayoutBinding> bindings(types.size());
+  for (size_t i = 0; i < types.size(); i++) {
+    bindings[i].binding = static_cast<uint32_t>(i);
+    bindings[i].descriptorType = types[i];
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  VkDescriptorSetLayout layout;
+  if (vkCreateDescriptorSetLayout(device.getDevice(), &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor set layout");
+  }
+  return layout;
+}
+
+void OcclusionCuller::createDescriptorSetLayouts() {
+  // objects, visibility, draws, pyramid
+  cullSetLayout = createSetLayout({
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+  });
+  // depth buffer, pyramid level 0
+  initSetLayout = createSetLayout({
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+  });
+  // pyramid level n - 1, pyramid level n
+  reduceSetLayout = createSetLayout({
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+  });
+}
+
+void OcclusionCuller::createDescriptorPool() {
+  std::array<VkDescriptorPoolSize, 3> poolSizes{};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[0].descriptorCount = 3 * framesInFlight;
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[1].descriptorCount = framesInFlight + 1;
+  poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  poolSizes[2].descriptorCount = 1 + 2 * MAX_PYRAMID_LEVELS;
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = framesInFlight + 1 + MAX_PYRAMID_LEVELS;
+
+  if (vkCreateDescriptorPool(device.getDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create occlusion culling descriptor pool");
+  }
+}
+
+void OcclusionCuller::resize(VkExtent2D extent, VkImageView depthImageView, VkSampleCountFlagBits samples) {
+  destroyPyramid();
+  vkResetDescriptorPool(device.getDevice(), descriptorPool, 0);
+
+  // reading a multisampled depth buffer needs a different shader
+  if (!initPipeline || samples != depthSamples) {
+    initPipeline = std::make_unique<ComputePipeline>(
+      device.getDevice(),
+      samples == VK_SAMPLE_COUNT_1_BIT
+        ? "./engine/shaders/hiz_init.comp.spv"
+        : "./engine/shaders/hiz_init_ms.comp.spv",
+      initSetLayout,
+      sizeof(InitConstants));
+  }
+  depthSamples = samples;
+
+  createPyramid(extent);
+  writeDescriptorSets(depthImageView);
+}
+
+// the pyramid is the same size as the depth buffer, every level
+// below is half the size of the one above it, rounded down.
+void OcclusionCuller::createPyramid(VkExtent2D extent) {
+  pyramidExtent = extent;
+  uint32_t largest = std::max(extent.width, extent.height);
+  pyramidLevels = static_cast<uint32_t>(std::floor(std::log2(largest))) + 1;
+  pyramidLevels = std::min(pyramidLevels, MAX_PYRAMID_LEVELS);
+
+  buffers.createImage(
+    extent.width,
+    extent.height,
+    pyramidLevels,
+    VK_SAMPLE_COUNT_1_BIT,
+    VK_FORMAT_R32_SFLOAT,
+    VK_IMAGE_TILING_OPTIMAL,
+    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    pyramidImage,
+    pyramidImageMemory);
+
+  pyramidView = buffers.createImageView(
+    pyramidImage,
+    VK_FORMAT_R32_SFLOAT,
+    VK_IMAGE_ASPECT_COLOR_BIT,
+    pyramidLevels);
+
+  pyramidLevelViews.resize(pyramidLevels);
+  for (uint32_t level = 0; level < pyramidLevels; level++) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramidImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = level;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &pyramidLevelViews[level]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create Hi-Z level image view");
+    }
+  }
+
+  // the pyramid stays in the general layout, it is written as a storage
+  // image and sampled, both from compute shaders.
+  buffers.transitionImageLayout(
+    pyramidImage,
+    VK_FORMAT_R32_SFLOAT,
+    VK_IMAGE_LAYOUT_UNDEFINED,
+    VK_IMAGE_LAYOUT_GENERAL,
+    pyramidLevels);
+}
+
+void OcclusionCuller::destroyPyramid() {
+  for (auto view : pyramidLevelViews) {
+    vkDestroyImageView(device.getDevice(), view, nullptr);
+  }
+  pyramidLevelViews.clear();
+  if (pyramidView != VK_NULL_HANDLE) {
+    vkDestroyImageView(device.getDevice(), pyramidView, nullptr);
+    vkDestroyImage(device.getDevice(), pyramidImage, nullptr);
+    vkFreeMemory(device.getDevice(), pyramidImageMemory, nullptr);
+    pyramidView = VK_NULL_HANDLE;
+    pyramidImage = VK_NULL_HANDLE;
+    pyramidImageMemory = VK_NULL_HANDLE;
+  }
+}
+
+void OcclusionCuller::writeDescriptorSets(VkImageView depthImageView) {
+  // allocate everything at once, the pool was just reset
+  std::vector<VkDescriptorSetLayout> layouts(framesInFlight, cullSetLayout);
+  layouts.push_back(initSetLayout);
+  for (uint32_t level = 1; level < pyramidLevels; level++) {
+    layouts.push_back(reduceSetLayout);
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+  allocInfo.pSetLayouts = layouts.data();
+
+  std::vector<VkDescriptorSet> sets(layouts.size());
+  if (vkAllocateDescriptorSets(device.getDevice(), &allocInfo, sets.data()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate occlusion culling descriptor sets");
+  }
+  cullSets.assign(sets.begin(), sets.begin() + framesInFlight);
+  initSet = sets[framesInFlight];
+  reduceSets.assign(sets.begin() + framesInFlight + 1, sets.end());
+
+  // the infos must outlive vkUpdateDescriptorSets, reserve so they never move
+  std::vector<VkDescriptorBufferInfo> bufferInfos;
+  std::vector<VkDescriptorImageInfo> imageInfos;
+  bufferInfos.reserve(3 * framesInFlight);
+  imageInfos.reserve(framesInFlight + 2 + 2 * pyramidLevels);
+  std::vector<VkWriteDescriptorSet> writes;
+
+  auto writeBuffer = [&](VkDescriptorSet set, uint32_t binding, VkBuffer buffer) {
+    bufferInfos.push_back({ buffer, 0, VK_WHOLE_SIZE });
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfos.back();
+    writes.push_back(write);
+  };
+  auto writeImage = [&](
+    VkDescriptorSet set,
+    uint32_t binding,
+    VkDescriptorType type,
+    VkSampler sampler,
+    VkImageView view,
+    VkImageLayout layout) {
+    imageInfos.push_back({ sampler, view, layout });
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+    write.pImageInfo = &imageInfos.back();
+    writes.push_back(write);
+  };
+
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    writeBuffer(cullSets[i], 0, objectBuffers[i]);
+    writeBuffer(cullSets[i], 1, visibilityBuffer);
+    writeBuffer(cullSets[i], 2, indirectBuffers[i]);
+    writeImage(
+      cullSets[i], 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      pyramidSampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL);
+  }
+
+  writeImage(
+    initSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    depthSampler, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+  writeImage(
+    initSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+    VK_NULL_HANDLE, pyramidLevelViews[0], VK_IMAGE_LAYOUT_GENERAL);
+
+  for (uint32_t level = 1; level < pyramidLevels; level++) {
+    writeImage(
+      reduceSets[level - 1], 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+      VK_NULL_HANDLE, pyramidLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL);
+    writeImage(
+      reduceSets[level - 1], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+      VK_NULL_HANDLE, pyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL);
+  }
+
+  vkUpdateDescriptorSets(
+    device.getDevice(),
+    static_cast<uint32_t>(writes.size()),
+    writes.data(),
+    0,
+    nullptr);
+}
+
+void OcclusionCuller::cullEarly(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount) {
+  cull(commandBuffer, frameIndex, objectCount, false);
+}
+
+void OcclusionCuller::cullLate(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount) {
+  cull(commandBuffer, frameIndex, objectCount, true);
+}
+
+void OcclusionCuller::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount, bool late) {
+  CullConstants constants{};
+  constants.objectCount = std::min(objectCount, maxObjects);
+  constants.late = late ? 1 : 0;
+  constants.maxObjects = maxObjects;
+  constants.pyramidLevels = pyramidLevels;
+  constants.pyramidSize = glm::vec2(pyramidExtent.width, pyramidExtent.height);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline->get());
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_COMPUTE,
+    cullPipeline->getLayout(),
+    0,
+    1,
+    &cullSets[frameIndex],
+    0,
+    nullptr);
+  vkCmdPushConstants(
+    commandBuffer,
+    cullPipeline->getLayout(),
+    VK_SHADER_STAGE_COMPUTE_BIT,
+    0,
+    sizeof(constants),
+    &constants);
+  vkCmdDispatch(commandBuffer, (constants.objectCount + 63) / 64, 1, 1);
+}
+
+void OcclusionCuller::buildPyramid(VkCommandBuffer commandBuffer) {
+  InitConstants initConstants{};
+  initConstants.width = pyramidExtent.width;
+  initConstants.height = pyramidExtent.height;
+  initConstants.samples = static_cast<uint32_t>(depthSamples);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, initPipeline->get());
+  vkCmdBindDescriptorSets(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_COMPUTE,
+    initPipeline->getLayout(),
+    0,
+    1,
+    &initSet,
+    0,
+    nullptr);
+  vkCmdPushConstants(
+    commandBuffer,
+    initPipeline->getLayout(),
+    VK_SHADER_STAGE_COMPUTE_BIT,
+    0,
+    sizeof(initConstants),
+    &initConstants);
+  vkCmdDispatch(commandBuffer, (pyramidExtent.width + 7) / 8, (pyramidExtent.height + 7) / 8, 1);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline->get());
+
+  uint32_t width = pyramidExtent.width;
+  uint32_t height = pyramidExtent.height;
+  ResourceState levelWritten = getResourceState(ResourceUsage::ComputeShaderWrite);
+  ResourceState levelRead = getResourceState(ResourceUsage::ComputeShaderRead, VK_IMAGE_LAYOUT_GENERAL);
+
+  for (uint32_t level = 1; level < pyramidLevels; level++) {
+    // wait for the level above to be finished
+    recordImageBarrier(
+      commandBuffer,
+      pyramidImage,
+      VK_IMAGE_ASPECT_COLOR_BIT,
+      level - 1,
+      1,
+      levelWritten,
+      levelRead);
+
+    ReduceConstants reduceConstants{};
+    reduceConstants.sourceWidth = width;
+    reduceConstants.sourceHeight = height;
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+    reduceConstants.destinationWidth = width;
+    reduceConstants.destinationHeight = height;
+
+    vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_COMPUTE,
+      reducePipeline->getLayout(),
+      0,
+      1,
+      &reduceSets[level - 1],
+      0,
+      nullptr);
+    vkCmdPushConstants(
+      commandBuffer,
+      reducePipeline->getLayout(),
+      VK_SHADER_STAGE_COMPUTE_BIT,
+      0,
+      sizeof(reduceConstants),
+      &reduceConstants);
+    vkCmdDispatch(commandBuffer, (width + 7) / 8, (height + 7) / 8, 1);
+  }
+}
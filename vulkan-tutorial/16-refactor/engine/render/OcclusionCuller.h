@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "../core/Device.h"
+#include "../memory/Buffers.h"
+#include "ComputePipeline.h"
+
+// one entry per render object, written by the CPU every frame.
+// this layout is mirrored by engine/shaders/cull.comp (std430)
+struct CullObject {
+  // view space center and radius of the bounding sphere
+  glm::vec4 sphere;
+  // P[0][0], P[1][1], P[2][2], P[3][2] of the projection matrix
+  glm::vec4 projection;
+  uint32_t indexCount;
+  uint32_t pad[3];
+};
+
+// GPU occlusion culling against a hierarchical depth (Hi-Z) pyramid.
+//
+// every frame is drawn in two phases:
+// - cullEarly writes an indirect draw for every object that was visible
+//   last frame and is inside the frustum, these are drawn first.
+// - buildPyramid reduces the resulting depth buffer into a mip chain where
+//   every texel holds the farthest depth of the pixels it covers.
+// - cullLate tests every object's bounds against the pyramid, and writes
+//   an indirect draw for those which are visible but were not drawn early,
+//   these are drawn in a second render pass on top of the first.
+// the late result becomes next frame's "visible last frame", an object
+// which comes out from behind an occluder is drawn in the late phase of
+// the same frame, so nothing pops in a frame late.
+class OcclusionCuller {
+public:
+  OcclusionCuller(Device& device, Buffers& buffers, uint32_t framesInFlight, uint32_t maxObjects);
+  ~OcclusionCuller();
+
+  // (re)create the pyramid to match the depth buffer. the depth buffer
+  // must be created with VK_IMAGE_USAGE_SAMPLED_BIT. the device must be idle.
+  void resize(VkExtent2D extent, VkImageView depthImageView, VkSampleCountFlagBits samples);
+
+  uint32_t getMaxObjects() const { return maxObjects; }
+  // host visible, fill in one CullObject per render object before recording
+  CullObject* getObjects(uint32_t frameIndex) const {
+    return static_cast<CullObject*>(objectBuffersMapped[frameIndex]);
+  }
+
+  // record these outside of a render pass. they only synchronize within
+  // themselves, the barriers between them and the render passes come from
+  // the RenderGraph, which needs the resources below. the depth buffer must
+  // be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL for buildPyramid.
+  void cullEarly(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount);
+  void buildPyramid(VkCommandBuffer commandBuffer);
+  void cullLate(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount);
+
+  // written by cullLate, read by the next cullEarly
+  VkBuffer getVisibilityBuffer() const { return visibilityBuffer; }
+  // always in VK_IMAGE_LAYOUT_GENERAL
+  VkImage getPyramidImage() const { return pyramidImage; }
+  uint32_t getPyramidLevels() const { return pyramidLevels; }
+
+  // one VkDrawIndexedIndirectCommand per object, per phase
+  VkBuffer getIndirectBuffer(uint32_t frameIndex) const { return indirectBuffers[frameIndex]; }
+  VkDeviceSize getEarlyDrawOffset(uint32_t object) const {
+    return object * sizeof(VkDrawIndexedIndirectCommand);
+  }
+  VkDeviceSize getLateDrawOffset(uint32_t object) const {
+    return (maxObjects + object) * sizeof(VkDrawIndexedIndirectCommand);
+  }
+
+  OcclusionCuller(const OcclusionCuller&) = delete;
+  OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+private:
+  // enough for a 32768 pixel wide depth buffer
+  static const uint32_t MAX_PYRAMID_LEVELS = 16;
+
+  struct CullConstants {
+    uint32_t objectCount;
+    uint32_t late;
+    uint32_t maxObjects;
+    uint32_t pyramidLevels;
+    glm::vec2 pyramidSize;
+  };
+
+  struct InitConstants {
+    uint32_t width;
+    uint32_t height;
+    uint32_t samples;
+  };
+
+  struct ReduceConstants {
+    uint32_t sourceWidth;
+    uint32_t sourceHeight;
+    uint32_t destinationWidth;
+    uint32_t destinationHeight;
+  };
+
+  Device& device;
+  Buffers& buffers;
+  uint32_t framesInFlight;
+  uint32_t maxObjects;
+
+  // per frame in flight
+  std::vector<VkBuffer> objectBuffers;
+  std::vector<VkDeviceMemory> objectBuffersMemory;
+  std::vector<void*> objectBuffersMapped;
+  std::vector<VkBuffer> indirectBuffers;
+  std::vector<VkDeviceMemory> indirectBuffersMemory;
+
+  // one uint per object, carried over from one frame to the next
+  VkBuffer visibilityBuffer;
+  VkDeviceMemory visibilityBufferMemory;
+
+  // the pyramid, one storage view per level for building,
+  // and one view of every level for sampling
+  VkExtent2D pyramidExtent{};
+  uint32_t pyramidLevels = 0;
+  VkImage pyramidImage = VK_NULL_HANDLE;
+  VkDeviceMemory pyramidImageMemory = VK_NULL_HANDLE;
+  VkImageView pyramidView = VK_NULL_HANDLE;
+  std::vector<VkImageView> pyramidLevelViews;
+  VkSampler pyramidSampler;
+  VkSampler depthSampler;
+  VkSampleCountFlagBits depthSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSetLayout cullSetLayout;
+  VkDescriptorSetLayout initSetLayout;
+  VkDescriptorSetLayout reduceSetLayout;
+  std::vector<VkDescriptorSet> cullSets;
+  VkDescriptorSet initSet;
+  std::vector<VkDescriptorSet> reduceSets;
+
+  std::unique_ptr<ComputePipeline> cullPipeline;
+  std::unique_ptr<ComputePipeline> initPipeline;
+  std::unique_ptr<ComputePipeline> reducePipeline;
+
+  void createBuffers();
+  void createSamplers();
+  void createDescriptorSetLayouts();
+  void createDescriptorPool();
+  void createPyramid(VkExtent2D extent);
+  void destroyPyramid();
+  void writeDescriptorSets(VkImageView depthImageView);
+  void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount, bool late);
+  VkDescriptorSetLayout createSetLayout(const std::vector<VkDescriptorType>& types);
+};
@@ -3,14 +3,24 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <cstdint>
+#include <vector>
 
 typedef struct PipelineConfig {
   std::string vertPath;
+  // leave empty for a depth only pipeline, without a fragment shader
   std::string fragPath;
   VkRenderPass renderPass = VK_NULL_HANDLE;
+  uint32_t subpass = 0;
   VkExtent2D extent;
   VkSampleCountFlagBits msaaSamples;
-  VkDescriptorSetLayout descriptorSetLayout;
+  // set 0 is the frame's, set 1 the material's
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+  // bytes of push constants for the vertex shader, 0 for none
+  uint32_t pushConstantSize = 0;
   VkPrimitiveTopology inputAssemblyTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+  bool depthWrite = true;
+  // read vertices from the position only stream, see Vertex
+  bool positionOnly = false;
 } PipelineConfig;
 
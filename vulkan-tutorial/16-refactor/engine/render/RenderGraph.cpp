@@ -0,0 +1,342 @@
+#include <stdexcept>
+#include <algorithm>
+#include "RenderGraph.h"
+#include "../profile/GpuProfiler.h"
+
+// non-dispatchable handles are pointers on 64 bit platforms and
+// 64 bit integers elsewhere, either way they fit in a key
+template <typename Handle>
+static uint64_t handleKey(Handle handle) {
+  return (uint64_t)(handle);
+}
+
+RenderGraph::ResourceId RenderGraph::importImage(
+  const std::string& name,
+  VkImage image,
+  VkImageAspectFlags aspect,
+  uint32_t mipLevels,
+  const ResourceState& initial
+) {
+  auto found = imageLookup.find(handleKey(image));
+  if (found != imageLookup.end()) return found->second;
+
+  Resource resource;
+  resource.name = name;
+  resource.image = image;
+  resource.aspect = aspect;
+  resource.mipLevels = mipLevels;
+  resource.layout = initial.layout;
+  if (initial.isWrite()) {
+    resource.writeStages = initial.stages;
+    resource.writeAccess = getWriteAccess(initial.access);
+  } else {
+    resource.readStages = initial.stages;
+  }
+
+  ResourceId id = static_cast<ResourceId>(resources.size());
+  resources.push_back(resource);
+  imageLookup[handleKey(image)] = id;
+  return id;
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(
+  const std::string& name,
+  VkBuffer buffer,
+  const ResourceState& initial
+) {
+  auto found = bufferLookup.find(handleKey(buffer));
+  if (found != bufferLookup.end()) return found->second;
+
+  Resource resource;
+  resource.name = name;
+  resource.buffer = buffer;
+  if (initial.isWrite()) {
+    resource.writeStages = initial.stages;
+    resource.writeAccess = getWriteAccess(initial.access);
+  } else {
+    resource.readStages = initial.stages;
+  }
+
+  ResourceId id = static_cast<ResourceId>(resources.size());
+  resources.push_back(resource);
+  bufferLookup[handleKey(buffer)] = id;
+  return id;
+}
+
+void RenderGraph::markOutput(ResourceId resource) {
+  resources.at(resource).output = true;
+}
+
+RenderGraph::PassId RenderGraph::addPass(
+  const std::string& name,
+  std::function<void(VkCommandBuffer)> record
+) {
+  Pass pass;
+  pass.name = name;
+  pass.record = std::move(record);
+  passes.push_back(std::move(pass));
+  return static_cast<PassId>(passes.size() - 1);
+}
+
+// a pass which uses a resource more than once gets one combined access,
+// a barrier between two uses inside the same pass would be recorded
+// before the pass, which is no use to anyone.
+void RenderGraph::read(PassId pass, ResourceId resource, const ResourceState& state) {
+  for (auto& access : passes.at(pass).accesses) {
+    if (access.resource != resource) continue;
+    access.state.stages |= state.stages;
+    access.state.access |= state.access;
+    return;
+  }
+  passes.at(pass).accesses.push_back({ resource, state, VK_IMAGE_LAYOUT_UNDEFINED, false });
+}
+
+void RenderGraph::write(
+  PassId pass,
+  ResourceId resource,
+  const ResourceState& state,
+  VkImageLayout finalLayout
+) {
+  for (auto& access : passes.at(pass).accesses) {
+    if (access.resource != resource) continue;
+    access.state.stages |= state.stages;
+    access.state.access |= state.access;
+    if (state.layout != VK_IMAGE_LAYOUT_UNDEFINED) access.state.layout = state.layout;
+    access.finalLayout = finalLayout;
+    access.write = true;
+    return;
+  }
+  passes.at(pass).accesses.push_back({ resource, state, finalLayout, true });
+}
+
+void RenderGraph::reset() {
+  passes.clear();
+  for (auto& resource : resources) resource.output = false;
+}
+
+void RenderGraph::clearResources() {
+  passes.clear();
+  resources.clear();
+  imageLookup.clear();
+  bufferLookup.clear();
+}
+
+// in declaration order: a read depends on the last write, a write on the
+// last write and on every read since (so it does not overwrite them).
+void RenderGraph::findDependencies() {
+  const int NONE = -1;
+  std::vector<int> lastWriter(resources.size(), NONE);
+  std::vector<std::vector<PassId>> readers(resources.size());
+
+  for (PassId id = 0; id < passes.size(); id++) {
+    Pass& pass = passes[id];
+    pass.dataDependencies.clear();
+    pass.orderDependencies.clear();
+    for (const auto& access : pass.accesses) {
+      int writer = lastWriter[access.resource];
+      if (writer != NONE && static_cast<PassId>(writer) != id) {
+        pass.dataDependencies.push_back(static_cast<PassId>(writer));
+      }
+      if (!access.write) {
+        readers[access.resource].push_back(id);
+        continue;
+      }
+      for (PassId reader : readers[access.resource]) {
+        if (reader != id) pass.orderDependencies.push_back(reader);
+      }
+      readers[access.resource].clear();
+      lastWriter[access.resource] = static_cast<int>(id);
+    }
+  }
+}
+
+// a pass lives if it writes an output, or a living pass needs its data.
+// dependencies only point backwards, so one sweep from the end is enough.
+std::vector<bool> RenderGraph::findLivePasses() const {
+  std::vector<bool> live(passes.size(), false);
+  for (PassId id = 0; id < passes.size(); id++) {
+    for (const auto& access : passes[id].accesses) {
+      if (access.write && resources[access.resource].output) live[id] = true;
+    }
+  }
+  for (size_t i = passes.size(); i-- > 0;) {
+    if (!live[i]) continue;
+    for (PassId dependency : passes[i].dataDependencies) live[dependency] = true;
+  }
+  return live;
+}
+
+// a topological sort. of the passes which are ready, the first one
+// declared which does not depend on the pass just scheduled goes next, so
+// that the GPU has other work to do while a barrier waits on a producer.
+std::vector<RenderGraph::PassId> RenderGraph::orderPasses(const std::vector<bool>& live) const {
+  std::vector<std::vector<PassId>> dependencies(passes.size());
+  std::vector<size_t> remaining(passes.size(), 0);
+  for (PassId id = 0; id < passes.size(); id++) {
+    if (!live[id]) continue;
+    for (PassId dependency : passes[id].dataDependencies) {
+      if (live[dependency]) dependencies[id].push_back(dependency);
+    }
+    for (PassId dependency : passes[id].orderDependencies) {
+      if (live[dependency]) dependencies[id].push_back(dependency);
+    }
+    std::sort(dependencies[id].begin(), dependencies[id].end());
+    dependencies[id].erase(
+      std::unique(dependencies[id].begin(), dependencies[id].end()),
+      dependencies[id].end());
+    remaining[id] = dependencies[id].size();
+  }
+
+  std::vector<PassId> ready;
+  for (PassId id = 0; id < passes.size(); id++) {
+    if (live[id] && remaining[id] == 0) ready.push_back(id);
+  }
+
+  std::vector<PassId> order;
+  while (!ready.empty()) {
+    size_t pick = 0;
+    if (!order.empty()) {
+      PassId previous = order.back();
+      for (size_t i = 0; i < ready.size(); i++) {
+        const auto& needs = dependencies[ready[i]];
+        if (!std::binary_search(needs.begin(), needs.end(), previous)) {
+          pick = i;
+          break;
+        }
+      }
+    }
+    PassId next = ready[pick];
+    ready.erase(ready.begin() + pick);
+    order.push_back(next);
+
+    for (PassId id = 0; id < passes.size(); id++) {
+      if (!live[id] || remaining[id] == 0) continue;
+      const auto& needs = dependencies[id];
+      if (std::binary_search(needs.begin(), needs.end(), next) && --remaining[id] == 0) {
+        ready.insert(std::upper_bound(ready.begin(), ready.end(), id), id);
+      }
+    }
+  }
+  return order;
+}
+
+void RenderGraph::addBarrier(BarrierBatch& batch, Resource& resource, const Access& access) {
+  const ResourceState& state = access.state;
+  bool isImage = resource.image != VK_NULL_HANDLE;
+  bool layoutChange = isImage
+    && state.layout != VK_IMAGE_LAYOUT_UNDEFINED
+    && state.layout != resource.layout;
+
+  // a write (or a layout transition, which is also a write) waits for
+  // everything before it. a read waits for the last write, unless an
+  // earlier barrier already made it visible to these stages.
+  VkPipelineStageFlags srcStages;
+  bool needed;
+  if (access.write || layoutChange) {
+    srcStages = resource.writeStages | resource.readStages;
+    needed = srcStages != 0 || layoutChange;
+  } else {
+    srcStages = resource.writeStages;
+    bool visible = (state.stages & ~resource.visibleStages) == 0
+      && (state.access & ~resource.visibleAccess) == 0;
+    needed = srcStages != 0 && !visible;
+  }
+
+  if (needed) {
+    batch.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    batch.dstStages |= state.stages;
+
+    // a write after read is only an execution dependency, which the
+    // stage masks above are enough for
+    if (isImage && (layoutChange || resource.writeAccess != 0)) {
+      VkImageMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.oldLayout = resource.layout;
+      barrier.newLayout = layoutChange ? state.layout : resource.layout;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = resource.image;
+      barrier.subresourceRange.aspectMask = resource.aspect;
+      barrier.subresourceRange.baseMipLevel = 0;
+      barrier.subresourceRange.levelCount = resource.mipLevels;
+      barrier.subresourceRange.baseArrayLayer = 0;
+      barrier.subresourceRange.layerCount = 1;
+      barrier.srcAccessMask = resource.writeAccess;
+      barrier.dstAccessMask = state.access;
+      batch.imageBarriers.push_back(barrier);
+    } else if (!isImage && resource.writeAccess != 0) {
+      // buffers share one global memory barrier
+      batch.memoryBarrier.srcAccessMask |= resource.writeAccess;
+      batch.memoryBarrier.dstAccessMask |= state.access;
+      batch.hasMemoryBarrier = true;
+    }
+  }
+
+  if (access.write) {
+    resource.writeStages = state.stages;
+    resource.writeAccess = getWriteAccess(state.access);
+    resource.readStages = 0;
+    resource.visibleStages = 0;
+    resource.visibleAccess = 0;
+  } else if (layoutChange) {
+    // later reads in other stages wait for the transition
+    resource.writeStages = state.stages;
+    resource.writeAccess = 0;
+    resource.readStages = state.stages;
+    resource.visibleStages = state.stages;
+    resource.visibleAccess = state.access;
+  } else {
+    resource.readStages |= state.stages;
+    if (needed) {
+      resource.visibleStages |= state.stages;
+      resource.visibleAccess |= state.access;
+    }
+  }
+
+  if (isImage) {
+    if (access.write && access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+      resource.layout = access.finalLayout;
+    } else if (state.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+      resource.layout = state.layout;
+    }
+  }
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+  findDependencies();
+  std::vector<bool> live = findLivePasses();
+  std::vector<PassId> order = orderPasses(live);
+
+  culledPassCount = passes.size() - order.size();
+  barrierCount = 0;
+  passOrder.clear();
+
+  for (PassId id : order) {
+    Pass& pass = passes[id];
+
+    BarrierBatch batch;
+    batch.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    for (const auto& access : pass.accesses) {
+      addBarrier(batch, resources[access.resource], access);
+    }
+    if (batch.srcStages != 0) {
+      vkCmdPipelineBarrier(
+        commandBuffer,
+        batch.srcStages,
+        batch.dstStages != 0 ? batch.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        batch.hasMemoryBarrier ? 1 : 0, batch.hasMemoryBarrier ? &batch.memoryBarrier : nullptr,
+        0, nullptr,
+        static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+      barrierCount++;
+    }
+
+    uint32_t scope = profiler
+      ? profiler->beginScope(commandBuffer, pass.name)
+      : UINT32_MAX;
+    pass.record(commandBuffer);
+    if (profiler) profiler->endScope(commandBuffer, scope);
+
+    passOrder.push_back(pass.name);
+  }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../memory/Barriers.h"
+
+class GpuProfiler;
+
+// a frame described as a list of passes, each of which declares the images
+// and buffers it reads and writes. from that, the graph:
+// - culls passes which do not contribute to an output,
+// - orders the passes, spacing out a producer and its consumer when
+//   another pass can go in between,
+// - records one batched pipeline barrier before each pass, with only
+//   the dependencies that pass needs, and tracks image layouts.
+//
+// resources are owned elsewhere and imported by handle. their state is
+// remembered from one frame to the next, so a graph can be reset and
+// rebuilt every frame and still know what the previous frame left behind.
+// a render pass (VkRenderPass) still transitions its own attachments,
+// declare its initial layout in the state (undefined when the contents are
+// cleared) and its final layout as the write's finalLayout.
+class RenderGraph {
+public:
+  using ResourceId = uint32_t;
+  using PassId = uint32_t;
+
+  // optional, every pass gets a GPU timing scope with its name if set
+  explicit RenderGraph(GpuProfiler* profiler = nullptr) : profiler(profiler) {}
+
+  // initial is only used the first time a handle is imported
+  ResourceId importImage(
+    const std::string& name,
+    VkImage image,
+    VkImageAspectFlags aspect,
+    uint32_t mipLevels,
+    const ResourceState& initial = ResourceState{});
+  ResourceId importBuffer(
+    const std::string& name,
+    VkBuffer buffer,
+    const ResourceState& initial = ResourceState{});
+  // the passes which contribute to this resource are kept this frame
+  void markOutput(ResourceId resource);
+
+  PassId addPass(const std::string& name, std::function<void(VkCommandBuffer)> record);
+  void read(PassId pass, ResourceId resource, const ResourceState& state);
+  void write(
+    PassId pass,
+    ResourceId resource,
+    const ResourceState& state,
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+  // record every pass which survived culling, in order, with barriers
+  void execute(VkCommandBuffer commandBuffer);
+
+  // forget the passes, keep the state of every resource
+  void reset();
+  // forget the resources as well, for example after the swap chain
+  // was recreated. the device must be idle.
+  void clearResources();
+
+  // from the last call to execute
+  size_t getCulledPassCount() const { return culledPassCount; }
+  size_t getBarrierCount() const { return barrierCount; }
+  const std::vector<std::string>& getPassOrder() const { return passOrder; }
+
+  RenderGraph(const RenderGraph&) = delete;
+  RenderGraph& operator=(const RenderGraph&) = delete;
+
+private:
+  struct Resource {
+    std::string name;
+    VkImage image = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkImageAspectFlags aspect = 0;
+    uint32_t mipLevels = 1;
+    bool output = false;
+
+    // what has happened to it so far
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags writeStages = 0;
+    VkAccessFlags writeAccess = 0;
+    // stages which read it since the last write
+    VkPipelineStageFlags readStages = 0;
+    // the stages and access the last write has already been made visible to
+    VkPipelineStageFlags visibleStages = 0;
+    VkAccessFlags visibleAccess = 0;
+  };
+
+  struct Access {
+    ResourceId resource;
+    ResourceState state;
+    VkImageLayout finalLayout;
+    bool write;
+  };
+
+  struct Pass {
+    std::string name;
+    std::function<void(VkCommandBuffer)> record;
+    std::vector<Access> accesses;
+    // passes this one has to come after. data dependencies keep their
+    // producers alive, order dependencies (write after read) only order.
+    std::vector<PassId> dataDependencies;
+    std::vector<PassId> orderDependencies;
+  };
+
+  struct BarrierBatch {
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkMemoryBarrier memoryBarrier{};
+    bool hasMemoryBarrier = false;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+  };
+
+  GpuProfiler* profiler;
+  std::vector<Resource> resources;
+  std::unordered_map<uint64_t, ResourceId> imageLookup;
+  std::unordered_map<uint64_t, ResourceId> bufferLookup;
+  std::vector<Pass> passes;
+
+  size_t culledPassCount = 0;
+  size_t barrierCount = 0;
+  std::vector<std::string> passOrder;
+
+  void findDependencies();
+  std::vector<bool> findLivePasses() const;
+  std::vector<PassId> orderPasses(const std::vector<bool>& live) const;
+  void addBarrier(BarrierBatch& batch, Resource& resource, const Access& access);
+};
@@ -5,7 +5,11 @@ RenderObject::RenderObject(Model& model, Material& material)
 
 void RenderObject::recordCommandBuffer(
   VkCommandBuffer commandBuffer,
-  uint32_t currentFrame
+  uint32_t currentFrame,
+  uint32_t objectIndex,
+  RenderCounters& counters,
+  VkBuffer indirectBuffer,
+  VkDeviceSize indirectOffset
 ) {
   // bind the graphics pipeline
   // the second parameter specifies if the pipeline is graphics or compute
@@ -13,6 +17,7 @@ void RenderObject::recordCommandBuffer(
     commandBuffer,
     VK_PIPELINE_BIND_POINT_GRAPHICS,
     material.getPipeline());
+  counters.pipelineBinds++;
 
   VkViewport viewport{};
 	viewport.x = 0.0f;
@@ -34,21 +39,92 @@ void RenderObject::recordCommandBuffer(
   // this used to be after vertex/index binding but before the draw call,
   // but now that we abstracted drawing into each object,
   // this has now been moved to be before vertex/index binding.
+  // set 0, the frame's, is bound once by the renderer.
   vkCmdBindDescriptorSets(
     commandBuffer,
     VK_PIPELINE_BIND_POINT_GRAPHICS,
     material.getPipelineLayout(),
-    0,
+    1,
     1,
     &(material.getDescriptorSets()[currentFrame]),
     0,
     nullptr);
+  counters.descriptorBinds++;
 
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 	vkCmdBindIndexBuffer(commandBuffer, model.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+  counters.vertexBufferBinds++;
+  counters.indexBufferBinds++;
 
 	// used previously before adding index buffers
-	// vkCmdDraw(commandBuffer, static_cast<uint32_t>(model.vertices.size()), 1, 0, 0);
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(model.indices.size()), 1, 0, 0, 0);
+	// vkCmdDraw(commandBuffer, model.vertexCount, 1, 0, 0);
+  recordDraw(commandBuffer, objectIndex, counters, indirectBuffer, indirectOffset);
+}
+
+
+void RenderObject::recordDepthCommandBuffer(
+  VkCommandBuffer commandBuffer,
+  uint32_t currentFrame,
+  uint32_t objectIndex,
+  RenderCounters& counters,
+  VkBuffer indirectBuffer,
+  VkDeviceSize indirectOffset
+) {
+  vkCmdBindPipeline(
+    commandBuffer,
+    VK_PIPELINE_BIND_POINT_GRAPHICS,
+    material.getDepthPipeline());
+  counters.pipelineBinds++;
+
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(material.config.extent.width);
+  viewport.height = static_cast<float>(material.config.extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.offset = {0, 0};
+  scissor.extent = material.config.extent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  // the depth pipeline only needs set 0, bound by the renderer, which has
+  // the camera and the same transform as in the shading subpass
+  VkBuffer vertexBuffers[] = {model.positionBuffer};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, model.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+  counters.vertexBufferBinds++;
+  counters.indexBufferBinds++;
+
+  recordDraw(commandBuffer, objectIndex, counters, indirectBuffer, indirectOffset);
 }
 
+void RenderObject::recordDraw(
+  VkCommandBuffer commandBuffer,
+  uint32_t objectIndex,
+  RenderCounters& counters,
+  VkBuffer indirectBuffer,
+  VkDeviceSize indirectOffset
+) {
+  counters.drawCalls++;
+  if (indirectBuffer == VK_NULL_HANDLE) {
+    // one instance, firstInstance picks out the object's data
+    vkCmdDrawIndexed(
+      commandBuffer, model.indexCount, 1, 0, 0, objectIndex);
+    counters.triangles += model.indexCount / 3;
+    return;
+  }
+  // the instance count is 0 or 1 depending on the culling, which only the
+  // GPU knows, so these triangles are not counted. the culling writes the
+  // object's index as firstInstance. the pipeline statistics
+  // (input assembly primitives) have the real number.
+  vkCmdDrawIndexedIndirect(
+    commandBuffer,
+    indirectBuffer,
+    indirectOffset,
+    1,
+    sizeof(VkDrawIndexedIndirectCommand));
+}
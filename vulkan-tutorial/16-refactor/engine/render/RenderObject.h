@@ -3,12 +3,40 @@
 #include <vulkan/vulkan.h>
 #include "Model.h"
 #include "Material.h"
+#include "../profile/RenderStats.h"
+#include "../geometry/Uniforms.h"
 
 class RenderObject {
 public:
   RenderObject(Model& model, Material& material);
 
-  void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+  // every command recorded here is tallied in counters.
+  // objectIndex is where this object's ObjectData is in the frame's
+  // object buffer, it goes into the draw as firstInstance.
+  // with an indirect buffer, the draw's parameters are read from it at the
+  // offset (one VkDrawIndexedIndirectCommand), as written by the GPU culling.
+  void recordCommandBuffer(
+    VkCommandBuffer commandBuffer,
+    uint32_t currentFrame,
+    uint32_t objectIndex,
+    RenderCounters& counters,
+    VkBuffer indirectBuffer = VK_NULL_HANDLE,
+    VkDeviceSize indirectOffset = 0);
+  // positions only, with the material's depth pipeline
+  void recordDepthCommandBuffer(
+    VkCommandBuffer commandBuffer,
+    uint32_t currentFrame,
+    uint32_t objectIndex,
+    RenderCounters& counters,
+    VkBuffer indirectBuffer = VK_NULL_HANDLE,
+    VkDeviceSize indirectOffset = 0);
+
+  Model& getModel() const { return model; }
+  Material& getMaterial() const { return material; }
+
+  // model space to world space, copied into the object buffer every frame
+  void setTransform(const glm::mat4& newTransform) { transform = newTransform; }
+  const glm::mat4& getTransform() const { return transform; }
 
   RenderObject(const RenderObject&) = delete;
   RenderObject& operator=(const RenderObject&) = delete;
@@ -18,5 +46,14 @@ public:
 private:
   Model& model;
   Material& material;
+  glm::mat4 transform = glm::mat4(1.0f);
+
+  // the draw call itself, shared by both of the above
+  void recordDraw(
+    VkCommandBuffer commandBuffer,
+    uint32_t objectIndex,
+    RenderCounters& counters,
+    VkBuffer indirectBuffer,
+    VkDeviceSize indirectOffset);
 };
 
@@ -1,6 +1,9 @@
 #include <stdexcept>
 #include <chrono>
 #include <array>
+#include <algorithm>
+#include <string>
+#include <cstring>
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -8,6 +11,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "Renderer.h"
 #include "../geometry/Uniforms.h"
+#include "../profile/Trace.h"
+#include "../memory/Barriers.h"
 
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
 	auto renderer = reinterpret_cast<Renderer*>(glfwGetWindowUserPointer(window));
@@ -18,14 +23,28 @@ bool hasStencilComponent(VkFormat format) {
   return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-Renderer::Renderer(Device& device, SwapChain& swapChain, Buffers& buffers)
+Renderer::Renderer(Device& device, SwapChain& swapChain, Buffers& buffers, const RendererOptions& options)
   : device(device),
     swapChain(swapChain),
-    buffers(buffers) {
+    buffers(buffers),
+    options(options) {
+
+  // the culling shader gives each indirect draw its object's index as
+  // firstInstance. without that, every object is drawn, unculled.
+  if (this->options.occlusionCulling && !device.hasDrawIndirectFirstInstance()) {
+    this->options.occlusionCulling = false;
+  }
+
+  // created first so that the uploads below are timed too
+  gpuProfiler = std::make_unique<GpuProfiler>(device, MAX_FRAMES_IN_FLIGHT);
+  buffers.setProfiler(gpuProfiler.get());
+  pipelineStatistics = std::make_unique<PipelineStatisticsQuery>(device, MAX_FRAMES_IN_FLIGHT);
+  renderGraph = std::make_unique<RenderGraph>(gpuProfiler.get());
 
   // this is needed for a few other things in this constructor
   createRenderPass();
-  createDescriptorPool();
+  createDescriptorAllocators();
+  createFrameUniformBuffers();
 
   /*swapChainBuffers = SwapChainBuffers(*/
   swapChainBuffers = std::make_unique<SwapChainBuffers>(
@@ -38,9 +57,31 @@ Renderer::Renderer(Device& device, SwapChain& swapChain, Buffers& buffers)
     swapChain.getSwapChainImageViews(),
     renderPass);
 
-  models.emplace_back(device, buffers, "./examples/viking_room/assets/viking_room.obj");
-  materials.emplace_back(device, buffers, swapChain, *this, "./examples/viking_room/assets/viking_room.png");
-  renderObjects.emplace_back(models[0], materials[0]);
+  if (options.occlusionCulling) {
+    occlusionCuller = std::make_unique<OcclusionCuller>(
+      device, buffers, MAX_FRAMES_IN_FLIGHT, MAX_CULLED_OBJECTS);
+    occlusionCuller->resize(
+      swapChain.getSwapChainExtent(),
+      swapChainBuffers->getDepthImageView(),
+      device.getMsaaSamples());
+  }
+
+  // textures are RGBA8 sRGB, see TextureLoader
+  VkFormatProperties textureFormatProperties;
+  vkGetPhysicalDeviceFormatProperties(
+    device.getPhysicalDevice(),
+    VK_FORMAT_R8G8B8A8_SRGB,
+    &textureFormatProperties);
+  bool canBlit = textureFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  if (options.computeMipmaps || !canBlit) {
+    mipGenerator = std::make_unique<MipGenerator>(device, buffers);
+  }
+
+  deletionQueue = std::make_unique<DeletionQueue>(MAX_FRAMES_IN_FLIGHT);
+  threadPool = std::make_unique<ThreadPool>();
+  samplerCache = std::make_unique<SamplerCache>(device);
+  assetCache = std::make_unique<AssetCache>(
+    device, buffers, *deletionQueue, mipGenerator.get(), threadPool.get());
 
   createCommandBuffers();
   createSyncObjects();
@@ -50,10 +91,25 @@ Renderer::Renderer(Device& device, SwapChain& swapChain, Buffers& buffers)
 }
 
 Renderer::~Renderer() {
+  // streamed textures and the images they replaced can still be in use
+  vkDeviceWaitIdle(device.getDevice());
+  renderObjects.clear();
+  materials.clear();
+  textureStreamer.reset();
+  textures.clear();
+  models.clear();
+  deletionQueue->flush();
+
+  buffers.setProfiler(nullptr);
   vkDestroyRenderPass(device.getDevice(), renderPass, nullptr);
-  vkDestroyDescriptorPool(device.getDevice(), descriptorPool, nullptr);
+  if (lateRenderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(device.getDevice(), lateRenderPass, nullptr);
+  }
 
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    vkDestroyBuffer(device.getDevice(), frameUniformBuffers[i], nullptr);
+    vkFreeMemory(device.getDevice(), frameUniformBuffersMemory[i], nullptr);
+    destroyObjectBuffer(i);
     vkDestroySemaphore(device.getDevice(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.getDevice(), imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device.getDevice(), inFlightFences[i], nullptr);
@@ -61,14 +117,27 @@ Renderer::~Renderer() {
 }
 
 void Renderer::createRenderPass() {
+  renderPass = createRenderPass(false);
+  if (options.occlusionCulling) {
+    lateRenderPass = createRenderPass(true);
+  }
+}
+
+// the late render pass has the same attachments and subpasses as the first
+// one (which makes the two compatible), only the load and store operations
+// and layouts differ. the barriers between the render passes and the
+// compute work around them come from the render graph.
+VkRenderPass Renderer::createRenderPass(bool late) {
+  bool culling = options.occlusionCulling;
+
   VkAttachmentDescription colorAttachment{};
   colorAttachment.format = swapChain.getSwapChainImageFormat();
   colorAttachment.samples = device.getMsaaSamples();
-  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.initialLayout = late ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
   colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
   VkAttachmentReference colorAttachmentRef{};
@@ -92,12 +161,20 @@ void Renderer::createRenderPass() {
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = buffers.findDepthFormat();
   depthAttachment.samples = device.getMsaaSamples();
-  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  // the first pass's depth is kept for the Hi-Z pyramid. the render graph
+  // moves it in and out of the read only layout the pyramid build samples.
+  if (culling && !late) {
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  }
+  if (late) {
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  }
 
   VkAttachmentReference depthAttachmentRef{};
   depthAttachmentRef.attachment = 1;
@@ -112,9 +189,57 @@ void Renderer::createRenderPass() {
 
   // The tutorial did not explicitly show itself creating this struct.
   VkSubpassDependency dependency{};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
   dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  // the swap chain image is not tracked by the render graph, and the first
+  // render pass has already resolved into it. the late pass resolves into
+  // it again, after those writes.
+  if (late) {
+    dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  }
+
+  std::vector<VkSubpassDescription> subpasses = { subpass };
+  std::vector<VkSubpassDependency> dependencies = { dependency };
+
+  // with a depth pre-pass, the subpass above becomes the second subpass.
+  // the first one only writes depth, the second one tests against it
+  // (EQUAL, no writes), so each pixel is shaded once.
+  if (options.depthPrepass) {
+    VkSubpassDescription depthSubpass{};
+    depthSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    depthSubpass.colorAttachmentCount = 0;
+    depthSubpass.pDepthStencilAttachment = &depthAttachmentRef;
+    subpasses.insert(subpasses.begin(), depthSubpass);
+
+    // the depth subpass waits on the previous frame like before, but the
+    // color and resolve attachments are first written by the color
+    // subpass, which has to wait on the swap chain image itself.
+    VkSubpassDependency colorDependency{};
+    colorDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    colorDependency.dstSubpass = 1;
+    colorDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    colorDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    colorDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    if (late) {
+      colorDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    }
+    dependencies.push_back(colorDependency);
+
+    // the color subpass waits on the depth subpass's writes.
+    VkSubpassDependency depthDependency{};
+    depthDependency.srcSubpass = 0;
+    depthDependency.dstSubpass = 1;
+    depthDependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    depthDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    dependencies.push_back(depthDependency);
+  }
 
   std::array<VkAttachmentDescription, 3> attachments = {
     colorAttachment,
@@ -125,21 +250,23 @@ void Renderer::createRenderPass() {
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
   renderPassInfo.pAttachments = attachments.data();
-  renderPassInfo.subpassCount = 1;
-  renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses = subpasses.data();
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
 
-  if (vkCreateRenderPass(device.getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+  VkRenderPass pass;
+  if (vkCreateRenderPass(device.getDevice(), &renderPassInfo, nullptr, &pass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass");
   }
+  return pass;
 }
 
 void Renderer::recreateSwapChain() {
 	swapChain.recreateSwapChain();
   
   for (auto& material : materials) {
-    material.updateExtent(swapChain.getSwapChainExtent());
+    material->updateExtent(swapChain.getSwapChainExtent());
   }
 
   // note: we are not recreating the render pass.
@@ -156,27 +283,179 @@ void Renderer::recreateSwapChain() {
     buffers.findDepthFormat(),
     swapChain.getSwapChainImageViews(),
     renderPass);
+
+  // every image the graph knew about is gone (or may be)
+  renderGraph->clearResources();
+
+  // the pyramid follows the size of the new depth buffer
+  if (occlusionCuller) {
+    occlusionCuller->resize(
+      swapChain.getSwapChainExtent(),
+      swapChainBuffers->getDepthImageView(),
+      device.getMsaaSamples());
+  }
 }
 
 // descriptor sets cannot be allocated directly they must be allocated from a pool,
-// just like how command buffers are allocated.
-// this is called in preparation to calling the create descriptor sets function.
-void Renderer::createDescriptorPool() {
-  std::array<VkDescriptorPoolSize, 2> poolSizes{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-  poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-  VkDescriptorPoolCreateInfo poolInfo{};
-  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-  poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-  if (vkCreateDescriptorPool(device.getDevice(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create descriptor pool");
+// just like how command buffers are allocated. the allocators make more
+// pools as they fill up.
+void Renderer::createDescriptorAllocators() {
+  descriptorLayoutCache = std::make_unique<DescriptorLayoutCache>(device.getDevice());
+  descriptorAllocator = std::make_unique<DescriptorAllocator>(device.getDevice());
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    frameDescriptorAllocators.push_back(std::make_unique<DescriptorAllocator>(device.getDevice()));
+  }
+}
+
+// set 0 of every pipeline, the camera and the objects. the set itself is
+// allocated every frame, from the frame's allocator.
+void Renderer::createFrameUniformBuffers() {
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  // a storage buffer, as many objects as there are, indexed by instance
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+  frameSetLayout = descriptorLayoutCache->get(layoutInfo);
+
+  VkDeviceSize bufferSize = sizeof(FrameUniforms);
+  frameUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  frameUniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+  frameUniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    buffers.createBuffer(
+      bufferSize,
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frameUniformBuffers[i],
+      frameUniformBuffersMemory[i]);
+    vkMapMemory(
+      device.getDevice(),
+      frameUniformBuffersMemory[i],
+      0,
+      bufferSize,
+      0,
+      &frameUniformBuffersMapped[i]);
   }
+
+  objectBuffers.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  objectBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+  objectBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT, nullptr);
+  objectBufferCapacities.resize(MAX_FRAMES_IN_FLIGHT, 0);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // not empty, even without objects the descriptor needs a buffer
+    createObjectBuffer(i, 64);
+  }
+}
+
+void Renderer::createObjectBuffer(size_t frame, size_t capacity) {
+  VkDeviceSize bufferSize = sizeof(ObjectData) * capacity;
+  buffers.createBuffer(
+    bufferSize,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    objectBuffers[frame],
+    objectBuffersMemory[frame]);
+  vkMapMemory(
+    device.getDevice(),
+    objectBuffersMemory[frame],
+    0,
+    bufferSize,
+    0,
+    &objectBuffersMapped[frame]);
+  objectBufferCapacities[frame] = capacity;
+}
+
+void Renderer::destroyObjectBuffer(size_t frame) {
+  if (objectBuffers[frame] == VK_NULL_HANDLE) return;
+  vkDestroyBuffer(device.getDevice(), objectBuffers[frame], nullptr);
+  vkFreeMemory(device.getDevice(), objectBuffersMemory[frame], nullptr);
+  objectBuffers[frame] = VK_NULL_HANDLE;
+  objectBuffersMemory[frame] = VK_NULL_HANDLE;
+  objectBuffersMapped[frame] = nullptr;
+  objectBufferCapacities[frame] = 0;
+}
+
+// the ObjectData of render object i is at index i, which is also its
+// draw's firstInstance. only this frame's buffer is touched, and the fence
+// of the frame which last used it has been waited on, so growing it can
+// destroy the old one straight away.
+void Renderer::updateObjectData() {
+  objectData.resize(renderObjects.size());
+  for (size_t i = 0; i < renderObjects.size(); i++) {
+    objectData[i].model = renderObjects[i].getTransform();
+  }
+
+  if (objectData.size() > objectBufferCapacities[currentFrame]) {
+    size_t capacity = objectBufferCapacities[currentFrame];
+    while (capacity < objectData.size()) capacity *= 2;
+    destroyObjectBuffer(currentFrame);
+    createObjectBuffer(currentFrame, capacity);
+  }
+
+  if (!objectData.empty()) {
+    memcpy(
+      objectBuffersMapped[currentFrame],
+      objectData.data(),
+      sizeof(ObjectData) * objectData.size());
+  }
+}
+
+// the camera's matrices are worked out once per frame, however many
+// materials and objects use them
+void Renderer::updateFrameUniforms() {
+  VkExtent2D extent = swapChain.getSwapChainExtent();
+  frameUniforms.view = camera.getView();
+  frameUniforms.projection = camera.getProjection(extent.width / (float) extent.height);
+  frameUniforms.viewProjection = frameUniforms.projection * frameUniforms.view;
+  memcpy(frameUniformBuffersMapped[currentFrame], &frameUniforms, sizeof(frameUniforms));
+  updateObjectData();
+
+  frameSet = frameDescriptorAllocators[currentFrame]->allocate(frameSetLayout);
+
+  VkDescriptorBufferInfo bufferInfo{};
+  bufferInfo.buffer = frameUniformBuffers[currentFrame];
+  bufferInfo.offset = 0;
+  bufferInfo.range = sizeof(FrameUniforms);
+
+  VkDescriptorBufferInfo objectBufferInfo{};
+  objectBufferInfo.buffer = objectBuffers[currentFrame];
+  objectBufferInfo.offset = 0;
+  objectBufferInfo.range = VK_WHOLE_SIZE;
+
+  std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+  descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrites[0].dstSet = frameSet;
+  descriptorWrites[0].dstBinding = 0;
+  descriptorWrites[0].dstArrayElement = 0;
+  descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  descriptorWrites[0].descriptorCount = 1;
+  descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+  descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrites[1].dstSet = frameSet;
+  descriptorWrites[1].dstBinding = 1;
+  descriptorWrites[1].dstArrayElement = 0;
+  descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  descriptorWrites[1].descriptorCount = 1;
+  descriptorWrites[1].pBufferInfo = &objectBufferInfo;
+
+  vkUpdateDescriptorSets(
+    device.getDevice(),
+    static_cast<uint32_t>(descriptorWrites.size()),
+    descriptorWrites.data(),
+    0,
+    nullptr);
 }
 
 void Renderer::createCommandBuffers() {
@@ -220,24 +499,113 @@ void Renderer::createSyncObjects() {
   }
 }
 
+Model& Renderer::addModel(const std::string& modelPath) {
+  models.push_back(assetCache->getModel(modelPath));
+  return *models.back();
+}
+
+Model& Renderer::addModel(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+  models.push_back(std::make_unique<Model>(device, buffers, vertices, indices));
+  return *models.back();
+}
+
+Material& Renderer::addMaterial(const std::string& texturePath) {
+  materials.push_back(std::make_unique<Material>(
+    device, buffers, swapChain, *this, assetCache->getTexture(texturePath)));
+  return *materials.back();
+}
+
+Material& Renderer::addMaterial(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+  materials.push_back(std::make_unique<Material>(device, buffers, swapChain, *this, pixels, width, height));
+  return *materials.back();
+}
+
+Material& Renderer::addMaterial(Texture& texture) {
+  materials.push_back(std::make_unique<Material>(device, buffers, swapChain, *this, texture));
+  return *materials.back();
+}
+
+std::vector<Texture*> Renderer::addTextures(TextureLoader& loader) {
+  std::vector<Texture*> added;
+  for (auto& texture : loader.upload()) {
+    added.push_back(texture.get());
+    textures.push_back(std::move(texture));
+  }
+  return added;
+}
+
+std::vector<Texture*> Renderer::addTextures(const std::vector<std::string>& texturePaths) {
+  std::vector<Texture*> added;
+  for (auto& texture : assetCache->getTextures(texturePaths)) {
+    added.push_back(texture.get());
+    textures.push_back(std::move(texture));
+  }
+  return added;
+}
+
+std::vector<Texture*> Renderer::addStreamedTextures(const std::vector<std::string>& texturePaths) {
+  if (!textureStreamer) {
+    textureStreamer = std::make_unique<TextureStreamer>(device, buffers, *deletionQueue);
+  }
+  return textureStreamer->add(texturePaths);
+}
+
+RenderObject& Renderer::addRenderObject(Model& model, Material& material) {
+  if (occlusionCuller && renderObjects.size() >= occlusionCuller->getMaxObjects()) {
+    throw std::runtime_error("too many render objects for the occlusion culling buffers");
+  }
+  renderObjects.emplace_back(model, material);
+  return renderObjects.back();
+}
+
+void Renderer::clearScene() {
+  vkDeviceWaitIdle(device.getDevice());
+  renderObjects.clear();
+  materials.clear();
+  textureStreamer.reset();
+  textures.clear();
+  models.clear();
+  // everything the asset cache let go of
+  deletionQueue->flush();
+  // the descriptor sets owned by the materials are all returned at once
+  descriptorAllocator->reset();
+}
+
+static double millisecondsBetween(uint64_t start, uint64_t end) {
+  return static_cast<double>(end - start) / 1e6;
+}
+
 void Renderer::drawFrame() {
+  FrameTimings timings{};
+  uint64_t frameStart = Trace::now();
   // using a fence to reduce the latency between the CPU and GPU,
   // for example, user input via keyboard or mouse comes in as frames
   // are being rendered in the background before being presented to the screen,
   // therefore the user input and screen become out of sync.
   // this fence tells the GPU to wait a bit longer if needed so as to
   // create more of a linear sequence of drawing and presenting.
-  vkWaitForFences(device.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+  {
+    TRACE_SCOPE("fence wait");
+    vkWaitForFences(device.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+  }
+  uint64_t fenceEnd = Trace::now();
+  timings.fenceWait = millisecondsBetween(frameStart, fenceEnd);
 
   // ask the swap chain for the next available image that we can write into
   uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(
-    device.getDevice(),
-    swapChain.getSwapChain(),
-    UINT64_MAX, // timeout (max means potentially wait forever)
-    imageAvailableSemaphores[currentFrame],
-    VK_NULL_HANDLE,
-    &imageIndex);
+  VkResult result;
+  {
+    TRACE_SCOPE("acquire");
+    result = vkAcquireNextImageKHR(
+      device.getDevice(),
+      swapChain.getSwapChain(),
+      UINT64_MAX, // timeout (max means potentially wait forever)
+      imageAvailableSemaphores[currentFrame],
+      VK_NULL_HANDLE,
+      &imageIndex);
+  }
+  uint64_t acquireEnd = Trace::now();
+  timings.acquire = millisecondsBetween(fenceEnd, acquireEnd);
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
   	recreateSwapChain();
@@ -249,10 +617,29 @@ void Renderer::drawFrame() {
   // only reset the fence if we are submitting work
   vkResetFences(device.getDevice(), 1, &inFlightFences[currentFrame]);
 
-  for (auto& material : materials) material.updateUniformBuffer(currentFrame);
+  uint64_t updateStart = Trace::now();
+  {
+    TRACE_SCOPE("uniform update");
+    // the frame this one replaces is done, so is anything it was the last to use
+    deletionQueue->collect(frameNumber);
+    frameDescriptorAllocators[currentFrame]->reset();
+    if (textureStreamer) {
+      textureStreamer->update(frameNumber);
+      for (auto& material : materials) material->updateTexture(currentFrame);
+    }
+    updateFrameUniforms();
+    if (occlusionCuller) updateCullObjects();
+  }
+  uint64_t recordStart = Trace::now();
+  timings.uniformUpdate = millisecondsBetween(updateStart, recordStart);
 
-  vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-  recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+  {
+    TRACE_SCOPE("record");
+    vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+  }
+  uint64_t recordEnd = Trace::now();
+  timings.record = millisecondsBetween(recordStart, recordEnd);
 
   // to draw, the rendering workload is submitted to the queue
   VkSubmitInfo submitInfo{};
@@ -274,9 +661,15 @@ void Renderer::drawFrame() {
 
   // submit the rendering workflow to the queue
   // the final parameter (fence) is used to sync the CPU with the GPU
-  if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer");
+  uint64_t submitStart = Trace::now();
+  {
+    TRACE_SCOPE("submit");
+    if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer");
+    }
   }
+  uint64_t submitEnd = Trace::now();
+  timings.submit = millisecondsBetween(submitStart, submitEnd);
 
   // now onto presenting the rendering to the screen
   VkPresentInfoKHR presentInfo{};
@@ -294,7 +687,17 @@ void Renderer::drawFrame() {
   presentInfo.pResults = nullptr; // Optional
 
   // submit the presentation instruction
-  vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
+  uint64_t presentStart = Trace::now();
+  {
+    TRACE_SCOPE("present");
+    vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
+  }
+  uint64_t presentEnd = Trace::now();
+  timings.present = millisecondsBetween(presentStart, presentEnd);
+  timings.total = millisecondsBetween(frameStart, presentEnd);
+  lastFrameTimings = timings;
+
+  gpuProfiler->endFrame();
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
 		framebufferResized = false;
@@ -304,6 +707,7 @@ void Renderer::drawFrame() {
 	}
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  frameNumber++;
 }
 
 void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
@@ -316,6 +720,131 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
     throw std::runtime_error("failed to begin recording command buffer");
   }
 
+  // this reads back the timings from the last time this frame was used,
+  // and it resets the queries, which cannot happen inside a render pass.
+  gpuProfiler->beginFrame(commandBuffer, currentFrame);
+  pipelineStatistics->beginFrame(commandBuffer, currentFrame);
+
+  RenderCounters counters{};
+
+  // scope names are built once, not every frame
+  while (profileDraws && drawScopeNames.size() < renderObjects.size()) {
+    drawScopeNames.push_back("draw " + std::to_string(drawScopeNames.size()));
+  }
+
+  buildRenderGraph(imageIndex, counters);
+  pipelineStatistics->begin(commandBuffer);
+  renderGraph->execute(commandBuffer);
+  pipelineStatistics->end(commandBuffer);
+  counters.barriers = renderGraph->getBarrierCount();
+
+  // uploads happen outside of the frame (when models and materials are
+  // created), they are attributed to the first frame recorded afterwards.
+  counters.uploads = buffers.getUploadCount() - previousUploadCount;
+  counters.uploadBytes = buffers.getUploadBytes() - previousUploadBytes;
+  previousUploadCount = buffers.getUploadCount();
+  previousUploadBytes = buffers.getUploadBytes();
+
+  frameStats.counters = counters;
+  frameStats.hasPipelineStatistics = pipelineStatistics->hasResult();
+  frameStats.pipeline = pipelineStatistics->getLatest();
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer");
+  }
+}
+
+void Renderer::buildRenderGraph(uint32_t imageIndex, RenderCounters& counters) {
+  RenderGraph& graph = *renderGraph;
+  graph.reset();
+
+  // the swap chain image itself is transitioned by the render pass (it is
+  // only ever the resolve target), the multisampled images are tracked.
+  RenderGraph::ResourceId color = graph.importImage(
+    "color",
+    swapChainBuffers->getColorImage(),
+    VK_IMAGE_ASPECT_COLOR_BIT,
+    1);
+  RenderGraph::ResourceId depth = graph.importImage(
+    "depth",
+    swapChainBuffers->getDepthImage(),
+    getImageAspect(swapChainBuffers->getDepthFormat()),
+    1);
+  graph.markOutput(color);
+
+  // the first render pass clears, its attachments can start in any layout
+  ResourceState clearColor = getResourceState(ResourceUsage::ColorAttachment, VK_IMAGE_LAYOUT_UNDEFINED);
+  ResourceState clearDepth = getResourceState(ResourceUsage::DepthAttachment, VK_IMAGE_LAYOUT_UNDEFINED);
+
+  if (!occlusionCuller) {
+    RenderGraph::PassId pass = graph.addPass("render pass", [this, imageIndex, &counters](VkCommandBuffer commandBuffer) {
+      recordRenderPass(commandBuffer, renderPass, imageIndex, counters, VK_NULL_HANDLE, false);
+    });
+    graph.write(pass, color, clearColor, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    graph.write(pass, depth, clearDepth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    return;
+  }
+
+  // early: draw what was visible last frame. hi-z: reduce that depth.
+  // late: draw what the pyramid says is visible but was not drawn yet.
+  uint32_t objectCount = static_cast<uint32_t>(renderObjects.size());
+  VkBuffer indirectBuffer = occlusionCuller->getIndirectBuffer(currentFrame);
+  RenderGraph::ResourceId indirect = graph.importBuffer("indirect draws", indirectBuffer);
+  RenderGraph::ResourceId visibility = graph.importBuffer("visibility", occlusionCuller->getVisibilityBuffer());
+  // the pyramid is moved to the general layout when it is created
+  ResourceState pyramidCreated{};
+  pyramidCreated.layout = VK_IMAGE_LAYOUT_GENERAL;
+  RenderGraph::ResourceId pyramid = graph.importImage(
+    "hi-z pyramid",
+    occlusionCuller->getPyramidImage(),
+    VK_IMAGE_ASPECT_COLOR_BIT,
+    occlusionCuller->getPyramidLevels(),
+    pyramidCreated);
+  // next frame's early cull depends on it
+  graph.markOutput(visibility);
+
+  RenderGraph::PassId cullEarly = graph.addPass("cull early", [this, objectCount](VkCommandBuffer commandBuffer) {
+    occlusionCuller->cullEarly(commandBuffer, currentFrame, objectCount);
+  });
+  graph.read(cullEarly, visibility, getResourceState(ResourceUsage::ComputeShaderRead));
+  graph.write(cullEarly, indirect, getResourceState(ResourceUsage::ComputeShaderWrite));
+
+  RenderGraph::PassId early = graph.addPass("render pass", [this, imageIndex, indirectBuffer, &counters](VkCommandBuffer commandBuffer) {
+    recordRenderPass(commandBuffer, renderPass, imageIndex, counters, indirectBuffer, false);
+  });
+  graph.read(early, indirect, getResourceState(ResourceUsage::IndirectRead));
+  graph.write(early, color, clearColor, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  graph.write(early, depth, clearDepth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+  RenderGraph::PassId hiz = graph.addPass("hi-z", [this](VkCommandBuffer commandBuffer) {
+    occlusionCuller->buildPyramid(commandBuffer);
+  });
+  graph.read(hiz, depth, getResourceState(ResourceUsage::ComputeDepthRead));
+  graph.write(hiz, pyramid, getResourceState(ResourceUsage::ComputeShaderReadWrite));
+
+  RenderGraph::PassId cullLate = graph.addPass("cull late", [this, objectCount](VkCommandBuffer commandBuffer) {
+    occlusionCuller->cullLate(commandBuffer, currentFrame, objectCount);
+  });
+  graph.read(cullLate, pyramid, getResourceState(ResourceUsage::ComputeShaderRead, VK_IMAGE_LAYOUT_GENERAL));
+  graph.write(cullLate, visibility, getResourceState(ResourceUsage::ComputeShaderReadWrite));
+  graph.write(cullLate, indirect, getResourceState(ResourceUsage::ComputeShaderWrite));
+
+  RenderGraph::PassId late = graph.addPass("late render pass", [this, imageIndex, indirectBuffer, &counters](VkCommandBuffer commandBuffer) {
+    recordRenderPass(commandBuffer, lateRenderPass, imageIndex, counters, indirectBuffer, true);
+  });
+  graph.read(late, indirect, getResourceState(ResourceUsage::IndirectRead));
+  graph.write(late, color, getResourceState(ResourceUsage::ColorAttachment));
+  graph.write(late, depth, getResourceState(ResourceUsage::DepthAttachment));
+}
+
+void Renderer::recordRenderPass(
+  VkCommandBuffer commandBuffer,
+  VkRenderPass pass,
+  uint32_t imageIndex,
+  RenderCounters& counters,
+  VkBuffer indirectBuffer,
+  bool late
+) {
   VkExtent2D swapChainExtent = swapChain.getSwapChainExtent();
 
   // before adding depth buffer, we only needed the one clear value
@@ -330,7 +859,7 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   // and some values which define the size of the render area / clear color values.
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.renderPass = pass;
   renderPassInfo.framebuffer = swapChainBuffers.get()->getSwapChainFramebuffers()[imageIndex];
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = swapChainExtent;
@@ -342,15 +871,78 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
   // - VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-  // per-object draw call
-  for (auto& object : renderObjects) {
-    object.recordCommandBuffer(commandBuffer, currentFrame);
+  // every pipeline layout starts with the frame's set layout, so set 0
+  // stays bound across pipelines (and the depth and shading subpasses),
+  // whichever layout it was bound with
+  if (!renderObjects.empty()) {
+    vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      renderObjects[0].getMaterial().getPipelineLayout(),
+      0,
+      1,
+      &frameSet,
+      0,
+      nullptr);
+    counters.descriptorBinds++;
   }
 
-	vkCmdEndRenderPass(commandBuffer);
+  auto indirectOffset = [&](size_t i) -> VkDeviceSize {
+    if (indirectBuffer == VK_NULL_HANDLE) return 0;
+    uint32_t object = static_cast<uint32_t>(i);
+    return late
+      ? occlusionCuller->getLateDrawOffset(object)
+      : occlusionCuller->getEarlyDrawOffset(object);
+  };
 
-  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-    throw std::runtime_error("failed to record command buffer");
+  // depth only, every object, before anything is shaded
+  if (options.depthPrepass) {
+    uint32_t depthScope = gpuProfiler->beginScope(commandBuffer, "depth prepass");
+    for (size_t i = 0; i < renderObjects.size(); i++) {
+      renderObjects[i].recordDepthCommandBuffer(
+        commandBuffer, currentFrame, static_cast<uint32_t>(i),
+        counters, indirectBuffer, indirectOffset(i));
+    }
+    gpuProfiler->endScope(commandBuffer, depthScope);
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
   }
+
+  // per-object draw call. a scope of the same name in the late pass
+  // would be a second sample of a different draw in the same frame.
+  for (size_t i = 0; i < renderObjects.size(); i++) {
+    uint32_t drawScope = profileDraws && !late
+      ? gpuProfiler->beginScope(commandBuffer, drawScopeNames[i])
+      : UINT32_MAX;
+    renderObjects[i].recordCommandBuffer(
+      commandBuffer, currentFrame, static_cast<uint32_t>(i),
+      counters, indirectBuffer, indirectOffset(i));
+    gpuProfiler->endScope(commandBuffer, drawScope);
+  }
+
+	vkCmdEndRenderPass(commandBuffer);
 }
 
+void Renderer::updateCullObjects() {
+  CullObject* objects = occlusionCuller->getObjects(currentFrame);
+  for (size_t i = 0; i < renderObjects.size(); i++) {
+    const Model& model = renderObjects[i].getModel();
+    const glm::mat4& transform = renderObjects[i].getTransform();
+    const FrameUniforms& uniforms = frameUniforms;
+
+    // the model matrix may scale, the sphere grows by the largest axis
+    float scale = std::max({
+      glm::length(glm::vec3(transform[0])),
+      glm::length(glm::vec3(transform[1])),
+      glm::length(glm::vec3(transform[2]))
+    });
+    glm::vec4 center = uniforms.view * transform * glm::vec4(model.boundsCenter, 1.0f);
+
+    objects[i].sphere = glm::vec4(glm::vec3(center), model.boundsRadius * scale);
+    objects[i].projection = glm::vec4(
+      uniforms.projection[0][0],
+      uniforms.projection[1][1],
+      uniforms.projection[2][2],
+      uniforms.projection[3][2]);
+    objects[i].indexCount = model.indexCount;
+  }
+}
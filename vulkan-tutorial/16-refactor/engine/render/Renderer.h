@@ -2,50 +2,211 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <memory>
+#include <string>
 #include "../core/Device.h"
 #include "../core/SwapChain.h"
 #include "../core/SwapChainBuffers.h"
 #include "../memory/Buffers.h"
+#include "../profile/GpuProfiler.h"
+#include "../profile/PipelineStatisticsQuery.h"
+#include "../profile/RenderStats.h"
 #include "Model.h"
 #include "Material.h"
+#include "../memory/TextureLoader.h"
+#include "../memory/SamplerCache.h"
+#include "../memory/TextureStreamer.h"
+#include "../core/DeletionQueue.h"
+#include "../core/ThreadPool.h"
 #include "RenderObject.h"
+#include "Camera.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorLayoutCache.h"
+#include "AssetCache.h"
+#include "OcclusionCuller.h"
+#include "RenderGraph.h"
+#include "MipGenerator.h"
+
+// CPU time spent in each part of the last call to drawFrame, in milliseconds
+struct FrameTimings {
+  double fenceWait = 0.0;
+  double acquire = 0.0;
+  double uniformUpdate = 0.0;
+  double record = 0.0;
+  double submit = 0.0;
+  double present = 0.0;
+  double total = 0.0;
+};
+
+// features which change how the render pass is built
+struct RendererOptions {
+  // draw depth in a subpass of its own before shading
+  bool depthPrepass = false;
+  // cull objects on the GPU against the frustum and a Hi-Z pyramid,
+  // objects are drawn with indirect draws in two render passes. ignored
+  // if the device can't give indirect draws a firstInstance.
+  bool occlusionCulling = false;
+  // make texture mip chains with a compute shader instead of blits. this
+  // happens anyway if the texture format can not be blitted with a filter.
+  bool computeMipmaps = false;
+};
 
 class Renderer {
 public:
-  Renderer(Device& device, SwapChain& swapChain, Buffers& buffers);
+  Renderer(Device& device, SwapChain& swapChain, Buffers& buffers, const RendererOptions& options = RendererOptions{});
   ~Renderer();
 
   void drawFrame();
 
+  // scene. models, textures and materials stay valid until clearScene(),
+  // a render object reference only until the next addRenderObject().
+  // files are loaded once, adding the same one again shares it.
+  Model& addModel(const std::string& modelPath);
+  Model& addModel(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+  // add() every texture to the loader, then addTextures uploads them
+  // all in one submission, in the order they were added
+  TextureLoader createTextureLoader() {
+    return TextureLoader(device, buffers, mipGenerator.get(), threadPool.get());
+  }
+  std::vector<Texture*> addTextures(TextureLoader& loader);
+  std::vector<Texture*> addTextures(const std::vector<std::string>& texturePaths);
+  // KTX2 textures which start out small and get their larger mip levels
+  // over the next frames, see TextureStreamer
+  std::vector<Texture*> addStreamedTextures(const std::vector<std::string>& texturePaths);
+  // null until the first streamed texture is added
+  TextureStreamer* getTextureStreamer() { return textureStreamer.get(); }
+  // each of these uploads its own texture, prefer addTextures for many
+  Material& addMaterial(const std::string& texturePath);
+  Material& addMaterial(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+  // any number of materials can share a texture
+  Material& addMaterial(Texture& texture);
+  RenderObject& addRenderObject(Model& model, Material& material);
+  // waits for the device to be idle, then frees everything above
+  void clearScene();
+  size_t getRenderObjectCount() const { return renderObjects.size(); }
+
+  const FrameTimings& getLastFrameTimings() const { return lastFrameTimings; }
+  // a pair of timestamps around every draw call is useful to find an
+  // expensive object, but it is not free, so it is off by default. the
+  // render pass is always timed. with occlusion culling only the first
+  // render pass's draws are.
+  void setProfileDraws(bool enabled) { profileDraws = enabled; }
+
+  // the view and projection of every frame from now on
+  Camera& getCamera() { return camera; }
+  // set 0 of every pipeline, which has the frame's FrameUniforms (binding 0)
+  // and the ObjectData of every render object (binding 1)
+  VkDescriptorSetLayout getFrameSetLayout() const { return frameSetLayout; }
+
   VkRenderPass getRenderPass() const { return renderPass; }
-  VkDescriptorPool getDescriptorPool() const { return descriptorPool; }
+  // when true, the render pass has a depth only subpass (0)
+  // before the subpass which does the shading (1)
+  bool hasDepthPrepass() const { return options.depthPrepass; }
+  bool hasOcclusionCulling() const { return options.occlusionCulling; }
+  // for sets which live until clearScene(), like those of materials
+  DescriptorAllocator& getDescriptorAllocator() { return *descriptorAllocator; }
+  // for sets which are only used by the frame being recorded, they are
+  // all returned when this frame's fence has been waited on next time
+  DescriptorAllocator& getFrameDescriptorAllocator() { return *frameDescriptorAllocators[currentFrame]; }
+  DescriptorLayoutCache& getDescriptorLayoutCache() { return *descriptorLayoutCache; }
+  GpuProfiler& getGpuProfiler() { return *gpuProfiler; }
+  // the passes of the last frame, each one timed as a scope of its name
+  const RenderGraph& getRenderGraph() const { return *renderGraph; }
+  SamplerCache& getSamplerCache() { return *samplerCache; }
+  // hits and misses of addModel, addMaterial and addTextures by path
+  AssetCacheStats getAssetCacheStats() const { return assetCache->getStats(); }
+  // counters from the last frame recorded, and the most recent pipeline
+  // statistics the GPU has finished
+  const FrameStats& getStats() const { return frameStats; }
 
   bool framebufferResized = false;
 
 private:
 	const int MAX_FRAMES_IN_FLIGHT = 2;
+  // the size of the culling buffers, which is how many render objects fit
+  const uint32_t MAX_CULLED_OBJECTS = 16384;
 	size_t currentFrame = 0;
+  // every frame drawn so far, for the deletion queue
+  uint64_t frameNumber = 0;
 
   Device& device;
   Buffers& buffers;
   SwapChain& swapChain;
+  RendererOptions options;
 
   VkRenderPass renderPass;
+  // with occlusion culling, the objects found visible after the first
+  // render pass are drawn in this one. it loads what the first one stored,
+  // and it is compatible with it so the framebuffers and pipelines are shared.
+  VkRenderPass lateRenderPass = VK_NULL_HANDLE;
+  std::unique_ptr<OcclusionCuller> occlusionCuller;
+  // only if textures get their mip chains from a compute shader
+  std::unique_ptr<MipGenerator> mipGenerator;
+  // decodes the images of a texture batch in parallel
+  std::unique_ptr<ThreadPool> threadPool;
+  // rebuilt every frame, it remembers the state of the images and buffers
+  // it has seen, which is how one frame knows what the last one left behind
+  std::unique_ptr<RenderGraph> renderGraph;
 
   std::unique_ptr<SwapChainBuffers> swapChainBuffers;
 
+  // GPU timings for the render pass, each draw call, and uploads
+  std::unique_ptr<GpuProfiler> gpuProfiler;
+  std::vector<std::string> drawScopeNames;
+  bool profileDraws = false;
+  FrameTimings lastFrameTimings;
+  // hardware counters around the render pass
+  std::unique_ptr<PipelineStatisticsQuery> pipelineStatistics;
+  FrameStats frameStats;
+  // upload totals from Buffers at the end of the previous frame
+  uint64_t previousUploadCount = 0;
+  uint64_t previousUploadBytes = 0;
+
+  // every material's sampler, samplers are destroyed with it
+  std::unique_ptr<SamplerCache> samplerCache;
+
   // command buffers are automatically freed when their command pool is destroyed
   std::vector<VkCommandBuffer> commandBuffers;
 
-  // render objects, and their models and materials
+  // render objects, and their models and materials.
+  // render objects hold references to models and materials, so these
+  // are heap allocated to keep the references valid as the vectors grow.
+  // the same goes for materials, which point to their textures.
   std::vector<RenderObject> renderObjects;
-  std::vector<Model> models;
-  std::vector<Material> materials;
+  // shared with the asset cache, which lets them go once nothing else has them
+  std::vector<std::shared_ptr<Model>> models;
+  std::vector<std::shared_ptr<Texture>> textures;
+  std::vector<std::unique_ptr<Material>> materials;
+  // images replaced while frames in flight may still use them
+  std::unique_ptr<DeletionQueue> deletionQueue;
+  std::unique_ptr<TextureStreamer> textureStreamer;
+  std::unique_ptr<AssetCache> assetCache;
 
   // Uniforms
-  // descriptor pool is used to allocate descriptor sets
+  // descriptor pools are used to allocate descriptor sets
   // descriptor sets are currently owned by each Material
-  VkDescriptorPool descriptorPool;
+  std::unique_ptr<DescriptorLayoutCache> descriptorLayoutCache;
+  std::unique_ptr<DescriptorAllocator> descriptorAllocator;
+  std::vector<std::unique_ptr<DescriptorAllocator>> frameDescriptorAllocators;
+
+  // per frame, camera
+  Camera camera;
+  FrameUniforms frameUniforms{};
+  VkDescriptorSetLayout frameSetLayout;
+  std::vector<VkBuffer> frameUniformBuffers;
+  std::vector<VkDeviceMemory> frameUniformBuffersMemory;
+  std::vector<void*> frameUniformBuffersMapped;
+  // this frame's, from its descriptor allocator
+  VkDescriptorSet frameSet = VK_NULL_HANDLE;
+
+  // per frame, every render object's ObjectData. gathered here first, so
+  // that the mapped (often write-combined) memory gets one memcpy.
+  // a frame's buffer grows when the objects no longer fit.
+  std::vector<ObjectData> objectData;
+  std::vector<VkBuffer> objectBuffers;
+  std::vector<VkDeviceMemory> objectBuffersMemory;
+  std::vector<void*> objectBuffersMapped;
+  std::vector<size_t> objectBufferCapacities;
 
   // synchronization objects
   std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -55,12 +216,32 @@ private:
   std::vector<VkFence> inFlightFences;
 
   void createRenderPass();
-  void createDescriptorPool();
+  VkRenderPass createRenderPass(bool late);
+  void createDescriptorAllocators();
+  void createFrameUniformBuffers();
+  void updateFrameUniforms();
+  // room for at least this many objects in the buffer of one frame in flight
+  void createObjectBuffer(size_t frame, size_t capacity);
+  void destroyObjectBuffer(size_t frame);
+  void updateObjectData();
   void createCommandBuffers();
   void createSyncObjects();
 
   // the other half of "drawFrame"
   void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+  // the bounding sphere of every render object, in view space
+  void updateCullObjects();
+  // declare this frame's passes and the resources they read and write
+  void buildRenderGraph(uint32_t imageIndex, RenderCounters& counters);
+  // one render pass worth of draws. with an indirect buffer, the draw
+  // parameters come from the early or late half of the culling output.
+  void recordRenderPass(
+    VkCommandBuffer commandBuffer,
+    VkRenderPass pass,
+    uint32_t imageIndex,
+    RenderCounters& counters,
+    VkBuffer indirectBuffer,
+    bool late);
 
   // if window attributes change this will be called
   // via. the public boolean frameBufferResized
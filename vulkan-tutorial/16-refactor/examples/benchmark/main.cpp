@@ -0,0 +1,383 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cmath>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+#include "../../engine/Engine.h"
+#include "../../engine/profile/Trace.h"
+
+// Synthetic scene benchmark
+//
+// builds scenes of N render objects, sharing M materials, K models and
+// T textures, renders each one for a fixed number of frames and reports
+// the average CPU and GPU cost per frame. every list argument is swept,
+// each combination becomes one row of the output.
+//
+// make EXAMPLE=benchmark BUILD=release && ./build/app --objects 1,100,1000
+
+struct BenchmarkOptions {
+	std::vector<uint32_t> objects = { 1, 10, 100, 1000 };
+	std::vector<uint32_t> materials = { 1 };
+	std::vector<uint32_t> models = { 1 };
+	std::vector<uint32_t> textures = { 1 };
+	uint32_t frames = 500;
+	uint32_t warmup = 50;
+	std::string format = "csv";
+	std::string out;
+	bool visible = true;
+	bool depthPrepass = false;
+	bool occlusionCulling = false;
+	bool computeMipmaps = false;
+};
+
+struct BenchmarkResult {
+	uint32_t objects;
+	uint32_t materials;
+	uint32_t models;
+	uint32_t textures;
+	uint32_t frames;
+	double cpuRecord;
+	double cpuSubmit;
+	double gpu;
+	double fps;
+	double residentMemory;
+	// from the last frame, these are the same every frame of a configuration
+	uint64_t drawCalls;
+	uint64_t triangles;
+	uint64_t fragmentInvocations;
+};
+
+static void printUsage() {
+	std::cout << "usage: app [options]\n"
+		<< "  --objects 1,10,100   number of render objects\n"
+		<< "  --materials 1,4      number of materials (each has its own pipeline)\n"
+		<< "  --models 1,4         number of distinct meshes\n"
+		<< "  --textures 1,4       number of distinct texture images\n"
+		<< "  --frames 500         measured frames per configuration\n"
+		<< "  --warmup 50          frames rendered before measuring\n"
+		<< "  --format csv|json\n"
+		<< "  --out file           write results to a file instead of stdout\n"
+		<< "  --hidden             do not show the window\n"
+		<< "  --depth-prepass      render depth first, then shade with an EQUAL depth test\n"
+		<< "  --occlusion-culling  cull hidden objects on the GPU with a Hi-Z pyramid\n"
+		<< "  --compute-mipmaps    make texture mip chains with a compute shader\n";
+}
+
+static std::vector<uint32_t> parseList(const std::string& value) {
+	std::vector<uint32_t> list;
+	std::stringstream stream(value);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		unsigned long number = std::stoul(item);
+		if (number == 0) {
+			throw std::runtime_error("benchmark counts must be at least 1");
+		}
+		list.push_back(static_cast<uint32_t>(number));
+	}
+	if (list.empty()) {
+		throw std::runtime_error("empty list: " + value);
+	}
+	return list;
+}
+
+static BenchmarkOptions parseOptions(int argc, char** argv) {
+	BenchmarkOptions options;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			printUsage();
+			exit(EXIT_SUCCESS);
+		}
+		if (arg == "--hidden") {
+			options.visible = false;
+			continue;
+		}
+		if (arg == "--depth-prepass") {
+			options.depthPrepass = true;
+			continue;
+		}
+		if (arg == "--occlusion-culling") {
+			options.occlusionCulling = true;
+			continue;
+		}
+		if (arg == "--compute-mipmaps") {
+			options.computeMipmaps = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			throw std::runtime_error("missing value for " + arg);
+		}
+		std::string value = argv[++i];
+		if (arg == "--objects") options.objects = parseList(value);
+		else if (arg == "--materials") options.materials = parseList(value);
+		else if (arg == "--models") options.models = parseList(value);
+		else if (arg == "--textures") options.textures = parseList(value);
+		else if (arg == "--frames") options.frames = static_cast<uint32_t>(std::stoul(value));
+		else if (arg == "--warmup") options.warmup = static_cast<uint32_t>(std::stoul(value));
+		else if (arg == "--format") options.format = value;
+		else if (arg == "--out") options.out = value;
+		else throw std::runtime_error("unknown option " + arg);
+	}
+	if (options.format != "csv" && options.format != "json") {
+		throw std::runtime_error("format must be csv or json");
+	}
+	if (options.frames == 0) {
+		throw std::runtime_error("frames must be at least 1");
+	}
+	return options;
+}
+
+// a uv sphere, each model gets a different tessellation so that
+// the models are actually different meshes with different costs.
+static void makeSphere(
+	uint32_t rings,
+	uint32_t segments,
+	std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices
+) {
+	const float pi = 3.14159265358979f;
+	const float radius = 0.5f;
+	for (uint32_t ring = 0; ring <= rings; ring++) {
+		float v = static_cast<float>(ring) / rings;
+		float phi = v * pi;
+		for (uint32_t segment = 0; segment <= segments; segment++) {
+			float u = static_cast<float>(segment) / segments;
+			float theta = u * 2.0f * pi;
+			Vertex vertex{};
+			vertex.position = {
+				radius * std::sin(phi) * std::cos(theta),
+				radius * std::sin(phi) * std::sin(theta),
+				radius * std::cos(phi),
+			};
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+			vertex.texCoord = { u, v };
+			vertices.push_back(vertex);
+		}
+	}
+	for (uint32_t ring = 0; ring < rings; ring++) {
+		for (uint32_t segment = 0; segment < segments; segment++) {
+			uint32_t a = ring * (segments + 1) + segment;
+			uint32_t b = a + segments + 1;
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+}
+
+// a checkerboard, the colors are different for every texture
+static std::vector<uint8_t> makeTexture(uint32_t index, uint32_t size) {
+	std::vector<uint8_t> pixels(size * size * 4);
+	uint8_t r = static_cast<uint8_t>(64 + (index * 53) % 192);
+	uint8_t g = static_cast<uint8_t>(64 + (index * 97) % 192);
+	uint8_t b = static_cast<uint8_t>(64 + (index * 151) % 192);
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			bool dark = ((x / 16) + (y / 16)) % 2 == 0;
+			uint8_t* pixel = &pixels[(y * size + x) * 4];
+			pixel[0] = dark ? r / 2 : r;
+			pixel[1] = dark ? g / 2 : g;
+			pixel[2] = dark ? b / 2 : b;
+			pixel[3] = 255;
+		}
+	}
+	return pixels;
+}
+
+// megabytes the process has in memory right now. the peak would be the
+// same for every configuration after the largest one, this is measured
+// while the configuration's scene is loaded.
+static double residentMemory() {
+#ifdef __APPLE__
+	mach_task_basic_info_data_t info{};
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+		return 0.0;
+	}
+	return static_cast<double>(info.resident_size) / (1024.0 * 1024.0);
+#else
+	// the second field is the resident set, in pages
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size = 0;
+	uint64_t resident = 0;
+	if (!(statm >> size >> resident)) {
+		return 0.0;
+	}
+	return static_cast<double>(resident * sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+#endif
+}
+
+// returns false if the window was closed during the run
+static bool runConfiguration(
+	Engine& engine,
+	const BenchmarkOptions& options,
+	BenchmarkResult& result
+) {
+	Renderer& renderer = engine.getRenderer();
+	renderer.clearScene();
+
+	std::vector<Model*> models;
+	for (uint32_t i = 0; i < result.models; i++) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		makeSphere(8 + 4 * i, 16 + 8 * i, vertices, indices);
+		models.push_back(&renderer.addModel(vertices, indices));
+	}
+
+	// all T textures are uploaded in one submission, and materials share them
+	TextureLoader loader = renderer.createTextureLoader();
+	for (uint32_t i = 0; i < result.textures; i++) {
+		loader.add(makeTexture(i, 256), 256, 256);
+	}
+	std::vector<Texture*> textures = renderer.addTextures(loader);
+	std::vector<Material*> materials;
+	for (uint32_t i = 0; i < result.materials; i++) {
+		materials.push_back(&renderer.addMaterial(*textures[i % result.textures]));
+	}
+
+	for (uint32_t i = 0; i < result.objects; i++) {
+		renderer.addRenderObject(*models[i % result.models], *materials[i % result.materials]);
+	}
+
+	for (uint32_t i = 0; i < options.warmup; i++) {
+		if (!engine.runFrame()) return false;
+	}
+	engine.getGpuProfiler().resetStats();
+
+	double record = 0.0;
+	double submit = 0.0;
+	uint64_t start = Trace::now();
+	for (uint32_t i = 0; i < options.frames; i++) {
+		if (!engine.runFrame()) return false;
+		const FrameTimings& timings = renderer.getLastFrameTimings();
+		record += timings.record;
+		submit += timings.submit;
+	}
+	double seconds = static_cast<double>(Trace::now() - start) / 1e9;
+
+	result.frames = options.frames;
+	result.cpuRecord = record / options.frames;
+	result.cpuSubmit = submit / options.frames;
+	// every frame since the reset, a frame or two late as the timestamps
+	// are read back when their frame index comes around again. with
+	// occlusion culling the frame is split over several passes.
+	result.gpu = 0.0;
+	for (const std::string& pass : renderer.getRenderGraph().getPassOrder()) {
+		GpuScopeStats gpu = engine.getGpuProfiler().getStats(pass);
+		if (gpu.count > 0) result.gpu += gpu.total / gpu.count;
+	}
+	result.fps = options.frames / seconds;
+	result.residentMemory = residentMemory();
+
+	const FrameStats& stats = renderer.getStats();
+	result.drawCalls = stats.counters.drawCalls;
+	result.triangles = stats.counters.triangles;
+	result.fragmentInvocations = stats.hasPipelineStatistics
+		? stats.pipeline.fragmentShaderInvocations
+		: 0;
+	return true;
+}
+
+static void writeResults(
+	std::ostream& out,
+	const std::string& format,
+	const std::vector<BenchmarkResult>& results
+) {
+	if (format == "csv") {
+		out << "objects,materials,models,textures,frames,"
+			<< "cpu_record_ms,cpu_submit_ms,gpu_ms,fps,rss_mb,"
+			<< "draw_calls,triangles,fs_invocations\n";
+		for (const auto& r : results) {
+			out << r.objects << ',' << r.materials << ',' << r.models << ',' << r.textures << ','
+				<< r.frames << ',' << r.cpuRecord << ',' << r.cpuSubmit << ',' << r.gpu << ','
+				<< r.fps << ',' << r.residentMemory << ',' << r.drawCalls << ',' << r.triangles << ','
+				<< r.fragmentInvocations << '\n';
+		}
+		return;
+	}
+	out << "[\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& r = results[i];
+		out << "  {\"objects\": " << r.objects
+			<< ", \"materials\": " << r.materials
+			<< ", \"models\": " << r.models
+			<< ", \"textures\": " << r.textures
+			<< ", \"frames\": " << r.frames
+			<< ", \"cpu_record_ms\": " << r.cpuRecord
+			<< ", \"cpu_submit_ms\": " << r.cpuSubmit
+			<< ", \"gpu_ms\": " << r.gpu
+			<< ", \"fps\": " << r.fps
+			<< ", \"rss_mb\": " << r.residentMemory
+			<< ", \"draw_calls\": " << r.drawCalls
+			<< ", \"triangles\": " << r.triangles
+			<< ", \"fs_invocations\": " << r.fragmentInvocations
+			<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "]\n";
+}
+
+int main(int argc, char** argv) {
+	try {
+		BenchmarkOptions options = parseOptions(argc, argv);
+
+		EngineConfig config{};
+		config.appName = "Vulkan Benchmark";
+		config.visible = options.visible;
+		config.vsync = false;
+		config.depthPrepass = options.depthPrepass;
+		config.occlusionCulling = options.occlusionCulling;
+		config.computeMipmaps = options.computeMipmaps;
+		auto engine = Engine{config};
+		// per draw timestamps would be measuring themselves
+		engine.getRenderer().setProfileDraws(false);
+		if (options.occlusionCulling && !engine.getRenderer().hasOcclusionCulling()) {
+			std::cerr << "occlusion culling needs drawIndirectFirstInstance, occlusion culling disabled\n";
+		}
+
+		// every combination of the list arguments
+		std::vector<BenchmarkResult> configurations;
+		for (uint32_t objects : options.objects)
+		for (uint32_t materials : options.materials)
+		for (uint32_t models : options.models)
+		for (uint32_t textures : options.textures) {
+			BenchmarkResult configuration{};
+			configuration.objects = objects;
+			configuration.materials = materials;
+			configuration.models = models;
+			configuration.textures = textures;
+			configurations.push_back(configuration);
+		}
+
+		std::vector<BenchmarkResult> results;
+		for (BenchmarkResult result : configurations) {
+			std::cerr << "[BENCH] objects " << result.objects << " materials " << result.materials
+				<< " models " << result.models << " textures " << result.textures << std::endl;
+			if (!runConfiguration(engine, options, result)) {
+				std::cerr << "[BENCH] window closed, stopping early" << std::endl;
+				break;
+			}
+			results.push_back(result);
+		}
+
+		engine.getRenderer().clearScene();
+
+		if (options.out.empty()) {
+			writeResults(std::cout, options.format, results);
+		} else {
+			std::ofstream file(options.out);
+			if (!file) {
+				throw std::runtime_error("failed to open " + options.out);
+			}
+			writeResults(file, options.format, results);
+		}
+	} catch(const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
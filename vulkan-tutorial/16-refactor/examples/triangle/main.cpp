@@ -5,6 +5,21 @@
 int main() {
 	try {
 		auto engine = Engine{};
+		Renderer& renderer = engine.getRenderer();
+
+		std::vector<Vertex> vertices = {
+			{{ 0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.5f, 0.0f}},
+			{{ 0.5f,  0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
+			{{-0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+		};
+		std::vector<uint32_t> indices = { 0, 1, 2 };
+
+		// the shared shader only samples the texture, a single white pixel will do
+		std::vector<uint8_t> white = { 255, 255, 255, 255 };
+
+		Model& model = renderer.addModel(vertices, indices);
+		Material& material = renderer.addMaterial(white, 1, 1);
+		renderer.addRenderObject(model, material);
 		engine.startLoop();
 	} catch(const std::exception &e) {
 		std::cerr << e.what() << std::endl;
@@ -12,4 +27,3 @@ int main() {
 	}
 	return EXIT_SUCCESS;
 }
-
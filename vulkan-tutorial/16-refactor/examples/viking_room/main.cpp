@@ -1,15 +1,30 @@
 #include <iostream>
 #include <stdexcept>
+#include <chrono>
 #include "../../engine/Engine.h"
+#include <glm/gtc/matrix_transform.hpp>
 
 int main() {
 	try {
 		auto engine = Engine{};
-		engine.startLoop();
+		Renderer& renderer = engine.getRenderer();
+		Model& model = renderer.addModel("./examples/viking_room/assets/viking_room.obj");
+		Material& material = renderer.addMaterial("./examples/viking_room/assets/viking_room.png");
+		RenderObject& object = renderer.addRenderObject(model, material);
+
+		// a quarter turn per second around the Z axis
+		auto startTime = std::chrono::high_resolution_clock::now();
+		do {
+			auto currentTime = std::chrono::high_resolution_clock::now();
+			float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+			object.setTransform(glm::rotate(
+				glm::mat4(1.0f),
+				time * glm::radians(90.0f),
+				glm::vec3(0.0f, 0.0f, 1.0f)));
+		} while (engine.runFrame());
 	} catch(const std::exception &e) {
 		std::cerr << e.what() << std::endl;
 		return EXIT_FAILURE;
 	}
 	return EXIT_SUCCESS;
 }
-
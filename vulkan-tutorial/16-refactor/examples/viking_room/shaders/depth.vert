@@ -0,0 +1,29 @@
+#version 450
+
+// depth pre-pass, the positions need to match simple.vert exactly
+// for the EQUAL depth test in the following subpass, hence "invariant".
+
+// set 0 is the same for every draw in a frame
+layout(set = 0, binding = 0) uniform FrameUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+} frame;
+
+// one per render object, the draw's firstInstance is the object's index
+struct ObjectData {
+  mat4 model;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Objects {
+  ObjectData objects[];
+};
+
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main() {
+  mat4 model = objects[gl_InstanceIndex].model;
+  gl_Position = frame.viewProjection * model * vec4(inPosition, 1.0);
+}
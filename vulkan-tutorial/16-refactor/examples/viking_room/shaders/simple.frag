@@ -5,7 +5,8 @@ layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
+// set 1 is the material's
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
 
 void main() {
     // outColor = vec4(fragColor, 1.0);
@@ -1,10 +1,20 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
-  mat4 model;
+// set 0 is the same for every draw in a frame
+layout(set = 0, binding = 0) uniform FrameUniforms {
   mat4 view;
   mat4 projection;
-} ubo;
+  mat4 viewProjection;
+} frame;
+
+// one per render object, the draw's firstInstance is the object's index
+struct ObjectData {
+  mat4 model;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Objects {
+  ObjectData objects[];
+};
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -13,8 +23,12 @@ layout(location = 2) in vec2 inTexCoord;
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
+// must match depth.vert exactly when using a depth pre-pass
+invariant gl_Position;
+
 void main() {
-  gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
+  mat4 model = objects[gl_InstanceIndex].model;
+  gl_Position = frame.viewProjection * model * vec4(inPosition, 1.0);
   fragColor = inColor;
   fragTexCoord = inTexCoord;
 }